@@ -3,6 +3,7 @@
 #pragma once
 
 #include <cstdint>
+#include <expected>
 #include <string>
 #include <vector>
 
@@ -12,6 +13,47 @@ namespace block {
 
 using namespace transaction;
 
+/**
+ * @brief Fields that identify a block and link it into the chain, without its
+ * transactions.
+ */
+struct Header {
+  std::uint32_t index{};
+  std::string previousHash{};
+  std::string merkleRootHash{};
+  std::time_t creationTime{};
+  std::uint32_t nonce{};
+  std::string hash{};
+};
+
+/**
+ * @brief Calculate the Merkle root hash in a simplified way using vector as
+ * main data structure.
+ * @param iTransactionHashes Transaction hashes, coinbases first.
+ * @return Merkle root hash or the hash calculation error.
+ */
+std::expected<std::string, std::string>
+ComputeMerkleRootHash(const std::vector<std::string>& iTransactionHashes);
+
+/**
+ * @brief Calculate the hash of a block header for its nonce.
+ * @return Block hash or the hash calculation error.
+ */
+std::expected<std::string, std::string> ComputeBlockHash(const Header& iHeader);
+
+/**
+ * @brief Check a block hash against the target difficulty, the same way
+ * mining does for the current build variant.
+ */
+bool MeetsTargetDifficulty(const std::string& iHash);
+
+/**
+ * @brief Estimate the work spent on mining a block, i.e. the expected number
+ * of hashes to meet the target difficulty of the current build variant.
+ * Competing branches are compared by their cumulative work.
+ */
+std::uint64_t ComputeBlockWork(const Header& iHeader);
+
 class Block {
  public:
   Block();
@@ -23,6 +65,26 @@ class Block {
                  std::vector<std::unique_ptr<Coinbase>> coinbases,
                  std::optional<std::vector<std::unique_ptr<Payload>>> payloads =
                      std::nullopt);
+  /**
+   * @brief Restore an already mined block, e.g. from storage.
+   * Neither the transactions nor the header are recomputed; verifying them is
+   * up to the caller.
+   */
+  explicit Block(
+      Header header,
+      std::optional<std::vector<std::unique_ptr<Coinbase>>> coinbases,
+      std::optional<std::vector<std::unique_ptr<Payload>>> payloads);
+
+  /**
+   * @brief Mine a block from transactions whose hashes are already known to
+   * be valid, e.g. verified on admission to the mempool. Their cached hashes
+   * are reused instead of being recomputed.
+   * @throw HashCalculationError, BlockHashCalculationFailure.
+   */
+  static Block FromVerifiedTransactions(
+      std::string iPreviousHash, const std::uint32_t iIndex,
+      std::vector<std::unique_ptr<Coinbase>> iCoinbases,
+      std::vector<std::unique_ptr<Payload>> iPayloads);
 
   [[nodiscard]] std::string getHash() const;
   [[nodiscard]] std::string getPreviousHash() const;
@@ -30,6 +92,7 @@ class Block {
   [[nodiscard]] std::string getMerkleRootHash() const;
   [[nodiscard]] std::uint32_t getNonce() const;
   [[nodiscard]] std::time_t getCreationTime() const;
+  [[nodiscard]] Header getHeader() const;
   [[nodiscard]] const std::optional<std::vector<std::unique_ptr<Coinbase>>>&
   getCoinbases() const;
   [[nodiscard]] const std::optional<std::vector<std::unique_ptr<Payload>>>&
@@ -48,8 +111,6 @@ class Block {
   std::optional<std::vector<std::unique_ptr<Coinbase>>> _coinbases{};
   std::vector<std::string> _transactionHashes{};
 
-  static constexpr std::string kTargetDifficulty{"00"};
-
   void initialize(
       std::optional<std::vector<std::unique_ptr<Coinbase>>>&& ioCoinbases,
       std::optional<std::vector<std::unique_ptr<Payload>>>&& ioPayloads);
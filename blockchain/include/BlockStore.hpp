@@ -0,0 +1,152 @@
+// author: georgiosmatzarapis
+
+#pragma once
+
+#include <cstdint>
+#include <expected>
+#include <filesystem>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace storage {
+
+struct BlockStoreOptions {
+  /**
+   * Maximum size of a segment file. Every segment is memory-mapped with this
+   * size up front, so that views handed out by the store stay valid while the
+   * segment grows.
+   */
+  std::uint64_t segmentSize{std::uint64_t{128} << 20};
+  /**
+   * Number of appended records after which the store is flushed to disk
+   * (group commit). A value of 1 flushes on every append.
+   */
+  std::uint32_t syncBatchSize{64};
+};
+
+/**
+ * @brief Append-only, segmented record store backing the chain.
+ * Records are framed with their length and a CRC-32C checksum inside segment
+ * files (blkNNNNN.dat), and located through a fixed-width offset index
+ * (index.dat). Segment files are the source of truth: on opening, a torn tail
+ * left by a crash is detected through the checksums and truncated, and the
+ * index is repaired accordingly.
+ * Reads are served from read-only memory mappings without copying.
+ * The oldest segments may be pruned: their files are deleted while their index
+ * entries are kept, so that record identifiers stay stable.
+ */
+class BlockStore {
+ public:
+  explicit BlockStore(std::filesystem::path directory,
+                      BlockStoreOptions options = BlockStoreOptions{});
+  ~BlockStore();
+
+  BlockStore(const BlockStore&) = delete;
+  BlockStore& operator=(const BlockStore&) = delete;
+  BlockStore(BlockStore&&) noexcept = delete;
+  BlockStore& operator=(BlockStore&&) noexcept = delete;
+
+  /**
+   * @brief Append a record at the end of the store.
+   * The record is durable once the next sync completes, either explicitly or
+   * when the sync batch is full.
+   * @param iRecord Record bytes.
+   * @return Identifier of the record, i.e. its position in the store.
+   */
+  std::expected<std::uint64_t, std::string> append(std::string_view iRecord);
+
+  /**
+   * @brief Access a record without copying it.
+   * The view remains valid as long as the store is open and the record is not
+   * truncated away.
+   * @param iRecordId Record identifier.
+   * @return View over the record bytes.
+   */
+  [[nodiscard]] std::expected<std::string_view, std::string>
+  read(const std::uint64_t iRecordId) const;
+
+  /**
+   * @brief Drop the records from iSize onwards, e.g. blocks replaced by a
+   * chain reorganisation. Views over dropped records become invalid.
+   * The change is flushed to disk before returning.
+   * @param iSize Number of records to keep.
+   * @return Nothing on success, otherwise the reason of the failure.
+   */
+  std::expected<void, std::string> truncate(const std::uint64_t iSize);
+
+  /**
+   * @brief Delete the oldest segments whose records all precede iKeepFrom.
+   * The last segment is never deleted. Reading a pruned record fails and views
+   * over pruned records become invalid.
+   * @param iKeepFrom Identifier of the oldest record to keep.
+   * @return Identifier of the oldest record still stored, otherwise the reason
+   * of the failure.
+   */
+  std::expected<std::uint64_t, std::string>
+  prune(const std::uint64_t iKeepFrom);
+
+  /**
+   * @return Number of records in the store, pruned ones included.
+   */
+  [[nodiscard]] std::uint64_t size() const;
+  /**
+   * @return Identifier of the oldest record that was not pruned.
+   */
+  [[nodiscard]] std::uint64_t getFirstRecord() const;
+  /**
+   * @brief Find where the most recent records fitting in a byte budget start.
+   * @param iMaxBytes Budget for the record bytes, framing excluded.
+   * @return Identifier of the oldest record of the tail, size() if not even
+   * the last record fits.
+   */
+  [[nodiscard]] std::uint64_t findTail(const std::uint64_t iMaxBytes) const;
+
+  /**
+   * @brief Flush appended records and their index entries to disk.
+   * @return Sync status.
+   */
+  bool sync();
+
+ private:
+  struct IndexEntry {
+    std::uint64_t offset{};
+    std::uint32_t segment{};
+    std::uint32_t length{};
+    std::uint32_t checksum{};
+  };
+
+  struct Segment {
+    int fileDescriptor{-1};
+    const char* mapping{};
+    std::uint64_t mappingSize{};
+    std::uint64_t size{};
+  };
+
+  std::filesystem::path _directory{};
+  BlockStoreOptions _options{};
+  /** Segments below this one were pruned; their entries are placeholders. */
+  std::uint32_t _firstSegment{};
+  std::vector<Segment> _segments{};
+  std::vector<IndexEntry> _index{};
+  int _indexFileDescriptor{-1};
+  std::uint32_t _unsyncedRecords{};
+  mutable std::shared_mutex _mutex{};
+
+  [[nodiscard]] std::filesystem::path
+  segmentPath(const std::uint32_t iSegment) const;
+  void openSegment(const std::uint32_t iSegment);
+  void closeSegment(Segment& ioSegment);
+  [[nodiscard]] std::uint64_t getFirstRecordLocked() const;
+  /**
+   * @brief Load the index, drop entries that do not point to a valid record
+   * and index valid records found past its end.
+   * @throw StorageError.
+   */
+  void recover();
+  [[nodiscard]] bool isRecordValid(const IndexEntry& iEntry) const;
+  bool writeIndexEntry(const std::uint64_t iRecordId, const IndexEntry& iEntry);
+  bool syncLocked();
+};
+} // namespace storage
@@ -0,0 +1,51 @@
+// author: georgiosmatzarapis
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "Block.hpp"
+#include "Chain.hpp"
+#include "Mempool.hpp"
+
+namespace mempool {
+
+struct TemplateOptions {
+  /** Budget for the encoded size of the selected payloads, in bytes. */
+  std::size_t maxBytes{std::size_t{1} << 20};
+  /** Maximum number of selected payloads. */
+  std::size_t maxPayloads{10000};
+  /** Reward of the coinbase paying the miner, in bitcoin. */
+  double coinbaseReward{6.25};
+};
+
+struct BlockTemplate {
+  block::Block block;
+  /** Sum of the fees offered by the selected payloads, in satoshi. */
+  std::uint64_t fees{};
+  /** Encoded size of the selected payloads, in bytes. */
+  std::size_t bytes{};
+};
+
+/**
+ * @brief Pack the next block of the chain from the mempool.
+ * Payloads are selected greedily from the highest fee rate down while they fit
+ * in the budget. Payloads of the same owner are kept in admission order, and
+ * a payload is only selected if its owner can afford it with the confirmed
+ * balance plus what the owner receives from payloads selected before it.
+ * The hashes verified on admission are reused for mining the block.
+ * @param iMempool Pool to select payloads from.
+ * @param iChain Chain the block extends.
+ * @param iMiner Owner of the coinbase.
+ * @param iOptions Block budget and reward.
+ * @return Mined block along with its fees and size.
+ * @throw HashCalculationError, BlockHashCalculationFailure.
+ */
+BlockTemplate BuildBlockTemplate(const Mempool& iMempool,
+                                 const chain::Chain& iChain,
+                                 const std::string& iMiner,
+                                 const TemplateOptions& iOptions =
+                                     TemplateOptions{});
+} // namespace mempool
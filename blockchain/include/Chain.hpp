@@ -0,0 +1,209 @@
+// author: georgiosmatzarapis
+
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <expected>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "Block.hpp"
+#include "BlockStore.hpp"
+#include "IChainObserver.hpp"
+#include "Ledger.hpp"
+
+namespace chain {
+
+struct PruningOptions {
+  /**
+   * Number of most recent blocks whose body is kept. A value of 0 disables
+   * this limit.
+   */
+  std::uint32_t keepBlocks{};
+  /**
+   * Budget for the bodies of the most recent blocks, in bytes. A value of 0
+   * disables this limit.
+   */
+  std::uint64_t keepBytes{};
+};
+
+struct ChainOptions {
+  storage::BlockStoreOptions store{};
+  /**
+   * Number of blocks between two ledger snapshots. On opening, the chain
+   * restores the newest snapshot matching the stored blocks and only replays
+   * the blocks appended after it. A value of 0 disables snapshots.
+   */
+  std::uint32_t snapshotInterval{1000};
+  /**
+   * Deepest reorganisation the chain accepts, in blocks below the tip. Side
+   * branches forking deeper are dropped, and undo records are kept for that
+   * many blocks.
+   */
+  std::uint32_t maxReorgDepth{100};
+  /**
+   * Bodies of old blocks to drop, by whole store segments, once a snapshot
+   * covers them. Headers are kept for the whole chain. Without any limit set,
+   * nothing is pruned; with both set, a block is kept while within either.
+   */
+  PruningOptions pruning{};
+};
+
+/**
+ * @brief Ordered container of the blocks that form the chain.
+ * Blocks of the active chain are persisted in a storage::BlockStore and read
+ * back on demand, so that the history does not need to fit in memory. Only
+ * the block hashes, the ledger state resulting from the blocks and recent
+ * side branches are kept in memory; the ledger is restored from the latest
+ * snapshot and the blocks stored after it when the chain is opened.
+ * Headers are stored apart from the blocks, so that the bodies of old blocks
+ * can be pruned while the whole chain stays linked.
+ * Competing branches are kept aside until one of them has more cumulative
+ * work than the active chain, which then reorganises onto it.
+ */
+class Chain {
+ public:
+  explicit Chain(const std::filesystem::path& directory,
+                 ChainOptions options = ChainOptions{});
+
+  Chain(const Chain&) = delete;
+  Chain& operator=(const Chain&) = delete;
+  Chain(Chain&&) noexcept = delete;
+  Chain& operator=(Chain&&) noexcept = delete;
+
+  /**
+   * @brief Add a block on top of a known block.
+   * The block index must follow the one of its parent. A block extending the
+   * tip is connected straight away: except for the genesis block, its previous
+   * hash must match the hash of the tip and its payloads must not spend more
+   * than the balance of their owners. A block extending another block is kept
+   * on a side branch, and the chain reorganises onto that branch once it has
+   * more cumulative work.
+   * @param iBlock Block to add.
+   * @return Nothing on success, otherwise the reason of the rejection.
+   * @throw StorageError, if the store fails in the middle of a reorganisation.
+   */
+  std::expected<void, std::string> append(const block::Block& iBlock);
+
+  /**
+   * @brief Register an observer of the active chain. It must outlive the
+   * chain or be removed before being destroyed.
+   */
+  void addObserver(IObserver& iObserver);
+  void removeObserver(IObserver& iObserver);
+
+  /**
+   * @return Number of blocks in the chain.
+   */
+  [[nodiscard]] std::uint32_t getLength() const;
+  [[nodiscard]] std::optional<std::string> getTipHash() const;
+  /**
+   * @return Cumulative work of the active chain.
+   */
+  [[nodiscard]] std::uint64_t getWork() const;
+  [[nodiscard]] const ledger::Ledger& getLedger() const;
+  /**
+   * @return Height of a block of the active chain.
+   */
+  [[nodiscard]] std::optional<std::uint32_t>
+  findHeight(const std::string& iHash) const;
+
+  /**
+   * @brief Restore a block of the chain from storage.
+   * @param iHeight Position of the block in the chain.
+   */
+  [[nodiscard]] std::expected<block::Block, std::string>
+  getBlock(const std::uint32_t iHeight) const;
+  /**
+   * @brief Restore the header of a block, available even if it was pruned.
+   * @param iHeight Position of the block in the chain.
+   */
+  [[nodiscard]] std::expected<block::Header, std::string>
+  getHeader(const std::uint32_t iHeight) const;
+  /**
+   * @return Height of the oldest block whose body was not pruned.
+   */
+  [[nodiscard]] std::uint32_t getFirstBlockHeight() const;
+  /**
+   * @brief Access the stored record of a block without copying it.
+   * @param iHeight Position of the block in the chain.
+   */
+  [[nodiscard]] std::expected<std::string_view, std::string>
+  getRawBlock(const std::uint32_t iHeight) const;
+
+  /**
+   * @brief Flush pending blocks to disk.
+   * @return Sync status.
+   */
+  bool sync();
+
+ private:
+  /**
+   * @brief Block off the active chain, kept encoded until a reorganisation
+   * needs it.
+   */
+  struct SideBlock {
+    std::string record{};
+    std::string previousHash{};
+    std::uint32_t height{};
+    std::uint64_t chainWork{};
+  };
+
+  std::filesystem::path _directory{};
+  ChainOptions _options{};
+  storage::BlockStore _store;
+  storage::BlockStore _headers;
+  ledger::Ledger _ledger{};
+  /** Hashes of the active chain, by height. */
+  std::vector<std::string> _hashes{};
+  std::unordered_map<std::string, std::uint32_t> _heights{};
+  /** Cumulative work of the active chain up to each height. */
+  std::vector<std::uint64_t> _chainWork{};
+  /** Undo records of the most recent blocks of the active chain. */
+  std::deque<ledger::UndoRecord> _undoRecords{};
+  std::unordered_map<std::string, SideBlock> _sideBlocks{};
+  std::vector<IObserver*> _observers{};
+  /** Chain lengths of the snapshots kept on disk, oldest first. */
+  std::deque<std::uint32_t> _snapshotLengths{};
+
+  /**
+   * @brief Restore the ledger from the newest usable snapshot.
+   * @return Chain length covered by the snapshot, 0 if none is usable.
+   */
+  std::uint32_t restoreSnapshot();
+  void writeSnapshot();
+  /**
+   * @brief Bring the header store in line with the block store, which may be
+   * ahead of it or on another branch after a crash.
+   * @throw StorageError.
+   */
+  void repairHeaders();
+  /**
+   * @brief Drop the bodies of the blocks outside the pruning limits. Blocks
+   * the oldest snapshot or a reorganisation would need are kept.
+   */
+  void pruneBlocks();
+
+  std::expected<void, std::string> connectTip(const block::Block& iBlock);
+  /**
+   * @brief Switch the active chain to the side branch ending at iTipHash.
+   * Only the blocks above the fork point are disconnected and connected.
+   */
+  std::expected<void, std::string> reorganize(const std::string& iTipHash);
+  /**
+   * @brief Revert the tip in the ledger, through its undo record if kept.
+   */
+  std::expected<void, std::string> disconnectTip(const block::Block& iBlock);
+  void pushActive(const std::string& iHash, const block::Header& iHeader);
+  void pushUndo(ledger::UndoRecord&& ioUndo);
+  /**
+   * @brief Drop side blocks too deep below the tip to be reorganised to.
+   */
+  void pruneSideBlocks();
+};
+} // namespace chain
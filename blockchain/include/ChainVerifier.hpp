@@ -0,0 +1,66 @@
+// author: georgiosmatzarapis
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <string>
+
+#include "Chain.hpp"
+
+namespace chain {
+
+struct VerificationProgress {
+  std::uint32_t verifiedBlocks{};
+  std::uint32_t totalBlocks{};
+  std::uint64_t verifiedTransactions{};
+  std::chrono::milliseconds elapsed{};
+  double blocksPerSecond{};
+  double transactionsPerSecond{};
+};
+
+struct VerificationReport {
+  bool isValid{};
+  /** Lowest height that failed verification, if any. */
+  std::optional<std::uint32_t> invalidHeight{};
+  std::string error{};
+  VerificationProgress progress{};
+};
+
+/**
+ * @brief Re-verify the stored history of a chain, e.g. on restart.
+ * Block-local checks (transaction hashes, Merkle root, proof-of-work) are
+ * independent and spread across worker threads; previous hash links are
+ * checked afterwards in a single sequential pass. Blocks whose body was
+ * pruned only have their header checked.
+ */
+class ChainVerifier {
+ public:
+  using ProgressCallback = std::function<void(const VerificationProgress&)>;
+
+  /**
+   * @param chain Chain to verify. It must not be appended to while verifying.
+   * @param threads Number of worker threads. Zero uses one per core.
+   * @param progressInterval Interval between two progress reports.
+   */
+  explicit ChainVerifier(const Chain& chain, const unsigned int threads = 0,
+                         const std::chrono::milliseconds progressInterval =
+                             std::chrono::milliseconds{1000});
+
+  /**
+   * @brief Verify every block of the chain.
+   * Verification stops at the first invalid block found.
+   * @param iOnProgress Called periodically from the calling thread, and once
+   * more when the block-local checks are done.
+   * @return Verification outcome and throughput metrics.
+   */
+  VerificationReport run(const ProgressCallback& iOnProgress = {}) const;
+
+ private:
+  const Chain& _chain;
+  unsigned int _threads{};
+  std::chrono::milliseconds _progressInterval{};
+};
+} // namespace chain
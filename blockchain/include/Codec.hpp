@@ -0,0 +1,59 @@
+// author: georgiosmatzarapis
+
+#pragma once
+
+#include <expected>
+#include <string>
+#include <string_view>
+
+#include "Block.hpp"
+
+namespace block {
+namespace codec {
+/**
+ * @brief Serialize a block, including its transactions and their hashes, into
+ * a self-contained binary record.
+ * Transactions are compressed: owners are written once per block in a
+ * dictionary, amounts as varints of satoshi, and timestamps as varint offsets
+ * from the creation time of the block.
+ * @param iBlock Block to serialize.
+ * @return Binary record.
+ */
+std::string Encode(const Block& iBlock);
+
+/**
+ * @brief Serialize only the header of a block, as a record without
+ * transactions that DecodeHeader and Decode both accept.
+ * @param iHeader Header to serialize.
+ * @return Binary record.
+ */
+std::string EncodeHeader(const Header& iHeader);
+
+/**
+ * @brief Restore a block from a record produced by Encode, in a single pass.
+ * Records written before compression was introduced are still accepted.
+ * The block is not re-mined nor re-validated.
+ * @param iRecord Binary record.
+ * @return Restored block or a description of the decoding failure.
+ */
+std::expected<Block, std::string> Decode(std::string_view iRecord);
+
+/**
+ * @brief Restore only the header of a block from a record produced by Encode
+ * or EncodeHeader, skipping its transactions.
+ * @param iRecord Binary record.
+ * @return Block header or a description of the decoding failure.
+ */
+std::expected<Header, std::string> DecodeHeader(std::string_view iRecord);
+
+/**
+ * @brief Estimate the number of bytes a payload takes in an encoded block,
+ * conservatively: amounts and timestamps are counted at their full width and
+ * owners as if they were not shared with other transactions.
+ * @param iPayload Payload to measure.
+ * @param iHash Hash of the payload.
+ * @return Encoded size in bytes.
+ */
+std::size_t EncodedSize(const Payload& iPayload, const std::string& iHash);
+} // namespace codec
+} // namespace block
@@ -37,6 +37,12 @@ class BlockHashCalculationFailure final : public std::runtime_error {
   explicit BlockHashCalculationFailure(const std::string& message);
   const char* what() const noexcept override;
 };
+
+class StorageError final : public std::runtime_error {
+ public:
+  explicit StorageError(const std::string& message);
+  const char* what() const noexcept override;
+};
 } // namespace exception
 
 } // namespace core_lib
@@ -0,0 +1,53 @@
+// author: georgiosmatzarapis
+
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <unordered_map>
+
+namespace mempool {
+
+struct Entry;
+
+/**
+ * @brief Per-owner running total of what pending payloads spend.
+ * Checking a new payload against the confirmed balance of its owner is a
+ * single hash lookup, so that double spends are rejected on admission rather
+ * than found by scanning the pool when a block is built.
+ */
+class ConflictIndex {
+ public:
+  /**
+   * @brief Check whether the owner can afford one more payload.
+   * @param iOwner Owner of the payload.
+   * @param iAmount Amount of the payload, in satoshi.
+   * @param iConfirmedBalance Balance of the owner in the chain, in satoshi.
+   */
+  [[nodiscard]] bool canSpend(const std::string& iOwner,
+                              const std::uint64_t iAmount,
+                              const std::uint64_t iConfirmedBalance) const;
+
+  void add(const Entry& iEntry);
+  void remove(const Entry& iEntry);
+
+  /**
+   * @return Amount spent by the pending payloads of the owner, in satoshi.
+   */
+  [[nodiscard]] std::uint64_t getPendingSpend(const std::string& iOwner) const;
+  /**
+   * @return Most recently admitted pending payload of the owner, if any.
+   */
+  [[nodiscard]] const Entry* getNewest(const std::string& iOwner) const;
+
+ private:
+  struct OwnerSpend {
+    std::uint64_t amount{};
+    /** Pending payloads of the owner by admission order. */
+    std::map<std::uint64_t, const Entry*> entries{};
+  };
+
+  std::unordered_map<std::string, OwnerSpend> _owners{};
+};
+} // namespace mempool
@@ -0,0 +1,21 @@
+// author: georgiosmatzarapis
+
+#pragma once
+
+#include "Block.hpp"
+
+namespace chain {
+/**
+ * @brief Receiver of the changes of the active chain, e.g. to keep a mempool
+ * or an index in line with it. Notifications are delivered on the thread
+ * appending to the chain; during a reorganisation, every disconnected block
+ * is notified, tip first, before the blocks of the new branch.
+ */
+class IObserver {
+ public:
+  virtual void onBlockConnected(const block::Block& iBlock) = 0;
+  virtual void onBlockDisconnected(const block::Block& iBlock) = 0;
+
+  virtual ~IObserver() = default;
+};
+} // namespace chain
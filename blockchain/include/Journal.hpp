@@ -0,0 +1,181 @@
+// author: georgiosmatzarapis
+
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <expected>
+#include <filesystem>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+
+#include "User.hpp"
+
+namespace user {
+
+struct JournalOptions {
+  /**
+   * Number of appended records after which the log is flushed to disk (group
+   * commit). A value of 1 flushes on every append.
+   */
+  std::uint32_t syncBatchSize{64};
+  /**
+   * Number of appended records after which a snapshot is due, so that the log
+   * to replay on opening stays short. A value of 0 disables snapshots.
+   */
+  std::uint64_t snapshotInterval{std::uint64_t{1} << 20};
+  /**
+   * Longest time appended records stay unflushed while the sync batch is not
+   * full, e.g. once appends stop. A value of 0 disables the bound.
+   */
+  std::chrono::milliseconds syncInterval{100};
+};
+
+/**
+ * @brief Write-ahead log and snapshots persisting the user database.
+ * Changes are appended to log-<sequence>.dat as records framed with their
+ * length and a CRC-32C checksum, each replayed all or nothing. A snapshot
+ * (snapshot-<sequence>.bin) holds every profile at the point the log of the
+ * same sequence was started, so the older logs and snapshots are deleted once
+ * it is written. On recovery, the newest snapshot is loaded and only the logs
+ * that follow it are replayed; a torn record left by a crash ends the replay
+ * and is truncated away. A damaged snapshot fails the recovery, unless the
+ * older state and every log following it are still on disk.
+ * Safe to use from any thread.
+ */
+class Journal {
+ public:
+  /**
+   * @brief Profile changes logged as a single record.
+   */
+  class Batch {
+   public:
+    void put(const ProfileId iProfileId, const Profile& iProfile);
+    void remove(const ProfileId iProfileId);
+    [[nodiscard]] bool empty() const;
+    /**
+     * @brief Drop the changes, keeping the memory for the next ones.
+     */
+    void clear();
+
+   private:
+    friend class Journal;
+
+    std::string _bytes{};
+  };
+
+  /**
+   * @param directory Directory of the log and snapshot files, created if
+   * missing.
+   * @throw StorageError, if the directory cannot be created.
+   */
+  explicit Journal(std::filesystem::path directory,
+                   JournalOptions options = JournalOptions{});
+  ~Journal();
+
+  Journal(const Journal&) = delete;
+  Journal& operator=(const Journal&) = delete;
+  Journal(Journal&&) noexcept = delete;
+  Journal& operator=(Journal&&) noexcept = delete;
+
+  /**
+   * @brief Replay the newest snapshot and the logs that follow it, then start
+   * a new log. Must be called once, before anything is appended.
+   * Fails if the newest snapshot is damaged and the logs it replaced are gone,
+   * rather than recovering an older state.
+   * @param iApply Called in order with each profile id and its state, nullopt
+   * when it was removed.
+   * @return Next profile id to issue, otherwise the reason of the failure.
+   */
+  std::expected<ProfileId, std::string> recover(
+      const std::function<void(ProfileId, std::optional<Profile>&&)>& iApply);
+
+  /**
+   * @brief Append a batch to the log. It is durable once the next sync
+   * completes, either explicitly, when the sync batch is full or after the
+   * sync interval. A failed append leaves nothing of the batch in the log; if
+   * the log cannot be restored or flushed, further appends are refused.
+   * @return Nothing on success, otherwise the reason of the failure.
+   */
+  std::expected<void, std::string> append(const Batch& iBatch);
+
+  /**
+   * @brief Flush appended records to disk.
+   * @return Sync status.
+   */
+  bool sync();
+
+  /**
+   * @return Whether enough records were appended since the last snapshot.
+   */
+  [[nodiscard]] bool isSnapshotDue() const;
+
+  /**
+   * @brief Start a new log that the next snapshot will be followed by.
+   * Must be called while no change can be appended, with the returned
+   * sequence passed to writeSnapshot along with the profiles at that point.
+   * @return Sequence of the snapshot, otherwise the reason of the failure.
+   */
+  std::expected<std::uint64_t, std::string> rotate();
+
+  /**
+   * @brief Persist a snapshot and delete the logs and snapshots it replaces.
+   * @param iSequence Sequence returned by rotate.
+   * @param iNextProfileId Next profile id to issue.
+   * @param iProfiles Every profile at the time of the rotation.
+   * @return Nothing on success, otherwise the reason of the failure.
+   */
+  std::expected<void, std::string>
+  writeSnapshot(const std::uint64_t iSequence, const ProfileId iNextProfileId,
+                const Batch& iProfiles);
+
+ private:
+  std::filesystem::path _directory{};
+  JournalOptions _options{};
+  std::uint64_t _sequence{};
+  int _fileDescriptor{-1};
+  std::uint32_t _unsyncedRecords{};
+  std::uint64_t _recordsSinceSnapshot{};
+  /** Set once the log may hold records that were reported as failed. */
+  bool _isFailed{};
+  mutable std::mutex _mutex{};
+  std::condition_variable_any _syncCondition{};
+  /** Serialises snapshot writes, apart from appends. */
+  std::mutex _snapshotMutex{};
+  /** Flushes the log every sync interval, if enabled. */
+  std::jthread _syncer{};
+
+  /**
+   * @brief Decode the changes of a batch, without applying any of them unless
+   * the whole batch is valid.
+   * @param ioNextProfileId Raised above the ids of the changes.
+   * @return Decoding status.
+   */
+  static bool ReplayBatch(
+      std::string_view iBytes, ProfileId& ioNextProfileId,
+      const std::function<void(ProfileId, std::optional<Profile>&&)>& iApply);
+  [[nodiscard]] std::filesystem::path
+  logPath(const std::uint64_t iSequence) const;
+  [[nodiscard]] std::filesystem::path
+  snapshotPath(const std::uint64_t iSequence) const;
+  /**
+   * @brief Close the current log, if any, and start the one of iSequence.
+   */
+  std::expected<void, std::string> openLog(const std::uint64_t iSequence);
+  bool syncLocked();
+  /**
+   * @brief Cut the log back to a given size, dropping a partly written frame.
+   */
+  void truncateLocked(const std::int64_t iSize);
+  void syncPeriodically(const std::stop_token iStopToken);
+  /**
+   * @brief Delete the logs and snapshots preceding the given sequence.
+   */
+  void removeBefore(const std::uint64_t iSequence);
+};
+} // namespace user
@@ -0,0 +1,103 @@
+// author: georgiosmatzarapis
+
+#pragma once
+
+#include <cstdint>
+#include <expected>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "Block.hpp"
+#include "OwnerTable.hpp"
+
+namespace ledger {
+
+/**
+ * @brief Compact record of what connecting a block changed in the ledger,
+ * i.e. the net balance change of each owner it touched, to revert the block
+ * without reading its transactions again.
+ */
+struct UndoRecord {
+  std::vector<std::pair<OwnerId, std::int64_t>> changes{};
+};
+
+/**
+ * @brief Per-owner balances, in satoshi, resulting from the connected blocks.
+ * Coinbases credit their owner; payloads move their amount from the owner to
+ * the receiver. Balances are stored in a vector indexed by interned owner, so
+ * queries are O(1) and connecting a block does not allocate per transaction.
+ */
+class Ledger {
+ public:
+  Ledger();
+
+  Ledger(const Ledger&) = delete;
+  Ledger& operator=(const Ledger&) = delete;
+  Ledger(Ledger&&) noexcept = default;
+  Ledger& operator=(Ledger&&) noexcept = default;
+
+  /**
+   * @brief Apply the transactions of a block, coinbases first.
+   * The block is applied atomically: if any payload spends more than the
+   * balance of its owner at that point, the ledger is left untouched.
+   * @param iBlock Block to apply.
+   * @return Nothing on success, otherwise the reason of the rejection.
+   */
+  std::expected<void, std::string> connect(const block::Block& iBlock);
+  /**
+   * @brief Apply the transactions of a block and record how to revert them.
+   * @param iBlock Block to apply.
+   * @param ioUndo Filled with the net balance changes, on success.
+   * @return Nothing on success, otherwise the reason of the rejection.
+   */
+  std::expected<void, std::string> connect(const block::Block& iBlock,
+                                           UndoRecord& ioUndo);
+
+  /**
+   * @brief Revert a block previously applied with connect.
+   * Blocks must be disconnected in the reverse order of their connection.
+   * @param iBlock Block to revert.
+   * @return Nothing on success, otherwise the reason of the failure.
+   */
+  std::expected<void, std::string> disconnect(const block::Block& iBlock);
+  /**
+   * @brief Revert a block through the undo record of its connection.
+   * Blocks must be reverted in the reverse order of their connection.
+   * @param iUndo Undo record filled by connect.
+   * @return Nothing on success, otherwise the reason of the failure.
+   */
+  std::expected<void, std::string> undo(const UndoRecord& iUndo);
+
+  /**
+   * @brief Set the balance of an owner, e.g. when loading a snapshot.
+   * @param iOwner Owner name.
+   * @param iBalance Balance in satoshi.
+   */
+  void restore(std::string_view iOwner, const std::uint64_t iBalance);
+
+  /**
+   * @brief Size the ledger for iOwners owners.
+   */
+  void reserve(const std::size_t iOwners);
+
+  /**
+   * @return Balance of the owner, zero if the owner is unknown.
+   */
+  [[nodiscard]] std::uint64_t getBalance(std::string_view iOwner) const;
+  [[nodiscard]] std::uint64_t getBalance(const OwnerId iOwnerId) const;
+  [[nodiscard]] const OwnerTable& getOwners() const;
+
+ private:
+  OwnerTable _owners{};
+  std::vector<std::uint64_t> _balances{};
+  /** Balance changes of the block being applied, kept to roll them back. */
+  std::vector<std::pair<OwnerId, std::int64_t>> _journal{};
+
+  OwnerId intern(std::string_view iOwner);
+  bool credit(const OwnerId iOwnerId, const std::uint64_t iAmount);
+  bool debit(const OwnerId iOwnerId, const std::uint64_t iAmount);
+  void rollback();
+};
+} // namespace ledger
@@ -0,0 +1,167 @@
+// author: georgiosmatzarapis
+
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <set>
+#include <string>
+#include <unordered_map>
+
+#include "Block.hpp"
+#include "BloomFilter.hpp"
+#include "ConflictIndex.hpp"
+#include "IChainObserver.hpp"
+#include "Ledger.hpp"
+#include "MpscQueue.hpp"
+#include "Transaction.hpp"
+
+namespace mempool {
+
+struct MempoolOptions {
+  /**
+   * Upper bound of the encoded size of the pooled payloads. Once exceeded,
+   * the payloads with the lowest fee rate are evicted.
+   */
+  std::size_t maxBytes{std::size_t{64} << 20};
+  /** Number of payloads the filter is first sized for; it grows after. */
+  std::size_t expectedPayloads{std::size_t{1} << 16};
+  /** False positive rate the filter is sized for. */
+  double falsePositiveRate{0.01};
+};
+
+/**
+ * @brief Payload waiting in the pool, along with what was computed about it
+ * on admission.
+ */
+struct Entry {
+  transaction::Payload payload;
+  /** Verified hash of the payload. */
+  std::string hash{};
+  /** Fee offered for the payload, in satoshi. */
+  std::uint64_t fee{};
+  /** Encoded size of the payload, in bytes. */
+  std::uint32_t size{};
+  /** Admission order, to break fee rate ties in favour of older payloads. */
+  std::uint64_t sequence{};
+};
+
+/**
+ * @brief Staging area for payloads waiting to be included in a block.
+ * Payloads may be submitted from any thread through a lock-free queue; they
+ * are admitted by the consumer thread when it calls process, which verifies
+ * each hash once, drops duplicates and orders the payloads by fee rate.
+ * When given the ledger of the chain, the pool also rejects payloads whose
+ * owner cannot afford them on top of its other pending payloads.
+ * Like the transaction index, a Bloom filter sits in front of the pooled
+ * payloads, so that lookups of unknown hashes, e.g. duplicate checks, are
+ * mostly answered without probing the pool. It is rebuilt from the pooled
+ * payloads once the admitted ones, dropped ones included, outgrow its size.
+ * Registered as an observer of the chain, the pool follows reorganisations:
+ * payloads of disconnected blocks are admitted back and payloads of connected
+ * blocks are dropped.
+ * Except for submit, methods must only be called from the consumer thread.
+ */
+class Mempool final : public chain::IObserver {
+ public:
+  explicit Mempool(MempoolOptions options = MempoolOptions{});
+  /**
+   * @param ledger Confirmed balances the pending payloads are checked
+   * against. Must outlive the pool.
+   */
+  explicit Mempool(const ledger::Ledger& ledger,
+                   MempoolOptions options = MempoolOptions{});
+
+  Mempool(const Mempool&) = delete;
+  Mempool& operator=(const Mempool&) = delete;
+  Mempool(Mempool&&) noexcept = delete;
+  Mempool& operator=(Mempool&&) noexcept = delete;
+
+  /**
+   * @brief Queue a payload for admission. Safe to call from any thread.
+   * @param iPayload Payload. When it carries a hash, the hash is verified.
+   * @param iFee Fee offered for the payload, in satoshi.
+   */
+  void submit(transaction::Payload iPayload, const std::uint64_t iFee);
+
+  /**
+   * @brief Admit the queued payloads.
+   * Payloads with an inconsistent hash, already pooled, overspending their
+   * owner balance, or with a fee rate too low to fit in a full pool are
+   * dropped.
+   * @return Number of admitted payloads.
+   */
+  std::size_t process();
+
+  /**
+   * @brief Drop the payloads included in a block.
+   * The ledger is expected to reflect the block already. Owners spending in
+   * the block whose pending payloads no longer fit their balance lose their
+   * most recent payloads.
+   */
+  void removeForBlock(const block::Block& iBlock);
+  bool remove(const std::string& iHash);
+
+  void onBlockConnected(const block::Block& iBlock) override;
+  /**
+   * @brief Admit back the payloads of a block leaving the active chain.
+   * Their original fee is not known anymore, so they are pooled without fee.
+   */
+  void onBlockDisconnected(const block::Block& iBlock) override;
+
+  [[nodiscard]] bool contains(const std::string& iHash) const;
+  [[nodiscard]] const Entry* find(const std::string& iHash) const;
+  [[nodiscard]] std::size_t size() const;
+  /**
+   * @return Amount spent by the pooled payloads of the owner, in satoshi.
+   */
+  [[nodiscard]] std::uint64_t getPendingSpend(const std::string& iOwner) const;
+  /**
+   * @return Encoded size of the pooled payloads, in bytes.
+   */
+  [[nodiscard]] std::size_t getBytes() const;
+
+  /**
+   * @brief Visit the pooled payloads from the highest to the lowest fee rate.
+   * @param iVisitor Called for each entry; returning false stops the visit.
+   */
+  void forEachByFeeRate(
+      const std::function<bool(const Entry&)>& iVisitor) const;
+
+ private:
+  struct Submission {
+    transaction::Payload payload;
+    std::uint64_t fee{};
+  };
+
+  struct ByFeeRate {
+    bool operator()(const Entry* iLeft, const Entry* iRight) const;
+  };
+
+  MempoolOptions _options{};
+  const ledger::Ledger* _ledger{};
+  utils::MpscQueue<Submission> _queue{};
+  std::unordered_map<std::string, Entry> _entries{};
+  std::set<const Entry*, ByFeeRate> _byFeeRate{};
+  ConflictIndex _conflicts{};
+  utils::BloomFilter _filter;
+  /** Payloads added to the filter since it was last rebuilt. */
+  std::size_t _filterItems{};
+  std::size_t _filterCapacity{};
+  std::size_t _bytes{};
+  std::uint64_t _nextSequence{};
+
+  /**
+   * @brief Verify, deduplicate and insert a submitted payload.
+   * @return Whether the payload was admitted.
+   */
+  bool admit(Submission&& ioSubmission);
+  void erase(std::unordered_map<std::string, Entry>::iterator iEntry);
+  void evict();
+  /**
+   * @return Whether a payload of the given hash is pooled.
+   */
+  [[nodiscard]] bool isPooled(const std::string& iHash) const;
+  void addToFilter(const std::string& iHash);
+};
+} // namespace mempool
@@ -0,0 +1,117 @@
+// author: georgiosmatzarapis
+
+#pragma once
+
+#include <cstdint>
+#include <expected>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "Chain.hpp"
+#include "IChainObserver.hpp"
+#include "OwnerTable.hpp"
+
+namespace chain {
+
+/**
+ * @brief Location of a transaction in the active chain.
+ */
+struct Posting {
+  std::uint32_t height{};
+  /** Position in the block, coinbases first, then payloads. */
+  std::uint32_t position{};
+
+  bool operator==(const Posting&) const = default;
+};
+
+struct HistoryPage {
+  /** Postings of the page, oldest first. */
+  std::vector<Posting> postings{};
+  /** Start of the next page, if any. */
+  std::optional<std::size_t> next{};
+};
+
+/**
+ * @brief Index of the transactions of every owner, as sender, receiver or
+ * miner, answering history queries without walking the blocks.
+ * Each owner has a posting list in which postings are delta-encoded against
+ * the previous one as varints, a few bytes each. Every kSkipInterval postings
+ * a skip entry records where decoding can resume, so that any page is
+ * reached by decoding at most kSkipInterval postings.
+ * Registered as an observer of the chain, the index follows reorganisations.
+ */
+class OwnerHistoryIndex final : public IObserver {
+ public:
+  OwnerHistoryIndex() = default;
+
+  OwnerHistoryIndex(const OwnerHistoryIndex&) = delete;
+  OwnerHistoryIndex& operator=(const OwnerHistoryIndex&) = delete;
+  OwnerHistoryIndex(OwnerHistoryIndex&&) noexcept = delete;
+  OwnerHistoryIndex& operator=(OwnerHistoryIndex&&) noexcept = delete;
+
+  /**
+   * @brief Index the transactions of the stored blocks of a chain. Blocks
+   * whose body was pruned are skipped.
+   * @param iChain Chain to index.
+   * @return Nothing on success, otherwise the reason of the failure.
+   */
+  std::expected<void, std::string> build(const Chain& iChain);
+
+  void onBlockConnected(const block::Block& iBlock) override;
+  void onBlockDisconnected(const block::Block& iBlock) override;
+
+  /**
+   * @brief Page through the transactions of an owner.
+   * @param iOwner Owner name.
+   * @param iStart Index of the first posting of the page.
+   * @param iLimit Maximum number of postings of the page.
+   */
+  [[nodiscard]] HistoryPage getHistory(std::string_view iOwner,
+                                       const std::size_t iStart,
+                                       const std::size_t iLimit) const;
+  /**
+   * @return Number of transactions of the owner.
+   */
+  [[nodiscard]] std::size_t getCount(std::string_view iOwner) const;
+  /**
+   * @return Size of the posting lists, in bytes.
+   */
+  [[nodiscard]] std::size_t getBytes() const;
+
+ private:
+  static constexpr std::size_t kSkipInterval{64};
+
+  /**
+   * @brief Decoding state right before a posting.
+   */
+  struct Cursor {
+    std::size_t offset{};
+    std::size_t index{};
+    Posting previous{};
+  };
+
+  struct PostingList {
+    std::string bytes{};
+    std::size_t count{};
+    Posting last{};
+    /** Cursors before postings 0, kSkipInterval, 2 * kSkipInterval... */
+    std::vector<Cursor> skips{};
+  };
+
+  ledger::OwnerTable _owners{};
+  std::vector<PostingList> _lists{};
+  std::size_t _bytes{};
+
+  void add(std::string_view iOwner, const Posting& iPosting);
+  /**
+   * @brief Drop the postings of the list from iHeight onwards.
+   */
+  void truncate(PostingList& ioList, const std::uint32_t iHeight);
+  /**
+   * @brief Decode the posting under the cursor and move past it.
+   */
+  static Posting next(const PostingList& iList, Cursor& ioCursor);
+};
+} // namespace chain
@@ -0,0 +1,64 @@
+// author: georgiosmatzarapis
+
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace ledger {
+
+using OwnerId = std::uint32_t;
+
+/**
+ * @brief Intern owner names into dense identifiers.
+ * Names are looked up through an open-addressing table with linear probing,
+ * so that per-owner state can live in plain vectors indexed by OwnerId.
+ */
+class OwnerTable {
+ public:
+  OwnerTable();
+
+  /**
+   * @brief Find the identifier of an owner, registering it if unknown.
+   * @param iOwner Owner name.
+   * @return Owner identifier.
+   */
+  OwnerId intern(std::string_view iOwner);
+
+  /**
+   * @param iOwner Owner name.
+   * @return Owner identifier, if the owner is known.
+   */
+  [[nodiscard]] std::optional<OwnerId> find(std::string_view iOwner) const;
+
+  /**
+   * @return Name of a known owner. The reference is invalidated by intern.
+   */
+  [[nodiscard]] const std::string& getName(const OwnerId iOwnerId) const;
+
+  [[nodiscard]] std::size_t size() const;
+
+  /**
+   * @brief Size the table for iOwners owners without further rehashing.
+   */
+  void reserve(const std::size_t iOwners);
+
+ private:
+  struct Slot {
+    std::uint64_t hash{};
+    OwnerId ownerId{kEmptySlot};
+  };
+
+  static constexpr OwnerId kEmptySlot{~OwnerId{}};
+
+  std::vector<Slot> _slots{};
+  std::vector<std::string> _names{};
+
+  [[nodiscard]] std::size_t findSlot(std::string_view iOwner,
+                                     const std::uint64_t iHash) const;
+  void rehash(const std::size_t iSlotCount);
+};
+} // namespace ledger
@@ -0,0 +1,49 @@
+// author: georgiosmatzarapis
+
+#pragma once
+
+#include <cstdint>
+#include <expected>
+#include <filesystem>
+#include <functional>
+#include <string>
+
+#include "Ledger.hpp"
+
+namespace ledger {
+
+struct Snapshot {
+  Ledger ledger{};
+  /** Number of blocks whose transactions are reflected in the ledger. */
+  std::uint32_t chainLength{};
+  std::string tipHash{};
+};
+
+/**
+ * @brief Persist the ledger state reached at a given chain length.
+ * The snapshot is written to a temporary file, flushed and atomically renamed
+ * to snapshot-<chainLength>.bin. Only the newest iKeep snapshots are kept.
+ * @param iDirectory Directory of the chain data.
+ * @param iLedger Ledger state to persist.
+ * @param iChainLength Number of blocks reflected in the ledger.
+ * @param iTipHash Hash of the last of these blocks.
+ * @param iKeep Number of snapshots to keep, including the new one.
+ * @return Nothing on success, otherwise the reason of the failure.
+ */
+std::expected<void, std::string>
+WriteSnapshot(const std::filesystem::path& iDirectory, const Ledger& iLedger,
+              const std::uint32_t iChainLength, const std::string& iTipHash,
+              const std::size_t iKeep = 2);
+
+/**
+ * @brief Load the newest snapshot that is intact and accepted by iIsUsable.
+ * The file is memory-mapped and paged in as it is parsed.
+ * @param iDirectory Directory of the chain data.
+ * @param iIsUsable Predicate on the chain length and tip hash of a snapshot,
+ * e.g. to check that the snapshot matches the stored blocks.
+ * @return Loaded snapshot or the reason no snapshot could be used.
+ */
+std::expected<Snapshot, std::string> LoadLatestSnapshot(
+    const std::filesystem::path& iDirectory,
+    const std::function<bool(std::uint32_t, const std::string&)>& iIsUsable);
+} // namespace ledger
@@ -28,19 +28,37 @@ std::string BitcoinRepresentation(const double& iBitcoinAmount);
 class Coinbase {
  public:
   explicit Coinbase(std::string owner, const double& bitcoinAmount);
+  /**
+   * @brief Restore a previously created coinbase, e.g. from storage.
+   * @param timestamp Original creation time of the coinbase.
+   * @param hash Known hash of the coinbase. When empty, it is computed lazily.
+   */
+  explicit Coinbase(std::string owner, const double& bitcoinAmount,
+                    const std::chrono::system_clock::time_point& timestamp,
+                    std::string hash = {});
   Coinbase(const Coinbase& coinbase);
   Coinbase& operator=(const Coinbase& coinbase);
   Coinbase(Coinbase&& coinbase) noexcept;
   Coinbase& operator=(Coinbase&& coinbase) noexcept;
   virtual ~Coinbase();
 
-  [[nodiscard]] std::string getOwner() const;
+  [[nodiscard]] const std::string& getOwner() const;
   [[nodiscard]] double getBitcoinAmount() const;
   [[nodiscard]] std::chrono::system_clock::time_point getTimestamp() const;
   [[nodiscard]] std::time_t getUnixTimestamp() const;
   [[nodiscard]] std::uint64_t getSatoshiAmount() const;
   [[nodiscard]] std::string getBitcoinRepresentation() const;
   [[nodiscard]] virtual std::string getHash();
+  /**
+   * @return Whether the hash is already known, i.e. getHash does not need to
+   * compute it.
+   */
+  [[nodiscard]] bool hasHash() const;
+  /**
+   * @brief Build the message the transaction hash is computed from.
+   * @return Concatenation of the hashed fields.
+   */
+  [[nodiscard]] virtual std::string getHashMessage() const;
 
  protected:
   std::string _hash{};
@@ -58,14 +76,24 @@ class Payload final : public Coinbase {
  public:
   explicit Payload(std::string owner, std::string receiver,
                    const double& bitcoinAmount);
+  /**
+   * @brief Restore a previously created payload, e.g. from storage.
+   * @param timestamp Original creation time of the payload.
+   * @param hash Known hash of the payload. When empty, it is computed lazily.
+   */
+  explicit Payload(std::string owner, std::string receiver,
+                   const double& bitcoinAmount,
+                   const std::chrono::system_clock::time_point& timestamp,
+                   std::string hash = {});
   Payload(const Payload& payload);
   Payload& operator=(const Payload& payload);
   Payload(Payload&& payload) noexcept;
   Payload& operator=(Payload&& payload) noexcept;
   ~Payload() override;
 
-  [[nodiscard]] std::string getReceiver() const;
+  [[nodiscard]] const std::string& getReceiver() const;
   [[nodiscard]] std::string getHash() override;
+  [[nodiscard]] std::string getHashMessage() const override;
 
  private:
   std::string _receiver{};
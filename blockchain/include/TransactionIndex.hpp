@@ -0,0 +1,78 @@
+// author: georgiosmatzarapis
+
+#pragma once
+
+#include <cstdint>
+#include <expected>
+#include <optional>
+#include <string>
+#include <unordered_map>
+
+#include "BloomFilter.hpp"
+#include "Chain.hpp"
+#include "IChainObserver.hpp"
+
+namespace chain {
+
+struct TransactionIndexOptions {
+  /** Number of transactions the filter is first sized for; it grows after. */
+  std::size_t expectedTransactions{std::size_t{1} << 16};
+  /** False positive rate the filter is sized for. */
+  double falsePositiveRate{0.01};
+};
+
+/**
+ * @brief Index of the confirmed transactions, by hash, answering whether a
+ * transaction is already part of the active chain.
+ * A Bloom filter sits in front of the exact index: most queries are for unseen
+ * transactions and are answered by the filter alone, only its positives are
+ * looked up in the exact index. The filter cannot forget transactions, so it
+ * is rebuilt from the exact index once the transactions added to it, removed
+ * ones included, outgrow its size.
+ * Registered as an observer of the chain, the index follows reorganisations.
+ * Pending transactions are answered by the mempool.
+ */
+class TransactionIndex final : public IObserver {
+ public:
+  explicit TransactionIndex(
+      TransactionIndexOptions options = TransactionIndexOptions{});
+
+  TransactionIndex(const TransactionIndex&) = delete;
+  TransactionIndex& operator=(const TransactionIndex&) = delete;
+  TransactionIndex(TransactionIndex&&) noexcept = delete;
+  TransactionIndex& operator=(TransactionIndex&&) noexcept = delete;
+
+  /**
+   * @brief Index the transactions of the stored blocks of a chain. Blocks
+   * whose body was pruned are skipped.
+   * @param iChain Chain to index.
+   * @return Nothing on success, otherwise the reason of the failure.
+   */
+  std::expected<void, std::string> build(const Chain& iChain);
+
+  void onBlockConnected(const block::Block& iBlock) override;
+  void onBlockDisconnected(const block::Block& iBlock) override;
+
+  [[nodiscard]] bool contains(const std::string& iHash) const;
+  /**
+   * @return Height of the block including the transaction.
+   */
+  [[nodiscard]] std::optional<std::uint32_t>
+  findHeight(const std::string& iHash) const;
+  /**
+   * @return Number of indexed transactions.
+   */
+  [[nodiscard]] std::size_t size() const;
+
+ private:
+  TransactionIndexOptions _options{};
+  utils::BloomFilter _filter;
+  /** Transactions added to the filter since it was last rebuilt. */
+  std::size_t _filterItems{};
+  std::size_t _filterCapacity{};
+  std::unordered_map<std::string, std::uint32_t> _heights{};
+
+  void insert(const std::string& iHash, const std::uint32_t iHeight);
+  void rebuildFilter(const std::size_t iCapacity);
+};
+} // namespace chain
@@ -2,37 +2,181 @@
 
 #pragma once
 
+#include <array>
+#include <atomic>
 #include <cstdint>
+#include <expected>
+#include <filesystem>
+#include <functional>
+#include <limits>
 #include <memory>
+#include <mutex>
 #include <optional>
+#include <set>
+#include <shared_mutex>
+#include <span>
 #include <string>
 #include <unordered_map>
+#include <vector>
 
 namespace user {
+
+using ProfileId = std::uint64_t;
+
+class Journal;
+struct JournalOptions;
+class ProfileSnapshot;
+
+/**
+ * @brief Deposits are kept as whole satoshi, so that transfers between
+ * profiles move exact amounts.
+ */
 class Profile {
  public:
   explicit Profile(std::string fullName, const std::uint8_t& age,
                    const double& deposit);
 
-  [[nodiscard]] std::string getFullName() const;
+  [[nodiscard]] const std::string& getFullName() const;
   [[nodiscard]] std::uint8_t getAge() const;
   [[nodiscard]] double getDeposit() const;
+  [[nodiscard]] std::int64_t getSatoshiDeposit() const;
 
   /**
    * @brief Update the user deposit.
    * The update will be performed if the final deposit is equal to or greater
    * than zero.
-   * @param iAmount Amount to update the deposit with.
+   * @param iAmount Amount to update the deposit with, rounded to satoshi.
    * @return Update status.
    */
   bool updateDeposit(const double iAmount);
 
  private:
+  friend class InMemoryDatabase;
+  friend class Journal;
+
   std::string _fullName{};
   std::uint8_t _age{};
-  double _deposit{};
+  /** Deposit in satoshi. */
+  std::int64_t _deposit{};
+};
+
+/**
+ * @brief Move of an amount from one profile deposit to another.
+ */
+struct Transfer {
+  ProfileId from{};
+  ProfileId to{};
+  /** Amount in satoshi. */
+  std::uint64_t amount{};
+};
+
+/**
+ * @brief Profile as stored in the database, along with the version of the
+ * database that last wrote it.
+ */
+struct StoredProfile {
+  Profile profile;
+  std::uint64_t version{};
+};
+
+/**
+ * @brief Profiles stored by value in fixed-size slabs, found through an
+ * open-addressing index from id to slot.
+ * Slots of removed profiles are reused before a new slab is allocated, and
+ * slabs never move, so a profile stays in place until it is removed. Not
+ * synchronised.
+ */
+class ProfileTable {
+ public:
+  ProfileTable();
+
+  [[nodiscard]] StoredProfile* find(const ProfileId iProfileId);
+  [[nodiscard]] const StoredProfile* find(const ProfileId iProfileId) const;
+  /**
+   * @param iVersion Version of the database writing the profile.
+   * @return Insertion status, false if the id is already present.
+   */
+  bool insert(const ProfileId iProfileId, Profile&& ioProfile,
+              const std::uint64_t iVersion = 0);
+  /**
+   * @return Removal status, false if the id is not present.
+   */
+  bool erase(const ProfileId iProfileId);
+
+  /**
+   * @brief Make room for more profiles, so that inserting them does not
+   * rehash the index nor allocate slabs one at a time.
+   * @param iProfiles Number of profiles about to be inserted.
+   */
+  void reserve(const std::size_t iProfiles);
+  /**
+   * @brief Hint the processor to load the index bucket of an id, ahead of
+   * looking it up.
+   */
+  void prefetch(const ProfileId iProfileId) const;
+
+  [[nodiscard]] std::size_t size() const;
+  /**
+   * @return Number of slots allocated, used or free.
+   */
+  [[nodiscard]] std::size_t getCapacity() const;
+
+  /**
+   * @brief Visit every profile, in no particular order.
+   * @param iVisitor Called with the id and the stored profile.
+   */
+  template <typename Visitor> void forEach(Visitor&& iVisitor) const {
+    for (const Bucket& aBucket : _buckets) {
+      if (aBucket.slot != kEmptyBucket) {
+        std::invoke(iVisitor, aBucket.profileId, *getSlot(aBucket.slot));
+      }
+    }
+  }
+
+ private:
+  static constexpr std::size_t kSlabSize{256};
+  static constexpr std::uint32_t kEmptyBucket{UINT32_MAX};
+
+  struct Bucket {
+    ProfileId profileId{};
+    std::uint32_t slot{kEmptyBucket};
+  };
+
+  std::vector<std::unique_ptr<std::optional<StoredProfile>[]>> _slabs{};
+  std::vector<std::uint32_t> _freeSlots{};
+  /** Slots handed out so far, the following ones were never used. */
+  std::uint32_t _usedSlots{};
+  std::vector<Bucket> _buckets;
+  std::size_t _size{};
+
+  [[nodiscard]] std::optional<StoredProfile>&
+  getSlot(const std::uint32_t iSlot);
+  [[nodiscard]] const std::optional<StoredProfile>&
+  getSlot(const std::uint32_t iSlot) const;
+  [[nodiscard]] std::uint32_t allocateSlot();
+  /**
+   * @return Bucket holding the id, or the empty bucket ending its probe
+   * sequence.
+   */
+  [[nodiscard]] std::size_t findBucket(const ProfileId iProfileId) const;
+  void rehash(const std::size_t iBucketCount);
 };
 
+/**
+ * @brief Process-wide store of user profiles, safe to use from any thread.
+ * Profiles are spread over kShardCount shards by id, each guarded by its own
+ * reader-writer lock: reads only share a lock, and writes only contend with
+ * accesses to the same shard. Each shard keeps its profiles in a
+ * ProfileTable.
+ * Once opened on a directory, every change is appended to a Journal before
+ * it is applied, and a snapshot is taken when the journal asks for one. A
+ * change is durable once the journal syncs, i.e. after a full sync batch or
+ * the sync interval at the latest; call sync to make it durable at once.
+ * Every change is stamped with a new version of the database, so that a
+ * ProfileSnapshot can read the profiles as they were at a given version while
+ * writes continue: profiles changed after a snapshot was taken keep their
+ * previous version aside until no snapshot needs it anymore.
+ */
 class InMemoryDatabase {
  public:
   InMemoryDatabase(const InMemoryDatabase&) = delete;
@@ -42,12 +186,54 @@ class InMemoryDatabase {
 
   static InMemoryDatabase& GetInstance();
 
+  /**
+   * @brief Replace the profiles with the ones persisted in a directory, and
+   * persist every following change there. Must not run concurrently with
+   * other calls.
+   * @param iDirectory Directory of the journal, created if missing.
+   * @param iOptions Journal options.
+   * @return Nothing on success, otherwise the reason of the failure, in which
+   * case the database is left as it was.
+   */
+  std::expected<void, std::string> open(const std::filesystem::path& iDirectory,
+                                        const JournalOptions& iOptions);
+  std::expected<void, std::string>
+  open(const std::filesystem::path& iDirectory);
+
+  /**
+   * @brief Flush the changes appended to the journal to disk.
+   * @return Sync status, true when the database is not persisted.
+   */
+  bool sync();
+
+  /**
+   * @brief Persist a snapshot of every profile, so that the journal replayed
+   * on opening starts from there. Writers are only blocked while the
+   * profiles are encoded, not while the snapshot is written.
+   * @return Nothing on success, otherwise the reason of the failure.
+   */
+  std::expected<void, std::string> checkpoint();
+
   /**
    * @brief Insert new profile in the database.
    * @param iProfile User profile.
    * @return Insertion status and optionally unique identifier of the record.
    */
-  std::pair<bool, std::optional<std::uint16_t>> insert(Profile iProfile);
+  std::pair<bool, std::optional<ProfileId>> insert(Profile iProfile);
+
+  /**
+   * @brief Insert many profiles at once, e.g. on bulk imports.
+   * The profiles are given a contiguous range of ids, each shard is locked
+   * and sized once, the batch is journaled as a single record, encoded
+   * before the locks are taken, and a single line is logged. The ids of a
+   * batch that fails to be journaled are not issued again.
+   * @param iProfiles User profiles.
+   * @return Insertion status and optionally the id of the first profile, the
+   * following ones being numbered consecutively. An empty batch succeeds
+   * without an id.
+   */
+  std::pair<bool, std::optional<ProfileId>>
+  insertMany(std::vector<Profile> iProfiles);
 
   /**
    * @brief Retrieve a profile from the database.
@@ -55,30 +241,277 @@ class InMemoryDatabase {
    * @return Retrieval status and optionally profile record.
    */
   [[nodiscard]] std::pair<bool, std::optional<Profile>>
-  get(const std::uint16_t iProfileId) const;
+  get(const ProfileId iProfileId) const;
+
+  /**
+   * @brief Retrieve many profiles at once.
+   * Lookups are grouped by shard, so each shard is locked once, and the
+   * index buckets of the next ids are prefetched while the current one is
+   * looked up. Missing profiles are logged as a single line.
+   * @param iProfileIds Profile ids.
+   * @return Profile records, in the order of the ids, nullopt for the ids
+   * that are not stored.
+   */
+  [[nodiscard]] std::vector<std::optional<Profile>>
+  getMany(std::span<const ProfileId> iProfileIds) const;
 
   /**
    * @brief Remove profile from the database.
    * @param iProfileId Profile id.
    * @return Removal status.
    */
-  bool remove(const std::uint16_t iProfileId);
+  bool remove(const ProfileId iProfileId);
 
   /**
    * @brief Update profile in the database.
+   * When the database is persisted, the stored profile is replaced only once
+   * the new one is journaled.
    * @param iProfileId Profile id.
    * @param iProfile User profile.
    * @return Update status.
    */
-  bool update(const std::uint16_t iProfileId, Profile iProfile);
+  bool update(const ProfileId iProfileId, Profile iProfile);
+
+  /**
+   * @brief Take a point-in-time view of the profiles, e.g. to scan all of
+   * them while they keep being written. Taking it only registers its
+   * version; writers pay for keeping previous versions until it is destroyed.
+   * @return Snapshot of the current version.
+   */
+  [[nodiscard]] ProfileSnapshot snapshot();
+
+  /**
+   * @brief Move an amount between two profiles atomically.
+   * @return Nothing on success, otherwise the reason of the rejection.
+   */
+  std::expected<void, std::string> transfer(const Transfer& iTransfer);
+
+  /**
+   * @brief Apply a batch of transfers atomically: either all of them are
+   * applied or none is.
+   * Transfers apply in order, so a profile may spend what an earlier
+   * transfer of the batch credited to it. The shards involved are locked
+   * once for the whole batch, in shard order so that concurrent batches
+   * cannot deadlock, and a single line is logged.
+   * @param iTransfers Transfers to apply.
+   * @return Nothing on success, otherwise the reason of the rejection.
+   */
+  std::expected<void, std::string>
+  transferMany(std::span<const Transfer> iTransfers);
+
+  /**
+   * @brief Access a stored profile in place, without copying it.
+   * The visitor runs under the shared lock of the shard, so it must not call
+   * back into the database. Only failures are logged.
+   * @param iProfileId Profile id.
+   * @param iVisitor Called with the profile as `const Profile&`.
+   * @return Retrieval status.
+   */
+  template <typename Visitor>
+  bool read(const ProfileId iProfileId, Visitor&& iVisitor) const {
+    {
+      const Shard& aShard{getShard(iProfileId)};
+      std::shared_lock aLock{aShard.mutex};
+      if (const StoredProfile* aStored{aShard.profiles.find(iProfileId)}) {
+        std::invoke(std::forward<Visitor>(iVisitor), aStored->profile);
+        return true;
+      }
+    }
+    logMissingRetrieval(iProfileId);
+    return false;
+  }
+
+  /**
+   * @brief Change a stored profile in place, e.g. to update its deposit
+   * without replacing the whole record.
+   * The visitor runs under the exclusive lock of the shard, so it must not
+   * call back into the database. When the database is persisted, it is called
+   * with a copy of the profile, which replaces the stored one once journaled.
+   * Only failures are logged.
+   * @param iProfileId Profile id.
+   * @param iVisitor Called with the profile as `Profile&`.
+   * @return Update status.
+   */
+  template <typename Visitor>
+  bool modify(const ProfileId iProfileId, Visitor&& iVisitor) {
+    bool aIsFound{};
+    bool aIsModified{};
+    {
+      Shard& aShard{getShard(iProfileId)};
+      std::unique_lock aLock{aShard.mutex};
+      if (StoredProfile* aStored{aShard.profiles.find(iProfileId)}) {
+        aIsFound = true;
+        if (!_journal) {
+          const std::uint64_t aVersion{nextVersion()};
+          preserve(aShard, iProfileId, *aStored, aVersion);
+          std::invoke(std::forward<Visitor>(iVisitor), aStored->profile);
+          aStored->version = aVersion;
+          return true;
+        }
+        // The change must be journaled before it is applied.
+        Profile aModifiedProfile{aStored->profile};
+        std::invoke(std::forward<Visitor>(iVisitor), aModifiedProfile);
+        if (persistPut(iProfileId, aModifiedProfile)) {
+          const std::uint64_t aVersion{nextVersion()};
+          preserve(aShard, iProfileId, *aStored, aVersion);
+          std::swap(aStored->profile, aModifiedProfile);
+          aStored->version = aVersion;
+          aIsModified = true;
+        }
+      }
+    }
+    if (!aIsFound) {
+      logMissingUpdate(iProfileId);
+    }
+    checkpointIfDue();
+    return aIsModified;
+  }
 
  private:
+  friend class ProfileSnapshot;
+
   InMemoryDatabase();
   ~InMemoryDatabase();
 
-  inline std::uint16_t idGenerator() { return ++_profileId; }
+  static constexpr std::size_t kShardCount{16};
+
+  /**
+   * @brief Previous version of a profile, kept for the snapshots taken
+   * before it was superseded.
+   */
+  struct PreviousVersion {
+    std::uint64_t version{};
+    /** Version of the change that replaced or removed the profile. */
+    std::uint64_t supersededVersion{};
+    Profile profile;
+  };
+
+  /** Aligned so that the locks of neighbouring shards do not share a line. */
+  struct alignas(64) Shard {
+    mutable std::shared_mutex mutex{};
+    ProfileTable profiles{};
+    /** Previous versions by profile id, oldest first. */
+    std::unordered_map<ProfileId, std::vector<PreviousVersion>>
+        previousVersions{};
+    /**
+     * Lowest superseded version among the previous versions, written under the
+     * exclusive lock and read without it to skip shards with nothing to drop.
+     */
+    std::atomic<std::uint64_t> oldestSupersededVersion{
+        std::numeric_limits<std::uint64_t>::max()};
+  };
+
+  inline ProfileId idGenerator(const ProfileId iCount = 1) {
+    return _nextProfileId.fetch_add(iCount, std::memory_order_relaxed);
+  }
+  inline Shard& getShard(const ProfileId iProfileId) {
+    return _shards[iProfileId % kShardCount];
+  }
+  inline const Shard& getShard(const ProfileId iProfileId) const {
+    return _shards[iProfileId % kShardCount];
+  }
+  /**
+   * @brief Version of a change, taken while holding the locks of the shards
+   * it writes to. Sequentially consistent, to order it against the
+   * registration of snapshots.
+   */
+  inline std::uint64_t nextVersion() { return _version.fetch_add(1) + 1; }
+
+  /**
+   * @brief Keep the stored version of a profile aside before a change
+   * replaces or removes it, if a snapshot may still read it. The caller holds
+   * the exclusive lock of the shard and took iVersion beforehand.
+   * @param iVersion Version of the change.
+   */
+  void preserve(Shard& ioShard, const ProfileId iProfileId,
+                const StoredProfile& iStored, const std::uint64_t iVersion);
+  /**
+   * @return Profile as it was at iVersion; the caller holds the lock of the
+   * shard.
+   */
+  [[nodiscard]] const Profile* findVersion(const Shard& iShard,
+                                           const ProfileId iProfileId,
+                                           const std::uint64_t iVersion) const;
+  /**
+   * @brief Unregister a snapshot, and drop the previous versions that no
+   * remaining snapshot needs. Only the shards holding such versions are
+   * locked.
+   */
+  void releaseSnapshot(const std::uint64_t iVersion);
+
+  /**
+   * @brief Log the failure of a read, respectively a change, of a profile that
+   * is not stored. Each is throttled on its own.
+   */
+  void logMissingRetrieval(const ProfileId iProfileId) const;
+  void logMissingUpdate(const ProfileId iProfileId) const;
+
+  /**
+   * @brief Journal a change; the caller holds the lock of the shard.
+   * @return Whether the change may be applied.
+   */
+  bool persistPut(const ProfileId iProfileId, const Profile& iProfile);
+  bool persistRemove(const ProfileId iProfileId);
+  /**
+   * @brief Take a snapshot if the journal asks for one. Must be called
+   * without holding any shard lock.
+   */
+  void checkpointIfDue();
+
+  std::atomic<ProfileId> _nextProfileId{};
+  std::array<Shard, kShardCount> _shards{};
+  /** Version of the latest change. */
+  std::atomic<std::uint64_t> _version{};
+  /** Number of live snapshots, read by writers without locking. */
+  std::atomic<std::size_t> _snapshotCount{};
+  std::mutex _snapshotsMutex{};
+  std::multiset<std::uint64_t> _snapshotVersions{};
+  /** Set while all shards are locked, read under the lock of any shard. */
+  std::unique_ptr<Journal> _journal{};
+};
+
+/**
+ * @brief Point-in-time view of the profiles of the database, taken through
+ * InMemoryDatabase::snapshot. It must be destroyed before the database.
+ */
+class ProfileSnapshot {
+ public:
+  ~ProfileSnapshot();
+
+  ProfileSnapshot(const ProfileSnapshot&) = delete;
+  ProfileSnapshot& operator=(const ProfileSnapshot&) = delete;
+  ProfileSnapshot(ProfileSnapshot&& other) noexcept;
+  ProfileSnapshot& operator=(ProfileSnapshot&&) noexcept = delete;
+
+  /**
+   * @return Version of the database the snapshot reads.
+   */
+  [[nodiscard]] std::uint64_t getVersion() const;
+
+  /**
+   * @brief Retrieve a profile as it was when the snapshot was taken.
+   * @param iProfileId Profile id.
+   * @return Profile record, nullopt if it did not exist then.
+   */
+  [[nodiscard]] std::optional<Profile> get(const ProfileId iProfileId) const;
+
+  /**
+   * @brief Visit every profile as it was when the snapshot was taken, in no
+   * particular order.
+   * The profiles of a shard are copied under its shared lock and visited once
+   * the lock is released, so writers are only blocked for the copy and the
+   * visitor may call back into the database.
+   * @param iVisitor Called with the id and the profile.
+   */
+  void forEach(
+      const std::function<void(ProfileId, const Profile&)>& iVisitor) const;
+
+ private:
+  friend class InMemoryDatabase;
+
+  ProfileSnapshot(InMemoryDatabase& database, const std::uint64_t version);
 
-  std::int16_t _profileId{-1};
-  std::unordered_map<std::uint16_t, std::unique_ptr<Profile>> _profiles{};
+  InMemoryDatabase* _database{};
+  std::uint64_t _version{};
 };
 } // namespace user
\ No newline at end of file
@@ -3,12 +3,109 @@
 #include "Block.hpp"
 #include "Common.hpp"
 #include "Logger.hpp"
+#include "Metrics.hpp"
+#include "Tracing.hpp"
 
 namespace block {
 
 using namespace utils;
 
 static const Log& sLog{Log::GetInstance()};
+static const MetricsRegistry& sMetrics{MetricsRegistry::GetInstance()};
+
+static constexpr std::string kTargetDifficulty{"00"};
+/** A malformed batch may hold any number of transactions with a bad hash. */
+static constexpr LogThrottlePolicy kInvalidTransactionLogPolicy{
+    10, std::chrono::seconds{1}, 0};
+
+/* === Helpers === */
+
+static std::string HeaderMessage(const std::uint32_t iIndex,
+                                 const std::string& iPreviousHash,
+                                 const std::string& iMerkleRootHash,
+                                 const std::time_t iCreationTime) {
+  return std::to_string(iIndex) + iPreviousHash + iMerkleRootHash +
+         std::to_string(iCreationTime);
+}
+
+std::expected<std::string, std::string>
+ComputeMerkleRootHash(const std::vector<std::string>& iTransactionHashes) {
+  if (iTransactionHashes.empty()) {
+    return std::unexpected{std::string{"No transaction hashes to combine."}};
+  }
+  if (iTransactionHashes.size() == 1) {
+    return core_lib::ComputeHash(iTransactionHashes[0]);
+  }
+
+  std::vector<std::string> sMerkleTree{iTransactionHashes};
+  while (sMerkleTree.size() > 1) {
+    std::vector<std::string> sNewLevel{};
+    sNewLevel.reserve((sMerkleTree.size() + 1) / 2);
+
+    for (std::size_t sMerkleTreeIndex{}; sMerkleTreeIndex < sMerkleTree.size();
+         sMerkleTreeIndex += 2) {
+      std::string sPair{sMerkleTree[sMerkleTreeIndex]};
+      if (sMerkleTreeIndex + 1 < sMerkleTree.size()) {
+        sPair += sMerkleTree[sMerkleTreeIndex + 1];
+      }
+
+      std::expected<std::string, std::string> sNewHash{
+          core_lib::ComputeHash(sPair)};
+      if (!sNewHash) {
+        return sNewHash;
+      }
+      sNewLevel.emplace_back(std::move(sNewHash.value()));
+    }
+
+    sMerkleTree = std::move(sNewLevel);
+  }
+  return sMerkleTree[0];
+}
+
+std::expected<std::string, std::string>
+ComputeBlockHash(const Header& iHeader) {
+  return core_lib::ComputeHash(HeaderMessage(iHeader.index,
+                                             iHeader.previousHash,
+                                             iHeader.merkleRootHash,
+                                             iHeader.creationTime) +
+                               std::to_string(iHeader.nonce));
+}
+
+bool MeetsTargetDifficulty([[maybe_unused]] const std::string& iHash) {
+#ifndef NDEBUG
+  return true;
+#else
+  return iHash.substr(0, kTargetDifficulty.size()) == kTargetDifficulty;
+#endif
+}
+
+std::uint64_t ComputeBlockWork([[maybe_unused]] const Header& iHeader) {
+#ifndef NDEBUG
+  return 1;
+#else
+  // Every byte of the target prefix is matched once in 256 hashes.
+  return std::uint64_t{1} << (8 * kTargetDifficulty.size());
+#endif
+}
+
+static Histogram& StageDuration(const std::string& iStage) {
+  return MetricsRegistry::GetInstance().histogram(
+      "blockchain_block_stage_seconds",
+      "Duration of the stages of block construction.",
+      "stage=\"" + iStage + "\"", 1e-9);
+}
+
+static Histogram& sInitializeDuration{StageDuration("initialize")};
+static Histogram& sValidationDuration{
+    StageDuration("validate_and_store_transactions")};
+static Histogram& sGroupingDuration{StageDuration("group_transaction_hashes")};
+static Histogram& sMerkleRootDuration{
+    StageDuration("calculate_merkle_root_hash")};
+static Histogram& sBlockHashDuration{StageDuration("calculate_block_hash")};
+static Histogram& sMiningAttempts{MetricsRegistry::GetInstance().histogram(
+    "blockchain_mining_attempts", "Nonces tried until a block hash is found.")};
+
+/* === Block Class === */
 
 Block::Block() = default;
 
@@ -30,8 +127,40 @@ Block::Block(std::string previousHash, const std::uint32_t& index,
   initialize(std::make_optional(std::move(coinbases)), std::move(payloads));
 }
 
+Block::Block(Header header,
+             std::optional<std::vector<std::unique_ptr<Coinbase>>> coinbases,
+             std::optional<std::vector<std::unique_ptr<Payload>>> payloads)
+    : _index{header.index},
+      _merkleRootHash{std::move(header.merkleRootHash)},
+      _creationTime{header.creationTime},
+      _nonce{header.nonce},
+      _previousHash{std::move(header.previousHash)},
+      _hash{std::move(header.hash)},
+      _payloads{std::move(payloads)},
+      _coinbases{std::move(coinbases)} {}
+
 // Public API
 
+Block Block::FromVerifiedTransactions(
+    std::string iPreviousHash, const std::uint32_t iIndex,
+    std::vector<std::unique_ptr<Coinbase>> iCoinbases,
+    std::vector<std::unique_ptr<Payload>> iPayloads) {
+  Block sBlock{};
+  sBlock._previousHash = std::move(iPreviousHash);
+  sBlock._index = iIndex;
+  sBlock._creationTime = core_lib::GetUnixTimestamp();
+  if (!iCoinbases.empty()) {
+    sBlock._coinbases = std::move(iCoinbases);
+  }
+  if (!iPayloads.empty()) {
+    sBlock._payloads = std::move(iPayloads);
+  }
+  sBlock.groupTransactionHashes();
+  sBlock.calculateMerkleRootHash();
+  sBlock.calculateBlockHash();
+  return sBlock;
+}
+
 std::string Block::getHash() const { return _hash; }
 
 std::string Block::getPreviousHash() const { return _previousHash; }
@@ -44,6 +173,11 @@ std::uint32_t Block::getNonce() const { return _nonce; }
 
 std::time_t Block::getCreationTime() const { return _creationTime; }
 
+Header Block::getHeader() const {
+  return Header{_index, _previousHash, _merkleRootHash,
+                _creationTime, _nonce, _hash};
+}
+
 const std::optional<std::vector<std::unique_ptr<Payload>>>&
 Block::getPayloads() const {
   return _payloads;
@@ -108,6 +242,8 @@ void Block::display() const {
 void Block::initialize(
     std::optional<std::vector<std::unique_ptr<Coinbase>>>&& ioCoinbases,
     std::optional<std::vector<std::unique_ptr<Payload>>>&& ioPayloads) {
+  const TraceSpan aSpan{"Block::initialize"};
+  const MetricsTimer aTimer{sInitializeDuration};
   if (ioCoinbases.has_value()) {
     validateAndStoreTransactions(std::move(ioCoinbases.value()));
   }
@@ -125,22 +261,13 @@ void Block::validateAndStoreTransactions(
   static_assert(std::is_same<Transaction, Coinbase>::value ||
                     std::is_same<Transaction, Payload>::value,
                 "Transaction type must be either Coinbase or Payload");
+  const TraceSpan aSpan{"Block::validateAndStoreTransactions"};
+  const MetricsTimer aTimer{sValidationDuration};
 
   std::for_each(
       ioTransactions.begin(), ioTransactions.end(),
       [this](std::unique_ptr<Transaction>& aTransaction) {
-        std::string aTempMessageToHash{};
-        if constexpr (std::is_same<Transaction, Coinbase>::value) {
-          aTempMessageToHash =
-              aTransaction->getOwner() +
-              std::to_string(aTransaction->getSatoshiAmount()) +
-              std::to_string(aTransaction->getUnixTimestamp());
-        } else {
-          aTempMessageToHash =
-              aTransaction->getOwner() + aTransaction->getReceiver() +
-              std::to_string(aTransaction->getSatoshiAmount()) +
-              std::to_string(aTransaction->getUnixTimestamp());
-        }
+        const std::string aTempMessageToHash{aTransaction->getHashMessage()};
 
         const std::string aTempExpectedHash{aTransaction->getHash()};
 
@@ -148,6 +275,9 @@ void Block::validateAndStoreTransactions(
             core_lib::IsHashValid(aTempMessageToHash, aTempExpectedHash)};
         if (aIsHashValid) {
           if (aIsHashValid.value()) {
+            LOG_TO_FILE(LogLevel::DEBUG,
+                        "Transaction stored with hash of message '" +
+                            aTempMessageToHash + "'");
             if constexpr (std::is_same<Transaction, Coinbase>::value) {
               _coinbases.has_value()
                   ? _coinbases.value().push_back(std::move(aTransaction))
@@ -158,11 +288,12 @@ void Block::validateAndStoreTransactions(
                   : _payloads.emplace().push_back(std::move(aTransaction));
             }
           } else {
-            sLog.toFile(LogLevel::WARNING,
-                        "Hash inconsistency detected for message '" +
-                            aTempMessageToHash +
-                            "', with expected hash: " + aTempExpectedHash,
-                        __PRETTY_FUNCTION__);
+            LOG_TO_FILE_THROTTLED(LogLevel::WARNING,
+                                  kInvalidTransactionLogPolicy,
+                                  "Hash inconsistency detected for message '" +
+                                      aTempMessageToHash +
+                                      "', with expected hash: " +
+                                      aTempExpectedHash);
           }
         } else {
           sLog.toFile(LogLevel::ERROR, aIsHashValid.error(),
@@ -173,6 +304,8 @@ void Block::validateAndStoreTransactions(
 }
 
 void Block::groupTransactionHashes() {
+  const TraceSpan aSpan{"Block::groupTransactionHashes"};
+  const MetricsTimer aTimer{sGroupingDuration};
   bool aValidTransactionExist{false};
   if (_coinbases.has_value()) {
     std::for_each(_coinbases.value().begin(), _coinbases.value().end(),
@@ -196,46 +329,22 @@ void Block::groupTransactionHashes() {
 };
 
 void Block::calculateMerkleRootHash() {
-  if (_transactionHashes.size() == 1) {
-    const std::expected<std::string, std::string> aHash{
-        core_lib::ComputeHash(_transactionHashes[0])};
-    if (!aHash) {
-      sLog.toFile(LogLevel::ERROR, aHash.error(), __PRETTY_FUNCTION__);
-      throw core_lib::exception::HashCalculationError{aHash.error()};
-    }
-    _merkleRootHash = aHash.value();
-    return;
-  }
-
-  std::vector<std::string> aMerkleTree{_transactionHashes};
-  while (aMerkleTree.size() > 1) {
-    std::vector<std::string> aNewLevel{};
-
-    for (std::size_t aMerkleTreeIndex{}; aMerkleTreeIndex < aMerkleTree.size();
-         aMerkleTreeIndex += 2) {
-      std::string aPair{aMerkleTree[aMerkleTreeIndex]};
-      if (aMerkleTreeIndex + 1 < aMerkleTree.size()) {
-        aPair += aMerkleTree[aMerkleTreeIndex + 1];
-      }
-
-      const std::expected<std::string, std::string> aNewHash{
-          core_lib::ComputeHash(aPair)};
-      if (!aNewHash) {
-        sLog.toFile(LogLevel::ERROR, aNewHash.error(), __PRETTY_FUNCTION__);
-        throw core_lib::exception::HashCalculationError{aNewHash.error()};
-      }
-      aNewLevel.emplace_back(aNewHash.value());
-    }
-
-    aMerkleTree = aNewLevel;
+  const TraceSpan aSpan{"Block::calculateMerkleRootHash"};
+  const MetricsTimer aTimer{sMerkleRootDuration};
+  const std::expected<std::string, std::string> aMerkleRootHash{
+      ComputeMerkleRootHash(_transactionHashes)};
+  if (!aMerkleRootHash) {
+    sLog.toFile(LogLevel::ERROR, aMerkleRootHash.error(), __PRETTY_FUNCTION__);
+    throw core_lib::exception::HashCalculationError{aMerkleRootHash.error()};
   }
-  _merkleRootHash = aMerkleTree[0];
-  return;
+  _merkleRootHash = aMerkleRootHash.value();
 }
 
 void Block::calculateBlockHash() {
-  const std::string aHeader{std::to_string(_index) + _previousHash +
-                            _merkleRootHash + std::to_string(_creationTime)};
+  const TraceSpan aSpan{"Block::calculateBlockHash"};
+  const MetricsTimer aTimer{sBlockHashDuration};
+  const std::string aHeader{
+      HeaderMessage(_index, _previousHash, _merkleRootHash, _creationTime)};
   for (_nonce = 0; _nonce < 1000000; ++_nonce) {
     const std::expected<std::string, std::string> aHash{
         core_lib::ComputeHash(aHeader + std::to_string(_nonce))};
@@ -243,15 +352,13 @@ void Block::calculateBlockHash() {
       sLog.toFile(LogLevel::ERROR, aHash.error(), __PRETTY_FUNCTION__);
       throw core_lib::exception::HashCalculationError(aHash.error());
     }
-#ifndef NDEBUG
-    _hash = aHash.value();
-    return;
-#else
-    if (aHash.value().substr(0, 2) == kTargetDifficulty) {
+    if (MeetsTargetDifficulty(aHash.value())) {
+      if (sMetrics.isEnabled()) {
+        sMiningAttempts.record(_nonce + 1);
+      }
       _hash = aHash.value();
       return;
     }
-#endif
   }
   const std::string aErrorMessage{
       "Block hash calculation failed for target difficulty: " +
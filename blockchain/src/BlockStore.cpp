@@ -0,0 +1,534 @@
+// author: georgiosmatzarapis
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <mutex>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "BlockStore.hpp"
+#include "ByteStream.hpp"
+#include "Checksum.hpp"
+#include "Common.hpp"
+#include "Logger.hpp"
+
+namespace storage {
+
+using namespace utils;
+
+static const Log& sLog{Log::GetInstance()};
+
+static constexpr std::uint32_t kFrameMagic{0x4B4C4231}; // "1BLK"
+static constexpr std::uint64_t kFrameHeaderSize{12};
+static constexpr std::uint64_t kIndexEntrySize{24};
+static constexpr std::string kIndexFileName{"index.dat"};
+
+/* === Helpers === */
+
+static std::string ErrnoMessage(const std::string& iOperation) {
+  return iOperation + " failed: " + std::strerror(errno);
+}
+
+static bool WriteAll(const int iFileDescriptor, std::string_view iBytes,
+                     std::uint64_t iOffset) {
+  while (!iBytes.empty()) {
+    const ssize_t sWritten{::pwrite(iFileDescriptor, iBytes.data(),
+                                    iBytes.size(),
+                                    static_cast<off_t>(iOffset))};
+    if (sWritten < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return false;
+    }
+    iBytes.remove_prefix(static_cast<std::size_t>(sWritten));
+    iOffset += static_cast<std::uint64_t>(sWritten);
+  }
+  return true;
+}
+
+static std::uint64_t FileSize(const int iFileDescriptor) {
+  struct stat sStat{};
+  if (::fstat(iFileDescriptor, &sStat) != 0) {
+    throw core_lib::exception::StorageError{ErrnoMessage("fstat")};
+  }
+  return static_cast<std::uint64_t>(sStat.st_size);
+}
+
+static std::uint32_t ReadU32(const char* iBytes) {
+  std::uint32_t sValue{};
+  ByteReader{std::string_view{iBytes, sizeof(sValue)}}.getU32(sValue);
+  return sValue;
+}
+
+/* === BlockStore Class === */
+
+BlockStore::BlockStore(std::filesystem::path directory,
+                       BlockStoreOptions options)
+    : _directory{std::move(directory)},
+      _options{options} {
+  if (!_options.segmentSize || !_options.syncBatchSize) {
+    throw core_lib::exception::StorageError{
+        "Segment size and sync batch size must be positive."};
+  }
+  std::filesystem::create_directories(_directory);
+
+  // Pruning deletes segments from the oldest one, so the remaining segments
+  // still form a contiguous run.
+  _firstSegment = std::numeric_limits<std::uint32_t>::max();
+  for (const std::filesystem::directory_entry& aFile :
+       std::filesystem::directory_iterator{_directory}) {
+    unsigned int aSegment{};
+    char aSuffix{};
+    if (std::sscanf(aFile.path().filename().c_str(), "blk%5u.dat%c", &aSegment,
+                    &aSuffix) == 1 &&
+        aFile.path().filename() == segmentPath(aSegment).filename()) {
+      _firstSegment = std::min(_firstSegment, std::uint32_t{aSegment});
+    }
+  }
+  if (_firstSegment == std::numeric_limits<std::uint32_t>::max()) {
+    _firstSegment = 0;
+  }
+  _segments.resize(_firstSegment);
+  for (std::uint32_t aSegment{_firstSegment};
+       std::filesystem::exists(segmentPath(aSegment)); ++aSegment) {
+    openSegment(aSegment);
+  }
+  if (_segments.empty()) {
+    openSegment(0);
+  }
+
+  const std::string aIndexPath{(_directory / kIndexFileName).string()};
+  _indexFileDescriptor = ::open(aIndexPath.c_str(), O_RDWR | O_CREAT, 0644);
+  if (_indexFileDescriptor < 0) {
+    throw core_lib::exception::StorageError{ErrnoMessage("open " + aIndexPath)};
+  }
+  recover();
+}
+
+BlockStore::~BlockStore() {
+  syncLocked();
+  for (Segment& aSegment : _segments) {
+    closeSegment(aSegment);
+  }
+  if (_indexFileDescriptor >= 0) {
+    ::close(_indexFileDescriptor);
+  }
+}
+
+// Public API
+
+std::expected<std::uint64_t, std::string>
+BlockStore::append(std::string_view iRecord) {
+  const std::uint64_t aFrameSize{kFrameHeaderSize + iRecord.size()};
+  if (aFrameSize > _options.segmentSize) {
+    return std::unexpected{"Record of " + std::to_string(iRecord.size()) +
+                           " bytes exceeds the segment size."};
+  }
+
+  std::unique_lock aLock{_mutex};
+  if (_segments.back().size + aFrameSize > _options.segmentSize) {
+    if (!syncLocked()) {
+      return std::unexpected{ErrnoMessage("fdatasync")};
+    }
+    try {
+      ::close(_segments.back().fileDescriptor);
+      _segments.back().fileDescriptor = -1;
+      openSegment(static_cast<std::uint32_t>(_segments.size()));
+    } catch (const core_lib::exception::StorageError& iStorageError) {
+      return std::unexpected{iStorageError.what()};
+    }
+  }
+
+  Segment& aSegment{_segments.back()};
+  const IndexEntry aEntry{aSegment.size,
+                          static_cast<std::uint32_t>(_segments.size() - 1),
+                          static_cast<std::uint32_t>(iRecord.size()),
+                          Crc32c(iRecord.data(), iRecord.size())};
+
+  ByteWriter aFrame{static_cast<std::size_t>(aFrameSize)};
+  aFrame.putU32(kFrameMagic);
+  aFrame.putU32(aEntry.length);
+  aFrame.putU32(aEntry.checksum);
+  aFrame.putBytes(iRecord);
+  if (!WriteAll(aSegment.fileDescriptor, aFrame.buffer(), aEntry.offset)) {
+    return std::unexpected{ErrnoMessage("Record write")};
+  }
+  const std::uint64_t aRecordId{_index.size()};
+  if (!writeIndexEntry(aRecordId, aEntry)) {
+    return std::unexpected{ErrnoMessage("Index write")};
+  }
+
+  aSegment.size += aFrameSize;
+  _index.push_back(aEntry);
+  if (++_unsyncedRecords >= _options.syncBatchSize && !syncLocked()) {
+    return std::unexpected{ErrnoMessage("fdatasync")};
+  }
+  return aRecordId;
+}
+
+std::expected<std::string_view, std::string>
+BlockStore::read(const std::uint64_t iRecordId) const {
+  std::shared_lock aLock{_mutex};
+  if (iRecordId >= _index.size()) {
+    return std::unexpected{"Record id " + std::to_string(iRecordId) +
+                           " is out of range."};
+  }
+  const IndexEntry& aEntry{_index[iRecordId]};
+  if (aEntry.segment < _firstSegment) {
+    return std::unexpected{"Record id " + std::to_string(iRecordId) +
+                           " was pruned."};
+  }
+  return std::string_view{_segments[aEntry.segment].mapping + aEntry.offset +
+                              kFrameHeaderSize,
+                          aEntry.length};
+}
+
+std::expected<void, std::string>
+BlockStore::truncate(const std::uint64_t iSize) {
+  std::unique_lock aLock{_mutex};
+  if (iSize >= _index.size()) {
+    return {};
+  }
+  std::uint32_t aSegment{};
+  std::uint64_t aOffset{};
+  if (iSize) {
+    const IndexEntry& aLast{_index[iSize - 1]};
+    aSegment = aLast.segment;
+    aOffset = aLast.offset + kFrameHeaderSize + aLast.length;
+  }
+  if (aSegment < _firstSegment) {
+    // Pruned segments only hold whole records: the cut may fall right after
+    // them, at the start of the oldest stored segment, but not inside them.
+    if (_index[iSize].segment < _firstSegment) {
+      return std::unexpected{"Cannot truncate to " + std::to_string(iSize) +
+                             " records, the store is pruned up to record " +
+                             std::to_string(getFirstRecordLocked()) + "."};
+    }
+    aSegment = _firstSegment;
+    aOffset = 0;
+  }
+
+  // Segments go first: recovery drops index entries pointing past their
+  // segment, but would index again records left after a shorter index.
+  while (_segments.size() > aSegment + 1) {
+    closeSegment(_segments.back());
+    std::filesystem::remove(
+        segmentPath(static_cast<std::uint32_t>(_segments.size() - 1)));
+    _segments.pop_back();
+  }
+  Segment& aCurrent{_segments.back()};
+  if (aCurrent.fileDescriptor < 0) {
+    const std::string aPath{segmentPath(aSegment).string()};
+    aCurrent.fileDescriptor = ::open(aPath.c_str(), O_RDWR);
+    if (aCurrent.fileDescriptor < 0) {
+      return std::unexpected{ErrnoMessage("open " + aPath)};
+    }
+  }
+  if (::ftruncate(aCurrent.fileDescriptor, static_cast<off_t>(aOffset)) != 0 ||
+      ::fdatasync(aCurrent.fileDescriptor) != 0) {
+    return std::unexpected{ErrnoMessage("Segment truncation")};
+  }
+  aCurrent.size = aOffset;
+
+  if (::ftruncate(_indexFileDescriptor,
+                  static_cast<off_t>(iSize * kIndexEntrySize)) != 0 ||
+      ::fdatasync(_indexFileDescriptor) != 0) {
+    return std::unexpected{ErrnoMessage("Index truncation")};
+  }
+  _index.resize(static_cast<std::size_t>(iSize));
+  _unsyncedRecords = 0;
+  return {};
+}
+
+std::expected<std::uint64_t, std::string>
+BlockStore::prune(const std::uint64_t iKeepFrom) {
+  std::unique_lock aLock{_mutex};
+  // Index entries of pruned records must not be lost with a later torn write.
+  if (!syncLocked()) {
+    return std::unexpected{ErrnoMessage("fdatasync")};
+  }
+  std::uint32_t aKeepSegment{static_cast<std::uint32_t>(_segments.size() - 1)};
+  if (iKeepFrom < _index.size()) {
+    aKeepSegment = std::min(aKeepSegment, _index[iKeepFrom].segment);
+  }
+  for (; _firstSegment < aKeepSegment; ++_firstSegment) {
+    closeSegment(_segments[_firstSegment]);
+    _segments[_firstSegment] = Segment{};
+    std::error_code aError{};
+    if (!std::filesystem::remove(segmentPath(_firstSegment), aError) &&
+        aError) {
+      return std::unexpected{"Removal of segment " +
+                             std::to_string(_firstSegment) +
+                             " failed: " + aError.message()};
+    }
+  }
+  return getFirstRecordLocked();
+}
+
+std::uint64_t BlockStore::size() const {
+  std::shared_lock aLock{_mutex};
+  return _index.size();
+}
+
+std::uint64_t BlockStore::getFirstRecord() const {
+  std::shared_lock aLock{_mutex};
+  return getFirstRecordLocked();
+}
+
+std::uint64_t BlockStore::findTail(const std::uint64_t iMaxBytes) const {
+  std::shared_lock aLock{_mutex};
+  std::uint64_t aRecordId{_index.size()};
+  for (std::uint64_t aBytes{}; aRecordId > 0; --aRecordId) {
+    aBytes += _index[aRecordId - 1].length;
+    if (aBytes > iMaxBytes) {
+      break;
+    }
+  }
+  return aRecordId;
+}
+
+bool BlockStore::sync() {
+  std::unique_lock aLock{_mutex};
+  return syncLocked();
+}
+
+// Private API
+
+std::filesystem::path
+BlockStore::segmentPath(const std::uint32_t iSegment) const {
+  char aFileName[16]{};
+  std::snprintf(aFileName, sizeof(aFileName), "blk%05u.dat", iSegment);
+  return _directory / aFileName;
+}
+
+void BlockStore::openSegment(const std::uint32_t iSegment) {
+  const std::string aPath{segmentPath(iSegment).string()};
+  Segment aSegment{};
+  aSegment.fileDescriptor = ::open(aPath.c_str(), O_RDWR | O_CREAT, 0644);
+  if (aSegment.fileDescriptor < 0) {
+    throw core_lib::exception::StorageError{ErrnoMessage("open " + aPath)};
+  }
+  aSegment.size = FileSize(aSegment.fileDescriptor);
+  aSegment.mappingSize = std::max(aSegment.size, _options.segmentSize);
+
+  void* aMapping{::mmap(nullptr, aSegment.mappingSize, PROT_READ, MAP_SHARED,
+                        aSegment.fileDescriptor, 0)};
+  if (aMapping == MAP_FAILED) {
+    const std::string aErrorMessage{ErrnoMessage("mmap " + aPath)};
+    ::close(aSegment.fileDescriptor);
+    throw core_lib::exception::StorageError{aErrorMessage};
+  }
+  aSegment.mapping = static_cast<const char*>(aMapping);
+  _segments.push_back(aSegment);
+}
+
+void BlockStore::closeSegment(Segment& ioSegment) {
+  if (ioSegment.mapping) {
+    ::munmap(const_cast<char*>(ioSegment.mapping), ioSegment.mappingSize);
+    ioSegment.mapping = nullptr;
+  }
+  if (ioSegment.fileDescriptor >= 0) {
+    ::close(ioSegment.fileDescriptor);
+    ioSegment.fileDescriptor = -1;
+  }
+}
+
+std::uint64_t BlockStore::getFirstRecordLocked() const {
+  return static_cast<std::uint64_t>(
+      std::partition_point(_index.begin(), _index.end(),
+                           [this](const IndexEntry& iEntry) {
+                             return iEntry.segment < _firstSegment;
+                           }) -
+      _index.begin());
+}
+
+void BlockStore::recover() {
+  // Load every index entry that is intact and contiguous with its predecessor.
+  const std::uint64_t aIndexFileSize{FileSize(_indexFileDescriptor)};
+  std::string aIndexBytes(static_cast<std::size_t>(aIndexFileSize), '\0');
+  std::uint64_t aRead{};
+  while (aRead < aIndexFileSize) {
+    const ssize_t aChunk{::pread(_indexFileDescriptor,
+                                 aIndexBytes.data() + aRead,
+                                 aIndexFileSize - aRead,
+                                 static_cast<off_t>(aRead))};
+    if (aChunk <= 0) {
+      if (aChunk < 0 && errno == EINTR) {
+        continue;
+      }
+      throw core_lib::exception::StorageError{ErrnoMessage("Index read")};
+    }
+    aRead += static_cast<std::uint64_t>(aChunk);
+  }
+
+  ByteReader aReader{aIndexBytes};
+  _index.reserve(static_cast<std::size_t>(aIndexFileSize / kIndexEntrySize));
+  while (aReader.remaining() >= kIndexEntrySize) {
+    const std::size_t aEntryStart{aReader.position()};
+    IndexEntry aEntry{};
+    std::uint32_t aEntryChecksum{};
+    aReader.getU64(aEntry.offset);
+    aReader.getU32(aEntry.segment);
+    aReader.getU32(aEntry.length);
+    aReader.getU32(aEntry.checksum);
+    aReader.getU32(aEntryChecksum);
+    if (aEntryChecksum != Crc32c(aIndexBytes.data() + aEntryStart,
+                                 kIndexEntrySize - sizeof(aEntryChecksum))) {
+      break;
+    }
+    if (!_index.empty()) {
+      const IndexEntry& aPrevious{_index.back()};
+      const std::uint64_t aPreviousEnd{aPrevious.offset + kFrameHeaderSize +
+                                       aPrevious.length};
+      const bool aIsContiguous{
+          (aEntry.segment == aPrevious.segment &&
+           aEntry.offset == aPreviousEnd) ||
+          (aEntry.segment == aPrevious.segment + 1 && aEntry.offset == 0)};
+      if (!aIsContiguous) {
+        break;
+      }
+    } else if (aEntry.segment != 0 || aEntry.offset != 0) {
+      break;
+    }
+    _index.push_back(aEntry);
+  }
+  const std::uint64_t aLoadedEntries{_index.size()};
+
+  // Drop trailing entries whose record did not fully reach the disk. Entries
+  // of pruned segments were synced before pruning and cannot be checked.
+  while (!_index.empty() && _index.back().segment >= _firstSegment &&
+         !isRecordValid(_index.back())) {
+    _index.pop_back();
+  }
+  if (_firstSegment &&
+      (_index.empty() || _index.back().segment + 1 < _firstSegment)) {
+    throw core_lib::exception::StorageError{
+        "Index lost entries of pruned segments."};
+  }
+  const std::uint64_t aKeptEntries{_index.size()};
+
+  // Index valid records that were written after the last index entry.
+  std::uint32_t aSegment{};
+  std::uint64_t aOffset{};
+  if (!_index.empty()) {
+    aSegment = _index.back().segment;
+    aOffset = _index.back().offset + kFrameHeaderSize + _index.back().length;
+  }
+  bool aIsTorn{false};
+  for (; aSegment < _segments.size(); ++aSegment, aOffset = 0) {
+    Segment& aCurrent{_segments[aSegment]};
+    while (aOffset + kFrameHeaderSize <= aCurrent.size) {
+      const IndexEntry aEntry{
+          aOffset, aSegment, ReadU32(aCurrent.mapping + aOffset + 4),
+          ReadU32(aCurrent.mapping + aOffset + 8)};
+      if (!isRecordValid(aEntry)) {
+        break;
+      }
+      _index.push_back(aEntry);
+      aOffset += kFrameHeaderSize + aEntry.length;
+    }
+    if (aOffset < aCurrent.size) {
+      aIsTorn = true;
+      break;
+    }
+  }
+
+  if (aIsTorn) {
+    sLog.toFile(LogLevel::WARNING,
+                "Truncating torn tail of segment " + std::to_string(aSegment) +
+                    " at offset " + std::to_string(aOffset) + ".",
+                __PRETTY_FUNCTION__);
+    if (::ftruncate(_segments[aSegment].fileDescriptor,
+                    static_cast<off_t>(aOffset)) != 0) {
+      throw core_lib::exception::StorageError{ErrnoMessage("ftruncate")};
+    }
+    _segments[aSegment].size = aOffset;
+    // Segments are filled in order, so nothing after a torn record is valid.
+    while (_segments.size() > aSegment + 1) {
+      closeSegment(_segments.back());
+      std::filesystem::remove(
+          segmentPath(static_cast<std::uint32_t>(_segments.size() - 1)));
+      _segments.pop_back();
+    }
+  }
+
+  // Bring the index file in line with the recovered entries.
+  if (aIndexFileSize != aKeptEntries * kIndexEntrySize) {
+    if (::ftruncate(_indexFileDescriptor,
+                    static_cast<off_t>(aKeptEntries * kIndexEntrySize)) != 0) {
+      throw core_lib::exception::StorageError{ErrnoMessage("ftruncate")};
+    }
+  }
+  for (std::uint64_t aRecordId{aKeptEntries}; aRecordId < _index.size();
+       ++aRecordId) {
+    if (!writeIndexEntry(aRecordId, _index[aRecordId])) {
+      throw core_lib::exception::StorageError{ErrnoMessage("Index write")};
+    }
+  }
+  if (aIsTorn || aKeptEntries != aLoadedEntries ||
+      aKeptEntries != _index.size() ||
+      aIndexFileSize != aLoadedEntries * kIndexEntrySize) {
+    sLog.toFile(LogLevel::WARNING,
+                "Recovered block store with " + std::to_string(_index.size()) +
+                    " record(s).",
+                __PRETTY_FUNCTION__);
+    if (::fdatasync(_segments.back().fileDescriptor) != 0 ||
+        ::fdatasync(_indexFileDescriptor) != 0) {
+      throw core_lib::exception::StorageError{ErrnoMessage("fdatasync")};
+    }
+  }
+
+  // Only the last segment is written to; the mappings outlive the descriptors.
+  for (std::size_t aIndex{_firstSegment}; aIndex + 1 < _segments.size();
+       ++aIndex) {
+    ::close(_segments[aIndex].fileDescriptor);
+    _segments[aIndex].fileDescriptor = -1;
+  }
+}
+
+bool BlockStore::isRecordValid(const IndexEntry& iEntry) const {
+  if (iEntry.segment >= _segments.size()) {
+    return false;
+  }
+  const Segment& aSegment{_segments[iEntry.segment]};
+  if (iEntry.offset + kFrameHeaderSize + iEntry.length > aSegment.size) {
+    return false;
+  }
+  const char* aFrame{aSegment.mapping + iEntry.offset};
+  return ReadU32(aFrame) == kFrameMagic &&
+         ReadU32(aFrame + 4) == iEntry.length &&
+         ReadU32(aFrame + 8) == iEntry.checksum &&
+         Crc32c(aFrame + kFrameHeaderSize, iEntry.length) == iEntry.checksum;
+}
+
+bool BlockStore::writeIndexEntry(const std::uint64_t iRecordId,
+                                 const IndexEntry& iEntry) {
+  ByteWriter aWriter{kIndexEntrySize};
+  aWriter.putU64(iEntry.offset);
+  aWriter.putU32(iEntry.segment);
+  aWriter.putU32(iEntry.length);
+  aWriter.putU32(iEntry.checksum);
+  aWriter.putU32(Crc32c(aWriter.buffer().data(), aWriter.size()));
+  return WriteAll(_indexFileDescriptor, aWriter.buffer(),
+                  iRecordId * kIndexEntrySize);
+}
+
+bool BlockStore::syncLocked() {
+  if (!_unsyncedRecords) {
+    return true;
+  }
+  // Records before index entries: recovery trusts the segments, not the index.
+  if (::fdatasync(_segments.back().fileDescriptor) != 0 ||
+      ::fdatasync(_indexFileDescriptor) != 0) {
+    return false;
+  }
+  _unsyncedRecords = 0;
+  return true;
+}
+} // namespace storage
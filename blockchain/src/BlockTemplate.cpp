@@ -0,0 +1,138 @@
+// author: georgiosmatzarapis
+
+#include <algorithm>
+#include <limits>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "BlockTemplate.hpp"
+
+namespace mempool {
+
+/* === Helpers === */
+
+namespace {
+struct Candidate {
+  const Entry* entry{};
+  /** Whether the selection reached the fee rate of the candidate. */
+  bool isVisited{};
+};
+
+struct OwnerState {
+  /** Candidates spent by the owner, in admission order. */
+  std::vector<std::size_t> pending{};
+  std::size_t next{};
+  /** Confirmed balance plus what was received in the template so far. */
+  std::uint64_t available{};
+  /** Set once a payload of the owner cannot fit, blocking its successors. */
+  bool isBlocked{};
+};
+} // namespace
+
+// Public API
+
+BlockTemplate BuildBlockTemplate(const Mempool& iMempool,
+                                 const chain::Chain& iChain,
+                                 const std::string& iMiner,
+                                 const TemplateOptions& iOptions) {
+  const ledger::Ledger& sLedger{iChain.getLedger()};
+
+  std::vector<Candidate> sCandidates{};
+  sCandidates.reserve(iMempool.size());
+  iMempool.forEachByFeeRate([&sCandidates](const Entry& iEntry) {
+    sCandidates.push_back(Candidate{&iEntry});
+    return true;
+  });
+
+  std::unordered_map<std::string_view, OwnerState> sOwners{};
+  sOwners.reserve(sCandidates.size());
+  const auto sStateOf{[&sOwners, &sLedger](std::string_view iOwner)
+                          -> OwnerState& {
+    const auto [sState, sIsInserted]{sOwners.try_emplace(iOwner)};
+    if (sIsInserted) {
+      sState->second.available = sLedger.getBalance(iOwner);
+    }
+    return sState->second;
+  }};
+  for (std::size_t sIndex{}; sIndex < sCandidates.size(); ++sIndex) {
+    sStateOf(sCandidates[sIndex].entry->payload.getOwner())
+        .pending.push_back(sIndex);
+  }
+  for (auto& [sOwner, sState] : sOwners) {
+    std::sort(
+        sState.pending.begin(), sState.pending.end(),
+        [&sCandidates](const std::size_t iLeft, const std::size_t iRight) {
+          return sCandidates[iLeft].entry->sequence <
+                 sCandidates[iRight].entry->sequence;
+        });
+  }
+
+  std::vector<const Entry*> sSelected{};
+  std::size_t sBytes{};
+  std::uint64_t sFees{};
+  // Selecting a payload may unblock the next payload of its owner, or one of
+  // its receiver waiting for funds; owners to revisit are kept on a worklist.
+  std::vector<std::string_view> sWorklist{};
+  const auto sSelectFrom{[&](std::string_view iOwner) {
+    sWorklist.push_back(iOwner);
+    while (!sWorklist.empty()) {
+      OwnerState& sState{sOwners.find(sWorklist.back())->second};
+      sWorklist.pop_back();
+      while (!sState.isBlocked && sState.next < sState.pending.size() &&
+             sSelected.size() < iOptions.maxPayloads) {
+        const Candidate& sCandidate{sCandidates[sState.pending[sState.next]]};
+        if (!sCandidate.isVisited) {
+          break;
+        }
+        const Entry& sEntry{*sCandidate.entry};
+        const std::uint64_t sAmount{sEntry.payload.getSatoshiAmount()};
+        if (sAmount > sState.available) {
+          break;
+        }
+        OwnerState& sReceiver{sStateOf(sEntry.payload.getReceiver())};
+        if (sBytes + sEntry.size > iOptions.maxBytes ||
+            (&sReceiver != &sState &&
+             sReceiver.available >
+                 std::numeric_limits<std::uint64_t>::max() - sAmount)) {
+          sState.isBlocked = true;
+          break;
+        }
+        sState.available -= sAmount;
+        sReceiver.available += sAmount;
+        sSelected.push_back(&sEntry);
+        sBytes += sEntry.size;
+        sFees += sEntry.fee;
+        ++sState.next;
+        if (&sReceiver != &sState) {
+          sWorklist.push_back(sEntry.payload.getReceiver());
+        }
+      }
+    }
+  }};
+
+  for (Candidate& sCandidate : sCandidates) {
+    if (sSelected.size() >= iOptions.maxPayloads) {
+      break;
+    }
+    sCandidate.isVisited = true;
+    sSelectFrom(sCandidate.entry->payload.getOwner());
+  }
+
+  std::vector<std::unique_ptr<transaction::Coinbase>> sCoinbases{};
+  sCoinbases.push_back(
+      std::make_unique<transaction::Coinbase>(iMiner, iOptions.coinbaseReward));
+  std::vector<std::unique_ptr<transaction::Payload>> sPayloads{};
+  sPayloads.reserve(sSelected.size());
+  for (const Entry* sEntry : sSelected) {
+    sPayloads.push_back(
+        std::make_unique<transaction::Payload>(sEntry->payload));
+  }
+
+  return BlockTemplate{block::Block::FromVerifiedTransactions(
+                           iChain.getTipHash().value_or(std::string{}),
+                           iChain.getLength(), std::move(sCoinbases),
+                           std::move(sPayloads)),
+                       sFees, sBytes};
+}
+} // namespace mempool
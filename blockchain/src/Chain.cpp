@@ -0,0 +1,566 @@
+// author: georgiosmatzarapis
+
+#include <algorithm>
+
+#include "Chain.hpp"
+#include "Codec.hpp"
+#include "Common.hpp"
+#include "Logger.hpp"
+#include "Snapshot.hpp"
+
+namespace chain {
+
+using namespace utils;
+
+static const Log& sLog{Log::GetInstance()};
+
+static constexpr std::size_t kSnapshotsKept{2};
+
+/* === Helpers === */
+
+static std::expected<block::Header, std::string>
+ReadHeader(const storage::BlockStore& iStore, const std::uint32_t iHeight) {
+  const std::expected<std::string_view, std::string> sRecord{
+      iStore.read(iHeight)};
+  if (!sRecord) {
+    return std::unexpected{sRecord.error()};
+  }
+  return block::codec::DecodeHeader(sRecord.value());
+}
+
+/* === Chain Class === */
+
+Chain::Chain(const std::filesystem::path& directory, ChainOptions options)
+    : _directory{directory}, _options{options},
+      _store{directory, options.store},
+      _headers{directory / "headers", options.store} {
+  repairHeaders();
+  const std::uint32_t aLength{getLength()};
+  _hashes.reserve(aLength);
+  _chainWork.reserve(aLength);
+  _heights.reserve(aLength);
+  for (std::uint32_t aHeight{}; aHeight < aLength; ++aHeight) {
+    const std::expected<block::Header, std::string> aHeader{
+        getHeader(aHeight)};
+    if (!aHeader) {
+      const std::string aErrorMessage{"Header of block " +
+                                      std::to_string(aHeight) +
+                                      " is unreadable: " + aHeader.error()};
+      sLog.toFile(LogLevel::ERROR, aErrorMessage, __PRETTY_FUNCTION__);
+      throw core_lib::exception::StorageError{aErrorMessage};
+    }
+    pushActive(aHeader.value().hash, aHeader.value());
+  }
+
+  for (std::uint32_t aHeight{restoreSnapshot()}; aHeight < aLength;
+       ++aHeight) {
+    const std::expected<block::Block, std::string> aBlock{getBlock(aHeight)};
+    std::expected<void, std::string> aConnected{};
+    ledger::UndoRecord aUndo{};
+    if (!aBlock) {
+      aConnected = std::unexpected{aBlock.error()};
+    } else if (aHeight + _options.maxReorgDepth >= aLength) {
+      aConnected = _ledger.connect(aBlock.value(), aUndo);
+    } else {
+      aConnected = _ledger.connect(aBlock.value());
+    }
+    if (!aConnected) {
+      const std::string aErrorMessage{"Replay of block " +
+                                      std::to_string(aHeight) +
+                                      " failed: " + aConnected.error()};
+      sLog.toFile(LogLevel::ERROR, aErrorMessage, __PRETTY_FUNCTION__);
+      throw core_lib::exception::StorageError{aErrorMessage};
+    }
+    if (aHeight + _options.maxReorgDepth >= aLength) {
+      pushUndo(std::move(aUndo));
+    }
+  }
+  pruneBlocks();
+}
+
+// Public API
+
+std::expected<void, std::string> Chain::append(const block::Block& iBlock) {
+  const std::string aHash{iBlock.getHash()};
+  if (_heights.contains(aHash) || _sideBlocks.contains(aHash)) {
+    return std::unexpected{std::string{"Block is already known."}};
+  }
+
+  const std::uint32_t aLength{getLength()};
+  const std::string aPreviousHash{iBlock.getPreviousHash()};
+  if (!aLength || aPreviousHash == _hashes.back()) {
+    if (iBlock.getIndex() != aLength) {
+      return std::unexpected{"Block index " +
+                             std::to_string(iBlock.getIndex()) +
+                             " does not match chain length " +
+                             std::to_string(aLength) + "."};
+    }
+    return connectTip(iBlock);
+  }
+
+  std::uint32_t aParentHeight{};
+  std::uint64_t aParentWork{};
+  if (const auto aActive{_heights.find(aPreviousHash)};
+      aActive != _heights.end()) {
+    aParentHeight = aActive->second;
+    aParentWork = _chainWork[aParentHeight];
+  } else if (const auto aSide{_sideBlocks.find(aPreviousHash)};
+             aSide != _sideBlocks.end()) {
+    aParentHeight = aSide->second.height;
+    aParentWork = aSide->second.chainWork;
+  } else {
+    return std::unexpected{
+        std::string{"Block previous hash does not match any known block."}};
+  }
+  if (iBlock.getIndex() != aParentHeight + 1) {
+    return std::unexpected{"Block index " + std::to_string(iBlock.getIndex()) +
+                           " does not follow its parent."};
+  }
+  if (iBlock.getIndex() + _options.maxReorgDepth < aLength) {
+    return std::unexpected{
+        std::string{"Block forks deeper than the maximum reorganisation."}};
+  }
+
+  const std::uint64_t aChainWork{aParentWork +
+                                 block::ComputeBlockWork(iBlock.getHeader())};
+  _sideBlocks.emplace(aHash, SideBlock{block::codec::Encode(iBlock),
+                                       aPreviousHash, iBlock.getIndex(),
+                                       aChainWork});
+  if (aChainWork > getWork()) {
+    return reorganize(aHash);
+  }
+  return {};
+}
+
+void Chain::addObserver(IObserver& iObserver) {
+  _observers.push_back(&iObserver);
+}
+
+void Chain::removeObserver(IObserver& iObserver) {
+  std::erase(_observers, &iObserver);
+}
+
+std::uint32_t Chain::getLength() const {
+  return static_cast<std::uint32_t>(_store.size());
+}
+
+std::optional<std::string> Chain::getTipHash() const {
+  return _hashes.empty() ? std::nullopt
+                         : std::make_optional(_hashes.back());
+}
+
+std::uint64_t Chain::getWork() const {
+  return _chainWork.empty() ? 0 : _chainWork.back();
+}
+
+const ledger::Ledger& Chain::getLedger() const { return _ledger; }
+
+std::optional<std::uint32_t>
+Chain::findHeight(const std::string& iHash) const {
+  const auto aHeight{_heights.find(iHash)};
+  return aHeight == _heights.end() ? std::nullopt
+                                   : std::make_optional(aHeight->second);
+}
+
+std::expected<block::Block, std::string>
+Chain::getBlock(const std::uint32_t iHeight) const {
+  const std::expected<std::string_view, std::string> aRecord{
+      getRawBlock(iHeight)};
+  if (!aRecord) {
+    return std::unexpected{aRecord.error()};
+  }
+  return block::codec::Decode(aRecord.value());
+}
+
+std::expected<block::Header, std::string>
+Chain::getHeader(const std::uint32_t iHeight) const {
+  return ReadHeader(_headers, iHeight);
+}
+
+std::uint32_t Chain::getFirstBlockHeight() const {
+  return static_cast<std::uint32_t>(_store.getFirstRecord());
+}
+
+std::expected<std::string_view, std::string>
+Chain::getRawBlock(const std::uint32_t iHeight) const {
+  return _store.read(iHeight);
+}
+
+bool Chain::sync() {
+  // Headers after blocks: on opening, missing headers are rebuilt from blocks.
+  const bool aIsStoreSynced{_store.sync()};
+  return _headers.sync() && aIsStoreSynced;
+}
+
+// Private API
+
+std::uint32_t Chain::restoreSnapshot() {
+  if (!_options.snapshotInterval) {
+    return 0;
+  }
+  // A snapshot is only usable if the blocks it covers are all still part of
+  // the active chain, which is checked through the hash of its last block.
+  std::expected<ledger::Snapshot, std::string> aSnapshot{
+      ledger::LoadLatestSnapshot(
+          _directory, [this](const std::uint32_t iChainLength,
+                             const std::string& iTipHash) {
+            return iChainLength > 0 && iChainLength <= _hashes.size() &&
+                   _hashes[iChainLength - 1] == iTipHash;
+          })};
+  if (!aSnapshot) {
+    return 0;
+  }
+  _ledger = std::move(aSnapshot.value().ledger);
+  _snapshotLengths.push_back(aSnapshot.value().chainLength);
+  sLog.toFile(LogLevel::INFO,
+              "Ledger restored from snapshot at chain length " +
+                  std::to_string(aSnapshot.value().chainLength) + ".",
+              __PRETTY_FUNCTION__);
+  return aSnapshot.value().chainLength;
+}
+
+void Chain::writeSnapshot() {
+  // Blocks covered by the snapshot must reach the disk before it does.
+  if (!_store.sync()) {
+    sLog.toFile(LogLevel::WARNING, "Snapshot skipped, block store sync failed.",
+                __PRETTY_FUNCTION__);
+    return;
+  }
+  if (const std::expected<void, std::string> aWritten{ledger::WriteSnapshot(
+          _directory, _ledger, getLength(), _hashes.back(), kSnapshotsKept)};
+      !aWritten) {
+    sLog.toFile(LogLevel::WARNING, aWritten.error(), __PRETTY_FUNCTION__);
+    return;
+  }
+  _snapshotLengths.push_back(getLength());
+  while (_snapshotLengths.size() > kSnapshotsKept) {
+    _snapshotLengths.pop_front();
+  }
+}
+
+void Chain::repairHeaders() {
+  const std::uint32_t aLength{getLength()};
+  std::uint32_t aValidHeaders{
+      std::min(aLength, static_cast<std::uint32_t>(_headers.size()))};
+
+  // Only the tail can disagree, i.e. a reorganisation interrupted before the
+  // header store followed the block store.
+  const std::uint32_t aCheckFrom{std::max(
+      getFirstBlockHeight(), aValidHeaders > _options.maxReorgDepth
+                                 ? aValidHeaders - _options.maxReorgDepth
+                                 : 0)};
+  for (std::uint32_t aHeight{aCheckFrom}; aHeight < aValidHeaders; ++aHeight) {
+    const std::expected<block::Header, std::string> aBlockHeader{
+        ReadHeader(_store, aHeight)};
+    const std::expected<block::Header, std::string> aHeader{
+        getHeader(aHeight)};
+    if (!aBlockHeader || !aHeader ||
+        aBlockHeader.value().hash != aHeader.value().hash) {
+      aValidHeaders = aHeight;
+      break;
+    }
+  }
+  if (aValidHeaders == _headers.size() && aValidHeaders == aLength) {
+    return;
+  }
+
+  sLog.toFile(LogLevel::WARNING,
+              "Rebuilding headers from height " +
+                  std::to_string(aValidHeaders) + ".",
+              __PRETTY_FUNCTION__);
+  std::expected<void, std::string> aRepaired{_headers.truncate(aValidHeaders)};
+  for (std::uint32_t aHeight{aValidHeaders}; aRepaired && aHeight < aLength;
+       ++aHeight) {
+    const std::expected<block::Header, std::string> aBlockHeader{
+        ReadHeader(_store, aHeight)};
+    if (!aBlockHeader) {
+      aRepaired = std::unexpected{"Header of block " + std::to_string(aHeight) +
+                                  " is unreadable: " + aBlockHeader.error()};
+    } else if (const std::expected<std::uint64_t, std::string> aRecordId{
+                   _headers.append(
+                       block::codec::EncodeHeader(aBlockHeader.value()))};
+               !aRecordId) {
+      aRepaired = std::unexpected{aRecordId.error()};
+    }
+  }
+  if (!aRepaired || !_headers.sync()) {
+    const std::string aErrorMessage{
+        "Header store repair failed: " +
+        (aRepaired ? std::string{"sync failed."} : aRepaired.error())};
+    sLog.toFile(LogLevel::ERROR, aErrorMessage, __PRETTY_FUNCTION__);
+    throw core_lib::exception::StorageError{aErrorMessage};
+  }
+}
+
+void Chain::pruneBlocks() {
+  const PruningOptions& aPruning{_options.pruning};
+  if ((!aPruning.keepBlocks && !aPruning.keepBytes) ||
+      _snapshotLengths.empty()) {
+    return;
+  }
+  // Blocks after the oldest snapshot are replayed on opening, and blocks a
+  // reorganisation may disconnect are decoded again.
+  const std::uint32_t aLength{getLength()};
+  std::uint32_t aKeepFrom{std::min(
+      _snapshotLengths.front(),
+      aLength > _options.maxReorgDepth ? aLength - _options.maxReorgDepth : 0)};
+  if (aPruning.keepBlocks) {
+    aKeepFrom = std::min(
+        aKeepFrom, aLength > aPruning.keepBlocks ? aLength - aPruning.keepBlocks
+                                                 : 0);
+  }
+  if (aPruning.keepBytes) {
+    aKeepFrom = std::min(aKeepFrom, static_cast<std::uint32_t>(
+                                        _store.findTail(aPruning.keepBytes)));
+  }
+  if (aKeepFrom <= getFirstBlockHeight()) {
+    return;
+  }
+
+  // Headers of pruned blocks cannot be rebuilt anymore.
+  if (!_headers.sync()) {
+    sLog.toFile(LogLevel::WARNING, "Pruning skipped, header store sync failed.",
+                __PRETTY_FUNCTION__);
+    return;
+  }
+  const std::expected<std::uint64_t, std::string> aFirstRecord{
+      _store.prune(aKeepFrom)};
+  if (!aFirstRecord) {
+    sLog.toFile(LogLevel::WARNING, aFirstRecord.error(), __PRETTY_FUNCTION__);
+    return;
+  }
+  sLog.toFile(LogLevel::INFO,
+              "Block bodies stored from height " +
+                  std::to_string(aFirstRecord.value()) + ".",
+              __PRETTY_FUNCTION__);
+}
+
+std::expected<void, std::string>
+Chain::connectTip(const block::Block& iBlock) {
+  ledger::UndoRecord aUndo{};
+  if (const std::expected<void, std::string> aConnected{
+          _ledger.connect(iBlock, aUndo)};
+      !aConnected) {
+    return aConnected;
+  }
+
+  const std::expected<std::uint64_t, std::string> aRecordId{
+      _store.append(block::codec::Encode(iBlock))};
+  if (!aRecordId) {
+    sLog.toFile(LogLevel::ERROR, aRecordId.error(), __PRETTY_FUNCTION__);
+    static_cast<void>(_ledger.undo(aUndo));
+    return std::unexpected{aRecordId.error()};
+  }
+  if (const std::expected<std::uint64_t, std::string> aHeaderId{
+          _headers.append(block::codec::EncodeHeader(iBlock.getHeader()))};
+      !aHeaderId) {
+    sLog.toFile(LogLevel::ERROR, aHeaderId.error(), __PRETTY_FUNCTION__);
+    if (const std::expected<void, std::string> aTruncated{
+            _store.truncate(aRecordId.value())};
+        !aTruncated) {
+      throw core_lib::exception::StorageError{aTruncated.error()};
+    }
+    static_cast<void>(_ledger.undo(aUndo));
+    return std::unexpected{aHeaderId.error()};
+  }
+  pushActive(iBlock.getHash(), iBlock.getHeader());
+  pushUndo(std::move(aUndo));
+  if (_options.snapshotInterval &&
+      getLength() % _options.snapshotInterval == 0) {
+    writeSnapshot();
+    pruneBlocks();
+  }
+  pruneSideBlocks();
+  for (IObserver* aObserver : _observers) {
+    aObserver->onBlockConnected(iBlock);
+  }
+  return {};
+}
+
+std::expected<void, std::string>
+Chain::reorganize(const std::string& iTipHash) {
+  // Walk the side branch down to the block it forks from.
+  std::vector<std::string> aBranch{};
+  std::string aCursor{iTipHash};
+  while (!_heights.contains(aCursor)) {
+    const auto aSide{_sideBlocks.find(aCursor)};
+    if (aSide == _sideBlocks.end()) {
+      return std::unexpected{
+          std::string{"Side branch is missing blocks, it was pruned."}};
+    }
+    aBranch.push_back(aCursor);
+    aCursor = aSide->second.previousHash;
+  }
+  std::reverse(aBranch.begin(), aBranch.end());
+  const std::uint32_t aForkHeight{_heights.at(aCursor)};
+  const std::uint32_t aLength{getLength()};
+
+  // Decode both branches before touching the ledger.
+  std::vector<block::Block> aOldBlocks{};
+  std::vector<SideBlock> aOldSideBlocks{};
+  for (std::uint32_t aHeight{aLength}; aHeight-- > aForkHeight + 1;) {
+    const std::expected<std::string_view, std::string> aRecord{
+        getRawBlock(aHeight)};
+    if (!aRecord) {
+      return std::unexpected{aRecord.error()};
+    }
+    std::expected<block::Block, std::string> aBlock{
+        block::codec::Decode(aRecord.value())};
+    if (!aBlock) {
+      return std::unexpected{aBlock.error()};
+    }
+    aOldSideBlocks.push_back(SideBlock{std::string{aRecord.value()},
+                                       aBlock.value().getPreviousHash(),
+                                       aHeight, _chainWork[aHeight]});
+    aOldBlocks.push_back(std::move(aBlock.value()));
+  }
+  std::vector<block::Block> aNewBlocks{};
+  for (const std::string& aHash : aBranch) {
+    std::expected<block::Block, std::string> aBlock{
+        block::codec::Decode(_sideBlocks.at(aHash).record)};
+    if (!aBlock) {
+      _sideBlocks.erase(aHash);
+      return std::unexpected{aBlock.error()};
+    }
+    aNewBlocks.push_back(std::move(aBlock.value()));
+  }
+
+  for (const block::Block& aBlock : aOldBlocks) {
+    if (const std::expected<void, std::string> aDisconnected{
+            disconnectTip(aBlock)};
+        !aDisconnected) {
+      sLog.toFile(LogLevel::ERROR, aDisconnected.error(), __PRETTY_FUNCTION__);
+      throw core_lib::exception::StorageError{aDisconnected.error()};
+    }
+  }
+  std::vector<ledger::UndoRecord> aNewUndoRecords{};
+  for (std::size_t aIndex{}; aIndex < aNewBlocks.size(); ++aIndex) {
+    ledger::UndoRecord aUndo{};
+    const std::expected<void, std::string> aConnected{
+        _ledger.connect(aNewBlocks[aIndex], aUndo)};
+    if (aConnected) {
+      aNewUndoRecords.push_back(std::move(aUndo));
+      continue;
+    }
+    // Put the active chain back and forget the invalid part of the branch.
+    for (auto aNewUndo{aNewUndoRecords.rbegin()};
+         aNewUndo != aNewUndoRecords.rend(); ++aNewUndo) {
+      static_cast<void>(_ledger.undo(*aNewUndo));
+    }
+    for (auto aOldBlock{aOldBlocks.rbegin()}; aOldBlock != aOldBlocks.rend();
+         ++aOldBlock) {
+      ledger::UndoRecord aOldUndo{};
+      static_cast<void>(_ledger.connect(*aOldBlock, aOldUndo));
+      pushUndo(std::move(aOldUndo));
+    }
+    for (std::size_t aInvalid{aIndex}; aInvalid < aBranch.size(); ++aInvalid) {
+      _sideBlocks.erase(aBranch[aInvalid]);
+    }
+    return std::unexpected{"Reorganisation aborted, block " +
+                           std::to_string(aNewBlocks[aIndex].getIndex()) +
+                           " of the branch is invalid: " + aConnected.error()};
+  }
+
+  // The ledger is switched; make the stores follow, headers last.
+  std::expected<void, std::string> aStored{_store.truncate(aForkHeight + 1)};
+  for (std::size_t aIndex{}; aStored && aIndex < aBranch.size(); ++aIndex) {
+    const std::expected<std::uint64_t, std::string> aRecordId{
+        _store.append(_sideBlocks.at(aBranch[aIndex]).record)};
+    if (!aRecordId) {
+      aStored = std::unexpected{aRecordId.error()};
+    }
+  }
+  if (aStored) {
+    aStored = _headers.truncate(aForkHeight + 1);
+  }
+  for (std::size_t aIndex{}; aStored && aIndex < aNewBlocks.size(); ++aIndex) {
+    const std::expected<std::uint64_t, std::string> aRecordId{_headers.append(
+        block::codec::EncodeHeader(aNewBlocks[aIndex].getHeader()))};
+    if (!aRecordId) {
+      aStored = std::unexpected{aRecordId.error()};
+    }
+  }
+  if (!aStored) {
+    sLog.toFile(LogLevel::ERROR, aStored.error(), __PRETTY_FUNCTION__);
+    throw core_lib::exception::StorageError{aStored.error()};
+  }
+
+  for (std::uint32_t aHeight{aForkHeight + 1}; aHeight < aLength; ++aHeight) {
+    _heights.erase(_hashes[aHeight]);
+  }
+  _hashes.resize(aForkHeight + 1);
+  _chainWork.resize(aForkHeight + 1);
+  for (std::size_t aIndex{}; aIndex < aOldBlocks.size(); ++aIndex) {
+    _sideBlocks.emplace(aOldBlocks[aIndex].getHash(),
+                        std::move(aOldSideBlocks[aIndex]));
+  }
+  for (std::size_t aIndex{}; aIndex < aBranch.size(); ++aIndex) {
+    _sideBlocks.erase(aBranch[aIndex]);
+    pushActive(aBranch[aIndex], aNewBlocks[aIndex].getHeader());
+    pushUndo(std::move(aNewUndoRecords[aIndex]));
+  }
+  sLog.toFile(LogLevel::INFO,
+              "Reorganised " + std::to_string(aOldBlocks.size()) +
+                  " block(s) onto a branch of " +
+                  std::to_string(aNewBlocks.size()) + " block(s) from height " +
+                  std::to_string(aForkHeight + 1) + ".",
+              __PRETTY_FUNCTION__);
+
+  // Snapshots covering disconnected blocks are stale; the pruned blocks they
+  // start from would leave no usable snapshot to open the chain from.
+  const bool aHasStaleSnapshot{std::erase_if(
+      _snapshotLengths, [aForkHeight](const std::uint32_t iSnapshotLength) {
+        return iSnapshotLength > aForkHeight + 1;
+      }) > 0};
+  if (_options.snapshotInterval &&
+      (aHasStaleSnapshot || getLength() % _options.snapshotInterval == 0)) {
+    writeSnapshot();
+    pruneBlocks();
+  }
+  pruneSideBlocks();
+  for (IObserver* aObserver : _observers) {
+    for (const block::Block& aBlock : aOldBlocks) {
+      aObserver->onBlockDisconnected(aBlock);
+    }
+    for (const block::Block& aBlock : aNewBlocks) {
+      aObserver->onBlockConnected(aBlock);
+    }
+  }
+  return {};
+}
+
+std::expected<void, std::string>
+Chain::disconnectTip(const block::Block& iBlock) {
+  if (_undoRecords.empty()) {
+    return _ledger.disconnect(iBlock);
+  }
+  const std::expected<void, std::string> aUndone{
+      _ledger.undo(_undoRecords.back())};
+  _undoRecords.pop_back();
+  return aUndone;
+}
+
+void Chain::pushActive(const std::string& iHash, const block::Header& iHeader) {
+  _heights.emplace(iHash, static_cast<std::uint32_t>(_hashes.size()));
+  _chainWork.push_back(getWork() + block::ComputeBlockWork(iHeader));
+  _hashes.push_back(iHash);
+}
+
+void Chain::pushUndo(ledger::UndoRecord&& ioUndo) {
+  _undoRecords.push_back(std::move(ioUndo));
+  while (_undoRecords.size() > _options.maxReorgDepth) {
+    _undoRecords.pop_front();
+  }
+}
+
+void Chain::pruneSideBlocks() {
+  const std::uint32_t aLength{getLength()};
+  if (aLength <= _options.maxReorgDepth) {
+    return;
+  }
+  const std::uint32_t aMinHeight{aLength - _options.maxReorgDepth};
+  std::erase_if(_sideBlocks, [aMinHeight](const auto& iSideBlock) {
+    return iSideBlock.second.height < aMinHeight;
+  });
+}
+} // namespace chain
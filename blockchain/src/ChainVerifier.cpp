@@ -0,0 +1,268 @@
+// author: georgiosmatzarapis
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "ChainVerifier.hpp"
+#include "Common.hpp"
+#include "Logger.hpp"
+
+namespace chain {
+
+using namespace utils;
+
+static const Log& sLog{Log::GetInstance()};
+
+static constexpr std::uint32_t kBlocksPerClaim{32};
+
+/* === Helpers === */
+
+struct BlockLinks {
+  std::string hash{};
+  std::string previousHash{};
+};
+
+/**
+ * @brief Check that a header sits at its height and carries a valid
+ * proof-of-work.
+ */
+static std::expected<void, std::string>
+VerifyHeader(const block::Header& iHeader, const std::uint32_t iHeight,
+             BlockLinks& ioLinks) {
+  if (iHeader.index != iHeight) {
+    return std::unexpected{"Index " + std::to_string(iHeader.index) +
+                           " stored at height " + std::to_string(iHeight) +
+                           "."};
+  }
+  const std::expected<std::string, std::string> sBlockHash{
+      block::ComputeBlockHash(iHeader)};
+  if (!sBlockHash) {
+    return std::unexpected{sBlockHash.error()};
+  }
+  if (sBlockHash.value() != iHeader.hash ||
+      !block::MeetsTargetDifficulty(iHeader.hash)) {
+    return std::unexpected{std::string{"Invalid proof-of-work."}};
+  }
+
+  ioLinks.hash = iHeader.hash;
+  ioLinks.previousHash = iHeader.previousHash;
+  return {};
+}
+
+/**
+ * @brief Run the block-local checks of a stored block. Only the header of a
+ * pruned block is checked.
+ * @return Number of transactions of the block, or the reason it is invalid.
+ */
+static std::expected<std::uint64_t, std::string>
+VerifyBlock(const Chain& iChain, const std::uint32_t iHeight,
+            BlockLinks& ioLinks) {
+  if (iHeight < iChain.getFirstBlockHeight()) {
+    const std::expected<block::Header, std::string> sHeader{
+        iChain.getHeader(iHeight)};
+    if (!sHeader) {
+      return std::unexpected{sHeader.error()};
+    }
+    if (const auto sResult{VerifyHeader(sHeader.value(), iHeight, ioLinks)};
+        !sResult) {
+      return std::unexpected{sResult.error()};
+    }
+    return 0;
+  }
+
+  const std::expected<block::Block, std::string> sBlock{
+      iChain.getBlock(iHeight)};
+  if (!sBlock) {
+    return std::unexpected{sBlock.error()};
+  }
+  const block::Header sHeader{sBlock.value().getHeader()};
+
+  std::vector<std::string> sTransactionHashes{};
+  const auto sCheckTransaction{[&sTransactionHashes](auto& ioTransaction)
+                                   -> std::expected<void, std::string> {
+    const std::string sHash{ioTransaction->getHash()};
+    const std::expected<bool, std::string> sIsHashValid{
+        core_lib::IsHashValid(ioTransaction->getHashMessage(), sHash)};
+    if (!sIsHashValid) {
+      return std::unexpected{sIsHashValid.error()};
+    }
+    if (!sIsHashValid.value()) {
+      return std::unexpected{std::string{"Transaction hash inconsistency."}};
+    }
+    sTransactionHashes.push_back(sHash);
+    return {};
+  }};
+
+  if (const auto& sCoinbases{sBlock.value().getCoinbases()};
+      sCoinbases.has_value()) {
+    for (const auto& sCoinbase : sCoinbases.value()) {
+      if (const auto sResult{sCheckTransaction(sCoinbase)}; !sResult) {
+        return std::unexpected{sResult.error()};
+      }
+    }
+  }
+  if (const auto& sPayloads{sBlock.value().getPayloads()};
+      sPayloads.has_value()) {
+    for (const auto& sPayload : sPayloads.value()) {
+      if (const auto sResult{sCheckTransaction(sPayload)}; !sResult) {
+        return std::unexpected{sResult.error()};
+      }
+    }
+  }
+
+  const std::expected<std::string, std::string> sMerkleRootHash{
+      block::ComputeMerkleRootHash(sTransactionHashes)};
+  if (!sMerkleRootHash) {
+    return std::unexpected{sMerkleRootHash.error()};
+  }
+  if (sMerkleRootHash.value() != sHeader.merkleRootHash) {
+    return std::unexpected{std::string{"Merkle root hash mismatch."}};
+  }
+
+  if (const auto sResult{VerifyHeader(sHeader, iHeight, ioLinks)}; !sResult) {
+    return std::unexpected{sResult.error()};
+  }
+  return sTransactionHashes.size();
+}
+
+static VerificationProgress
+MakeProgress(const std::uint32_t iVerifiedBlocks,
+             const std::uint32_t iTotalBlocks,
+             const std::uint64_t iVerifiedTransactions,
+             const std::chrono::steady_clock::time_point& iStart) {
+  VerificationProgress sProgress{iVerifiedBlocks, iTotalBlocks,
+                                 iVerifiedTransactions};
+  sProgress.elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+      std::chrono::steady_clock::now() - iStart);
+  const double sSeconds{
+      std::chrono::duration<double>(std::chrono::steady_clock::now() - iStart)
+          .count()};
+  if (sSeconds > 0) {
+    sProgress.blocksPerSecond = iVerifiedBlocks / sSeconds;
+    sProgress.transactionsPerSecond = iVerifiedTransactions / sSeconds;
+  }
+  return sProgress;
+}
+
+/* === ChainVerifier Class === */
+
+ChainVerifier::ChainVerifier(const Chain& chain, const unsigned int threads,
+                             const std::chrono::milliseconds progressInterval)
+    : _chain{chain},
+      _threads{threads ? threads
+                       : std::max(1u, std::thread::hardware_concurrency())},
+      _progressInterval{progressInterval} {}
+
+// Public API
+
+VerificationReport
+ChainVerifier::run(const ProgressCallback& iOnProgress) const {
+  const auto aStart{std::chrono::steady_clock::now()};
+  const std::uint32_t aTotalBlocks{_chain.getLength()};
+
+  std::vector<BlockLinks> aLinks(aTotalBlocks);
+  std::atomic<std::uint32_t> aNextHeight{};
+  std::atomic<std::uint32_t> aVerifiedBlocks{};
+  std::atomic<std::uint64_t> aVerifiedTransactions{};
+  std::atomic<std::uint32_t> aInvalidHeight{aTotalBlocks};
+  std::string aError{};
+  std::mutex aMutex{};
+  std::condition_variable aDone{};
+  unsigned int aRunningWorkers{std::min(
+      _threads, std::max(1u, (aTotalBlocks + kBlocksPerClaim - 1) /
+                                 kBlocksPerClaim))};
+
+  const auto aWorker{[&]() {
+    for (;;) {
+      const std::uint32_t aFirst{aNextHeight.fetch_add(kBlocksPerClaim)};
+      if (aFirst >= aTotalBlocks || aFirst >= aInvalidHeight.load()) {
+        break;
+      }
+      const std::uint32_t aLast{
+          std::min(aTotalBlocks, aFirst + kBlocksPerClaim)};
+      for (std::uint32_t aHeight{aFirst}; aHeight < aLast; ++aHeight) {
+        const std::expected<std::uint64_t, std::string> aTransactions{
+            VerifyBlock(_chain, aHeight, aLinks[aHeight])};
+        if (!aTransactions) {
+          std::lock_guard aLock{aMutex};
+          if (aHeight < aInvalidHeight.load()) {
+            aInvalidHeight.store(aHeight);
+            aError = aTransactions.error();
+          }
+          break;
+        }
+        aVerifiedTransactions.fetch_add(aTransactions.value(),
+                                        std::memory_order_relaxed);
+        aVerifiedBlocks.fetch_add(1, std::memory_order_relaxed);
+      }
+    }
+    std::lock_guard aLock{aMutex};
+    if (--aRunningWorkers == 0) {
+      aDone.notify_one();
+    }
+  }};
+
+  std::vector<std::jthread> aWorkers{};
+  const unsigned int aWorkerCount{aRunningWorkers};
+  aWorkers.reserve(aWorkerCount);
+  for (unsigned int aIndex{}; aIndex < aWorkerCount; ++aIndex) {
+    aWorkers.emplace_back(aWorker);
+  }
+
+  {
+    std::unique_lock aLock{aMutex};
+    while (!aDone.wait_for(aLock, _progressInterval,
+                           [&]() { return aRunningWorkers == 0; })) {
+      const VerificationProgress aProgress{
+          MakeProgress(aVerifiedBlocks.load(), aTotalBlocks,
+                       aVerifiedTransactions.load(), aStart)};
+      aLock.unlock();
+      sLog.toFile(LogLevel::INFO,
+                  "Verified " + std::to_string(aProgress.verifiedBlocks) + "/" +
+                      std::to_string(aTotalBlocks) + " blocks (" +
+                      std::to_string(static_cast<std::uint64_t>(
+                          aProgress.blocksPerSecond)) +
+                      " blocks/s).",
+                  __PRETTY_FUNCTION__);
+      if (iOnProgress) {
+        iOnProgress(aProgress);
+      }
+      aLock.lock();
+    }
+  }
+  aWorkers.clear();
+
+  VerificationReport aReport{};
+  aReport.progress = MakeProgress(aVerifiedBlocks.load(), aTotalBlocks,
+                                  aVerifiedTransactions.load(), aStart);
+  if (iOnProgress) {
+    iOnProgress(aReport.progress);
+  }
+
+  // Linkage pass, up to the first block that failed its local checks.
+  std::uint32_t aInvalid{aInvalidHeight.load()};
+  for (std::uint32_t aHeight{1}; aHeight < aInvalid; ++aHeight) {
+    if (aLinks[aHeight].previousHash != aLinks[aHeight - 1].hash) {
+      aInvalid = aHeight;
+      aError = "Previous hash does not match the hash of block " +
+               std::to_string(aHeight - 1) + ".";
+      break;
+    }
+  }
+
+  aReport.isValid = aInvalid == aTotalBlocks;
+  if (!aReport.isValid) {
+    aReport.invalidHeight = aInvalid;
+    aReport.error = aError;
+    sLog.toFile(LogLevel::ERROR,
+                "Block " + std::to_string(aInvalid) +
+                    " failed verification: " + aError,
+                __PRETTY_FUNCTION__);
+  }
+  return aReport;
+}
+} // namespace chain
@@ -0,0 +1,382 @@
+// author: georgiosmatzarapis
+
+#include <cmath>
+#include <unordered_map>
+
+#include "Codec.hpp"
+#include "ByteStream.hpp"
+
+namespace block {
+namespace codec {
+
+using namespace utils;
+
+static constexpr std::uint8_t kLegacyFormatVersion{1};
+static constexpr std::uint8_t kFormatVersion{2};
+static constexpr std::uint8_t kHasCoinbases{0x01};
+static constexpr std::uint8_t kHasPayloads{0x02};
+static constexpr std::int64_t kNanosecondsPerSecond{1000000000};
+/** Amounts that are not a whole number of satoshi are stored as is. */
+static constexpr std::uint64_t kRawAmount{1};
+
+/* === Helpers === */
+
+static std::int64_t ToNanoseconds(
+    const std::chrono::system_clock::time_point& iTimestamp) {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             iTimestamp.time_since_epoch())
+      .count();
+}
+
+static std::chrono::system_clock::time_point
+FromNanoseconds(const std::int64_t iNanoseconds) {
+  return std::chrono::system_clock::time_point{
+      std::chrono::duration_cast<std::chrono::system_clock::duration>(
+          std::chrono::nanoseconds{iNanoseconds})};
+}
+
+/**
+ * @brief Write a timestamp as the difference of its whole seconds with the
+ * creation time of the block, followed by the remaining nanoseconds.
+ */
+static void
+WriteTimestamp(const std::chrono::system_clock::time_point& iTimestamp,
+               const std::time_t iCreationTime, ByteWriter& ioWriter) {
+  const std::int64_t sNanoseconds{ToNanoseconds(iTimestamp)};
+  std::int64_t sSeconds{sNanoseconds / kNanosecondsPerSecond};
+  if (sNanoseconds % kNanosecondsPerSecond < 0) {
+    --sSeconds;
+  }
+  ioWriter.putVarI64(sSeconds - static_cast<std::int64_t>(iCreationTime));
+  ioWriter.putVarU64(static_cast<std::uint64_t>(
+      sNanoseconds - sSeconds * kNanosecondsPerSecond));
+}
+
+static bool ReadTimestamp(ByteReader& ioReader, const std::time_t iCreationTime,
+                          std::int64_t& ioNanoseconds) {
+  std::int64_t sSecondsDelta{};
+  std::uint64_t sNanoseconds{};
+  if (!ioReader.getVarI64(sSecondsDelta) || !ioReader.getVarU64(sNanoseconds)) {
+    return false;
+  }
+  ioNanoseconds =
+      (static_cast<std::int64_t>(iCreationTime) + sSecondsDelta) *
+          kNanosecondsPerSecond +
+      static_cast<std::int64_t>(sNanoseconds);
+  return true;
+}
+
+/**
+ * @brief Write an amount as a varint of satoshi, shifted to leave room for
+ * the kRawAmount marker, when the conversion is exact.
+ */
+static void WriteAmount(const double iBitcoinAmount, ByteWriter& ioWriter) {
+  const double sSatoshi{std::round(iBitcoinAmount * 1e8)};
+  if (sSatoshi >= 0 && sSatoshi < 0x1p62 && sSatoshi / 1e8 == iBitcoinAmount) {
+    ioWriter.putVarU64(static_cast<std::uint64_t>(sSatoshi) << 1);
+    return;
+  }
+  ioWriter.putVarU64(kRawAmount);
+  ioWriter.putF64(iBitcoinAmount);
+}
+
+static bool ReadAmount(ByteReader& ioReader, double& ioBitcoinAmount) {
+  std::uint64_t sAmount{};
+  if (!ioReader.getVarU64(sAmount)) {
+    return false;
+  }
+  if (sAmount == kRawAmount) {
+    return ioReader.getF64(ioBitcoinAmount);
+  }
+  ioBitcoinAmount = static_cast<double>(sAmount >> 1) / 1e8;
+  return true;
+}
+
+static void WriteShortString(std::string_view iValue, ByteWriter& ioWriter) {
+  ioWriter.putVarU64(iValue.size());
+  ioWriter.putBytes(iValue);
+}
+
+static bool ReadShortString(ByteReader& ioReader, std::string_view& ioValue) {
+  std::uint64_t sSize{};
+  return ioReader.getVarU64(sSize) &&
+         ioReader.getBytes(static_cast<std::size_t>(sSize), ioValue);
+}
+
+/**
+ * @brief Dictionary of the owners and receivers of a block, in order of first
+ * appearance.
+ */
+class OwnerDictionary {
+ public:
+  std::uint32_t intern(const std::string& iOwner) {
+    const auto [sEntry, sIsNew]{_ids.try_emplace(
+        iOwner, static_cast<std::uint32_t>(_owners.size()))};
+    if (sIsNew) {
+      _owners.push_back(&sEntry->first);
+    }
+    return sEntry->second;
+  }
+
+  void write(ByteWriter& ioWriter) const {
+    ioWriter.putVarU64(_owners.size());
+    for (const std::string* sOwner : _owners) {
+      WriteShortString(*sOwner, ioWriter);
+    }
+  }
+
+ private:
+  std::unordered_map<std::string, std::uint32_t> _ids{};
+  std::vector<const std::string*> _owners{};
+};
+
+static bool ReadOwner(ByteReader& ioReader,
+                      const std::vector<std::string_view>& iOwners,
+                      std::string& ioOwner) {
+  std::uint64_t sOwnerId{};
+  if (!ioReader.getVarU64(sOwnerId) || sOwnerId >= iOwners.size()) {
+    return false;
+  }
+  ioOwner.assign(iOwners[static_cast<std::size_t>(sOwnerId)]);
+  return true;
+}
+
+static void WriteHeader(const Header& iHeader, ByteWriter& ioWriter) {
+  ioWriter.putU32(iHeader.index);
+  ioWriter.putString(iHeader.previousHash);
+  ioWriter.putString(iHeader.merkleRootHash);
+  ioWriter.putI64(static_cast<std::int64_t>(iHeader.creationTime));
+  ioWriter.putU32(iHeader.nonce);
+  ioWriter.putString(iHeader.hash);
+}
+
+static bool ReadHeader(ByteReader& ioReader, Header& ioHeader) {
+  std::int64_t sCreationTime{};
+  if (!ioReader.getU32(ioHeader.index) ||
+      !ioReader.getString(ioHeader.previousHash) ||
+      !ioReader.getString(ioHeader.merkleRootHash) ||
+      !ioReader.getI64(sCreationTime) || !ioReader.getU32(ioHeader.nonce) ||
+      !ioReader.getString(ioHeader.hash)) {
+    return false;
+  }
+  ioHeader.creationTime = static_cast<std::time_t>(sCreationTime);
+  return true;
+}
+
+static bool DecodePreamble(ByteReader& ioReader, Header& ioHeader,
+                           std::uint8_t& ioVersion, std::uint8_t& ioFlags,
+                           std::string& ioError) {
+  if (!ioReader.getU8(ioVersion)) {
+    ioError = "Block record is empty.";
+    return false;
+  }
+  if (ioVersion != kFormatVersion && ioVersion != kLegacyFormatVersion) {
+    ioError = "Unsupported block record version: " + std::to_string(ioVersion);
+    return false;
+  }
+  if (!ReadHeader(ioReader, ioHeader) || !ioReader.getU8(ioFlags)) {
+    ioError = "Block record header is truncated.";
+    return false;
+  }
+  return true;
+}
+
+/**
+ * @brief Restore the transactions of a record written before blocks were
+ * compressed, with fixed-width values and inline owners.
+ */
+static std::expected<Block, std::string>
+DecodeLegacyTransactions(ByteReader& ioReader, Header&& ioHeader,
+                         const std::uint8_t iFlags) {
+  std::optional<std::vector<std::unique_ptr<Coinbase>>> sCoinbases{};
+  std::optional<std::vector<std::unique_ptr<Payload>>> sPayloads{};
+  std::uint32_t sCount{};
+  std::string sOwner{}, sReceiver{}, sHash{};
+  double sAmount{};
+  std::int64_t sTimestamp{};
+
+  if (iFlags & kHasCoinbases) {
+    if (!ioReader.getU32(sCount)) {
+      return std::unexpected{"Block record coinbases are truncated."};
+    }
+    sCoinbases.emplace().reserve(sCount);
+    for (std::uint32_t sIndex{}; sIndex < sCount; ++sIndex) {
+      if (!ioReader.getString(sOwner) || !ioReader.getF64(sAmount) ||
+          !ioReader.getI64(sTimestamp) || !ioReader.getString(sHash)) {
+        return std::unexpected{"Block record coinbases are truncated."};
+      }
+      sCoinbases.value().push_back(std::make_unique<Coinbase>(
+          std::move(sOwner), sAmount, FromNanoseconds(sTimestamp),
+          std::move(sHash)));
+    }
+  }
+  if (iFlags & kHasPayloads) {
+    if (!ioReader.getU32(sCount)) {
+      return std::unexpected{"Block record payloads are truncated."};
+    }
+    sPayloads.emplace().reserve(sCount);
+    for (std::uint32_t sIndex{}; sIndex < sCount; ++sIndex) {
+      if (!ioReader.getString(sOwner) || !ioReader.getString(sReceiver) ||
+          !ioReader.getF64(sAmount) || !ioReader.getI64(sTimestamp) ||
+          !ioReader.getString(sHash)) {
+        return std::unexpected{"Block record payloads are truncated."};
+      }
+      sPayloads.value().push_back(std::make_unique<Payload>(
+          std::move(sOwner), std::move(sReceiver), sAmount,
+          FromNanoseconds(sTimestamp), std::move(sHash)));
+    }
+  }
+  if (ioReader.remaining()) {
+    return std::unexpected{"Block record has trailing bytes."};
+  }
+  return Block{std::move(ioHeader), std::move(sCoinbases),
+               std::move(sPayloads)};
+}
+
+// Public API
+
+std::string Encode(const Block& iBlock) {
+  const auto& sCoinbases{iBlock.getCoinbases()};
+  const auto& sPayloads{iBlock.getPayloads()};
+  const Header sHeader{iBlock.getHeader()};
+
+  // Owners go first so that decoding remains a single forward pass.
+  OwnerDictionary sOwners{};
+  ByteWriter sTransactions{256};
+  if (sCoinbases.has_value()) {
+    sTransactions.putVarU64(sCoinbases.value().size());
+    for (const std::unique_ptr<Coinbase>& sCoinbase : sCoinbases.value()) {
+      sTransactions.putVarU64(sOwners.intern(sCoinbase->getOwner()));
+      WriteAmount(sCoinbase->getBitcoinAmount(), sTransactions);
+      WriteTimestamp(sCoinbase->getTimestamp(), sHeader.creationTime,
+                     sTransactions);
+      WriteShortString(sCoinbase->getHash(), sTransactions);
+    }
+  }
+  if (sPayloads.has_value()) {
+    sTransactions.putVarU64(sPayloads.value().size());
+    for (const std::unique_ptr<Payload>& sPayload : sPayloads.value()) {
+      sTransactions.putVarU64(sOwners.intern(sPayload->getOwner()));
+      sTransactions.putVarU64(sOwners.intern(sPayload->getReceiver()));
+      WriteAmount(sPayload->getBitcoinAmount(), sTransactions);
+      WriteTimestamp(sPayload->getTimestamp(), sHeader.creationTime,
+                     sTransactions);
+      WriteShortString(sPayload->getHash(), sTransactions);
+    }
+  }
+
+  ByteWriter sWriter{128 + sTransactions.size()};
+  sWriter.putU8(kFormatVersion);
+  WriteHeader(sHeader, sWriter);
+  sWriter.putU8((sCoinbases.has_value() ? kHasCoinbases : 0) |
+                (sPayloads.has_value() ? kHasPayloads : 0));
+  sOwners.write(sWriter);
+  sWriter.putBytes(sTransactions.buffer());
+  return sWriter.take();
+}
+
+std::string EncodeHeader(const Header& iHeader) {
+  ByteWriter sWriter{128};
+  sWriter.putU8(kFormatVersion);
+  WriteHeader(iHeader, sWriter);
+  sWriter.putU8(0);
+  sWriter.putVarU64(0);
+  return sWriter.take();
+}
+
+std::expected<Block, std::string> Decode(std::string_view iRecord) {
+  ByteReader sReader{iRecord};
+  Header sHeader{};
+  std::uint8_t sVersion{};
+  std::uint8_t sFlags{};
+  std::string sError{};
+  if (!DecodePreamble(sReader, sHeader, sVersion, sFlags, sError)) {
+    return std::unexpected{sError};
+  }
+  if (sVersion == kLegacyFormatVersion) {
+    return DecodeLegacyTransactions(sReader, std::move(sHeader), sFlags);
+  }
+
+  // Owner names are viewed in the record and only copied per transaction.
+  std::uint64_t sCount{};
+  std::vector<std::string_view> sOwners{};
+  if (!sReader.getVarU64(sCount) || sCount > sReader.remaining()) {
+    return std::unexpected{"Block record owners are truncated."};
+  }
+  sOwners.resize(static_cast<std::size_t>(sCount));
+  for (std::string_view& sOwner : sOwners) {
+    if (!ReadShortString(sReader, sOwner)) {
+      return std::unexpected{"Block record owners are truncated."};
+    }
+  }
+
+  std::optional<std::vector<std::unique_ptr<Coinbase>>> sCoinbases{};
+  std::optional<std::vector<std::unique_ptr<Payload>>> sPayloads{};
+  std::string sOwner{}, sReceiver{};
+  std::string_view sHash{};
+  double sAmount{};
+  std::int64_t sTimestamp{};
+
+  if (sFlags & kHasCoinbases) {
+    if (!sReader.getVarU64(sCount) || sCount > sReader.remaining()) {
+      return std::unexpected{"Block record coinbases are truncated."};
+    }
+    sCoinbases.emplace().reserve(static_cast<std::size_t>(sCount));
+    for (std::uint64_t sIndex{}; sIndex < sCount; ++sIndex) {
+      if (!ReadOwner(sReader, sOwners, sOwner) ||
+          !ReadAmount(sReader, sAmount) ||
+          !ReadTimestamp(sReader, sHeader.creationTime, sTimestamp) ||
+          !ReadShortString(sReader, sHash)) {
+        return std::unexpected{"Block record coinbases are truncated."};
+      }
+      sCoinbases.value().push_back(std::make_unique<Coinbase>(
+          std::move(sOwner), sAmount, FromNanoseconds(sTimestamp),
+          std::string{sHash}));
+    }
+  }
+  if (sFlags & kHasPayloads) {
+    if (!sReader.getVarU64(sCount) || sCount > sReader.remaining()) {
+      return std::unexpected{"Block record payloads are truncated."};
+    }
+    sPayloads.emplace().reserve(static_cast<std::size_t>(sCount));
+    for (std::uint64_t sIndex{}; sIndex < sCount; ++sIndex) {
+      if (!ReadOwner(sReader, sOwners, sOwner) ||
+          !ReadOwner(sReader, sOwners, sReceiver) ||
+          !ReadAmount(sReader, sAmount) ||
+          !ReadTimestamp(sReader, sHeader.creationTime, sTimestamp) ||
+          !ReadShortString(sReader, sHash)) {
+        return std::unexpected{"Block record payloads are truncated."};
+      }
+      sPayloads.value().push_back(std::make_unique<Payload>(
+          std::move(sOwner), std::move(sReceiver), sAmount,
+          FromNanoseconds(sTimestamp), std::string{sHash}));
+    }
+  }
+  if (sReader.remaining()) {
+    return std::unexpected{"Block record has trailing bytes."};
+  }
+
+  return Block{std::move(sHeader), std::move(sCoinbases),
+               std::move(sPayloads)};
+}
+
+std::expected<Header, std::string> DecodeHeader(std::string_view iRecord) {
+  ByteReader sReader{iRecord};
+  Header sHeader{};
+  std::uint8_t sVersion{};
+  std::uint8_t sFlags{};
+  std::string sError{};
+  if (!DecodePreamble(sReader, sHeader, sVersion, sFlags, sError)) {
+    return std::unexpected{sError};
+  }
+  return sHeader;
+}
+
+std::size_t EncodedSize(const Payload& iPayload, const std::string& iHash) {
+  // Three length-prefixed strings, the amount and the timestamp.
+  return 3 * sizeof(std::uint32_t) + iPayload.getOwner().size() +
+         iPayload.getReceiver().size() + iHash.size() + sizeof(double) +
+         sizeof(std::int64_t);
+}
+} // namespace codec
+} // namespace block
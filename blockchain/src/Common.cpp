@@ -1,34 +1,37 @@
 // author: georgiosmatzarapis
 
-#include <cstring>
 #include <memory>
 
 #include "Common.hpp"
 #include "Hmac.hpp"
 #include "Logger.hpp"
+#include "Metrics.hpp"
 #include "OpenSslApi.hpp"
 
 namespace utils {
 namespace core_lib {
 
+static const MetricsRegistry& sMetrics{MetricsRegistry::GetInstance()};
+static Counter& sHashCount{MetricsRegistry::GetInstance().counter(
+    "blockchain_hashes_total", "Hashes computed, including mining attempts.")};
+
 std::expected<std::string, std::string>
 ComputeHash(const std::string& iMessage) {
+  if (sMetrics.isEnabled()) {
+    sHashCount.add();
+  }
   auto sMessage{reinterpret_cast<const unsigned char*>(iMessage.c_str())};
   unsigned char* sDigest{};
   unsigned int sDigestSize{};
-  utils::HmacIt(sMessage, std::strlen(reinterpret_cast<const char*>(sMessage)),
-                &sDigest, &sDigestSize, std::make_unique<openssl::Api>());
+  // Messages embed binary hashes, which may contain null bytes.
+  utils::HmacIt(sMessage, iMessage.size(), &sDigest, &sDigestSize,
+                std::make_unique<openssl::Api>());
 
   if (sDigest) {
-    /**
-     * Commented out as it generates massive amount of logs while calculating a
-     * block's hash in Release mode.
-     * @todo (#TODO) Implement the correlation of the log level with the build
-     * variant.
-     */
-    // Log::GetInstance().toFile(LogLevel::DEBUG,
-    //                           "Hash calculated for message: " + iMessage,
-    //                           __PRETTY_FUNCTION__);
+    // Compiled out of release builds, where mining hashes continuously.
+    LOG_TO_FILE(LogLevel::DEBUG, "Hash calculated for message of " +
+                                     std::to_string(iMessage.size()) +
+                                     " bytes");
     const std::string sResult(reinterpret_cast<char*>(sDigest), sDigestSize);
     sDigest = nullptr;
     return sResult;
@@ -90,6 +93,15 @@ BlockHashCalculationFailure::BlockHashCalculationFailure(
 const char* BlockHashCalculationFailure::what() const noexcept {
   return std::runtime_error::what();
 }
+
+// StorageError
+
+StorageError::StorageError(const std::string& message)
+    : std::runtime_error{message} {}
+
+const char* StorageError::what() const noexcept {
+  return std::runtime_error::what();
+}
 } // namespace exception
 
 } // namespace core_lib
@@ -0,0 +1,46 @@
+// author: georgiosmatzarapis
+
+#include "ConflictIndex.hpp"
+#include "Mempool.hpp"
+
+namespace mempool {
+
+// Public API
+
+bool ConflictIndex::canSpend(const std::string& iOwner,
+                             const std::uint64_t iAmount,
+                             const std::uint64_t iConfirmedBalance) const {
+  const std::uint64_t aPendingSpend{getPendingSpend(iOwner)};
+  return aPendingSpend <= iConfirmedBalance &&
+         iAmount <= iConfirmedBalance - aPendingSpend;
+}
+
+void ConflictIndex::add(const Entry& iEntry) {
+  OwnerSpend& aOwner{_owners[iEntry.payload.getOwner()]};
+  aOwner.amount += iEntry.payload.getSatoshiAmount();
+  aOwner.entries.emplace_hint(aOwner.entries.end(), iEntry.sequence, &iEntry);
+}
+
+void ConflictIndex::remove(const Entry& iEntry) {
+  const auto aOwner{_owners.find(iEntry.payload.getOwner())};
+  if (aOwner == _owners.end() ||
+      !aOwner->second.entries.erase(iEntry.sequence)) {
+    return;
+  }
+  aOwner->second.amount -= iEntry.payload.getSatoshiAmount();
+  if (aOwner->second.entries.empty()) {
+    _owners.erase(aOwner);
+  }
+}
+
+std::uint64_t ConflictIndex::getPendingSpend(const std::string& iOwner) const {
+  const auto aOwner{_owners.find(iOwner)};
+  return aOwner == _owners.end() ? 0 : aOwner->second.amount;
+}
+
+const Entry* ConflictIndex::getNewest(const std::string& iOwner) const {
+  const auto aOwner{_owners.find(iOwner)};
+  return aOwner == _owners.end() ? nullptr
+                                 : aOwner->second.entries.rbegin()->second;
+}
+} // namespace mempool
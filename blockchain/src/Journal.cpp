@@ -0,0 +1,498 @@
+// author: georgiosmatzarapis
+
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "ByteStream.hpp"
+#include "Checksum.hpp"
+#include "Common.hpp"
+#include "Journal.hpp"
+#include "Logger.hpp"
+
+namespace user {
+
+using namespace utils;
+
+static const Log& sLog{Log::GetInstance()};
+
+static constexpr std::uint32_t kSnapshotMagic{0x31504E55}; // "UNP1"
+static constexpr std::uint8_t kPutRecord{1};
+static constexpr std::uint8_t kRemoveRecord{2};
+static constexpr std::size_t kFrameHeaderSize{8};
+static constexpr std::size_t kChecksumSize{sizeof(std::uint32_t)};
+static constexpr std::string_view kLogPrefix{"log-"};
+static constexpr std::string_view kLogExtension{".dat"};
+static constexpr std::string_view kSnapshotPrefix{"snapshot-"};
+static constexpr std::string_view kSnapshotExtension{".bin"};
+
+/* === Helpers === */
+
+static std::string ErrnoMessage(const std::string& iOperation) {
+  return iOperation + " failed: " + std::strerror(errno);
+}
+
+static bool WriteAll(const int iFileDescriptor, std::string_view iBytes) {
+  while (!iBytes.empty()) {
+    const ssize_t sWritten{
+        ::write(iFileDescriptor, iBytes.data(), iBytes.size())};
+    if (sWritten < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return false;
+    }
+    iBytes.remove_prefix(static_cast<std::size_t>(sWritten));
+  }
+  return true;
+}
+
+static bool SyncDirectory(const std::filesystem::path& iDirectory) {
+  const int sFileDescriptor{::open(iDirectory.c_str(), O_RDONLY | O_DIRECTORY)};
+  if (sFileDescriptor < 0) {
+    return false;
+  }
+  const bool sIsSynced{::fsync(sFileDescriptor) == 0};
+  ::close(sFileDescriptor);
+  return sIsSynced;
+}
+
+static std::optional<std::string> ReadFile(const std::filesystem::path& iPath) {
+  std::ifstream sFile{iPath, std::ios::binary};
+  if (!sFile) {
+    return std::nullopt;
+  }
+  return std::string{std::istreambuf_iterator<char>{sFile},
+                     std::istreambuf_iterator<char>{}};
+}
+
+/**
+ * @return Sequences of the files named <prefix><sequence><extension> in the
+ * directory, in ascending order.
+ */
+static std::vector<std::uint64_t>
+ListSequences(const std::filesystem::path& iDirectory,
+              std::string_view iPrefix, std::string_view iExtension) {
+  std::vector<std::uint64_t> sSequences{};
+  std::error_code sError{};
+  for (const auto& sEntry :
+       std::filesystem::directory_iterator{iDirectory, sError}) {
+    const std::string sFileName{sEntry.path().filename().string()};
+    if (sFileName.size() != iPrefix.size() + 10 + iExtension.size() ||
+        !sFileName.starts_with(iPrefix) || !sFileName.ends_with(iExtension)) {
+      continue;
+    }
+    std::uint64_t sSequence{};
+    const char* sDigits{sFileName.data() + iPrefix.size()};
+    if (std::from_chars(sDigits, sDigits + 10, sSequence).ec == std::errc{}) {
+      sSequences.push_back(sSequence);
+    }
+  }
+  std::sort(sSequences.begin(), sSequences.end());
+  return sSequences;
+}
+
+/* === Journal::Batch Class === */
+
+void Journal::Batch::put(const ProfileId iProfileId, const Profile& iProfile) {
+  ByteWriter aWriter{std::move(_bytes)};
+  aWriter.putU8(kPutRecord);
+  aWriter.putVarU64(iProfileId);
+  aWriter.putString(iProfile.getFullName());
+  aWriter.putU8(iProfile.getAge());
+  aWriter.putI64(iProfile.getSatoshiDeposit());
+  _bytes = aWriter.take();
+}
+
+void Journal::Batch::remove(const ProfileId iProfileId) {
+  ByteWriter aWriter{std::move(_bytes)};
+  aWriter.putU8(kRemoveRecord);
+  aWriter.putVarU64(iProfileId);
+  _bytes = aWriter.take();
+}
+
+bool Journal::Batch::empty() const { return _bytes.empty(); }
+
+void Journal::Batch::clear() { _bytes.clear(); }
+
+/* === Journal Class === */
+
+Journal::Journal(std::filesystem::path directory, JournalOptions options)
+    : _directory{std::move(directory)},
+      _options{options} {
+  std::error_code aError{};
+  std::filesystem::create_directories(_directory, aError);
+  if (aError) {
+    throw core_lib::exception::StorageError{"Cannot create " +
+                                            _directory.string() + ": " +
+                                            aError.message()};
+  }
+  if (_options.syncBatchSize > 1 && _options.syncInterval.count() > 0) {
+    _syncer = std::jthread{[this](const std::stop_token iStopToken) {
+      syncPeriodically(iStopToken);
+    }};
+  }
+}
+
+Journal::~Journal() {
+  if (_syncer.joinable()) {
+    _syncer.request_stop();
+    _syncer.join();
+  }
+  std::lock_guard aLock{_mutex};
+  if (_fileDescriptor >= 0) {
+    syncLocked();
+    ::close(_fileDescriptor);
+  }
+}
+
+// Public API
+
+std::expected<ProfileId, std::string> Journal::recover(
+    const std::function<void(ProfileId, std::optional<Profile>&&)>& iApply) {
+  std::lock_guard aLock{_mutex};
+  ProfileId aNextProfileId{};
+  std::uint64_t aFirstLog{};
+  std::string aSnapshotBytes{};
+  std::string_view aSnapshotProfiles{};
+  std::optional<std::uint64_t> aDamagedSnapshot{};
+
+  const std::vector<std::uint64_t> aSnapshots{
+      ListSequences(_directory, kSnapshotPrefix, kSnapshotExtension)};
+  for (auto aSnapshot{aSnapshots.rbegin()}; aSnapshot != aSnapshots.rend();
+       ++aSnapshot) {
+    std::optional<std::string> aBytes{ReadFile(snapshotPath(*aSnapshot))};
+    const std::size_t aBodySize{
+        aBytes && aBytes->size() >= kChecksumSize
+            ? aBytes->size() - kChecksumSize
+            : 0};
+    const std::string_view aBody{aBytes ? aBytes->data() : nullptr,
+                                 aBodySize};
+    std::uint32_t aChecksum{};
+    std::uint32_t aMagic{};
+    ProfileId aSnapshotNextProfileId{};
+    ByteReader aReader{aBody};
+    if (!aBytes || aBytes->size() < kChecksumSize ||
+        !ByteReader{std::string_view{*aBytes}.substr(aBodySize)}.getU32(
+            aChecksum) ||
+        Crc32c(aBody.data(), aBody.size()) != aChecksum ||
+        !aReader.getU32(aMagic) || aMagic != kSnapshotMagic ||
+        !aReader.getU64(aSnapshotNextProfileId)) {
+      if (!aDamagedSnapshot) {
+        aDamagedSnapshot = *aSnapshot;
+      }
+      sLog.toFile(LogLevel::WARNING,
+                  "Snapshot " + std::to_string(*aSnapshot) + " is damaged.",
+                  __PRETTY_FUNCTION__);
+      continue;
+    }
+    const std::size_t aProfilesOffset{aBodySize - aReader.remaining()};
+    aSnapshotBytes = std::move(*aBytes);
+    aSnapshotProfiles = std::string_view{aSnapshotBytes}.substr(
+        aProfilesOffset, aBodySize - aProfilesOffset);
+    aNextProfileId = aSnapshotNextProfileId;
+    aFirstLog = *aSnapshot;
+    break;
+  }
+
+  // Writing a snapshot deletes what precedes it, so falling back to an older
+  // state is only sound while every log following that state is still there.
+  if (aDamagedSnapshot) {
+    for (std::uint64_t aLog{aFirstLog}; aLog < *aDamagedSnapshot; ++aLog) {
+      if (!std::filesystem::exists(logPath(aLog))) {
+        return std::unexpected{"Snapshot " + std::to_string(*aDamagedSnapshot) +
+                               " is damaged and log " + std::to_string(aLog) +
+                               " needed to recover without it is missing."};
+      }
+    }
+    sLog.toFile(LogLevel::WARNING,
+                "Recovering from the logs preceding damaged snapshot " +
+                    std::to_string(*aDamagedSnapshot) + ".",
+                __PRETTY_FUNCTION__);
+  }
+  if (!ReplayBatch(aSnapshotProfiles, aNextProfileId, iApply)) {
+    return std::unexpected{"Snapshot " + std::to_string(aFirstLog) +
+                           " cannot be decoded."};
+  }
+
+  const std::vector<std::uint64_t> aLogs{
+      ListSequences(_directory, kLogPrefix, kLogExtension)};
+  for (const std::uint64_t aLog : aLogs) {
+    if (aLog < aFirstLog) {
+      continue;
+    }
+    const std::optional<std::string> aBytes{ReadFile(logPath(aLog))};
+    if (!aBytes) {
+      return std::unexpected{ErrnoMessage("read " + logPath(aLog).string())};
+    }
+    std::size_t aOffset{};
+    while (aOffset < aBytes->size()) {
+      ByteReader aReader{std::string_view{*aBytes}.substr(aOffset)};
+      std::uint32_t aLength{};
+      std::uint32_t aChecksum{};
+      std::string_view aBody{};
+      if (!aReader.getU32(aLength) || !aReader.getU32(aChecksum) ||
+          !aReader.getBytes(aLength, aBody) ||
+          Crc32c(aBody.data(), aBody.size()) != aChecksum ||
+          !ReplayBatch(aBody, aNextProfileId, iApply)) {
+        break;
+      }
+      aOffset += kFrameHeaderSize + aLength;
+    }
+    if (aOffset == aBytes->size()) {
+      continue;
+    }
+    // Only the tail of the newest log may be torn by a crash; anything else
+    // means that acknowledged changes were lost.
+    if (aLog != aLogs.back()) {
+      return std::unexpected{"Log " + std::to_string(aLog) +
+                             " is damaged at offset " +
+                             std::to_string(aOffset) + "."};
+    }
+    std::error_code aError{};
+    std::filesystem::resize_file(logPath(aLog), aOffset, aError);
+    if (aError) {
+      return std::unexpected{"Cannot truncate log " + std::to_string(aLog) +
+                             ": " + aError.message()};
+    }
+    sLog.toFile(LogLevel::WARNING,
+                "Truncated torn tail of log " + std::to_string(aLog) +
+                    " at offset " + std::to_string(aOffset) + ".",
+                __PRETTY_FUNCTION__);
+  }
+
+  const std::uint64_t aSequence{
+      std::max(aFirstLog, aLogs.empty() ? 0 : aLogs.back() + 1)};
+  if (const auto aOpened{openLog(aSequence)}; !aOpened) {
+    return std::unexpected{aOpened.error()};
+  }
+  return aNextProfileId;
+}
+
+std::expected<void, std::string> Journal::append(const Batch& iBatch) {
+  ByteWriter aFrame{kFrameHeaderSize + iBatch._bytes.size()};
+  aFrame.putU32(static_cast<std::uint32_t>(iBatch._bytes.size()));
+  aFrame.putU32(Crc32c(iBatch._bytes.data(), iBatch._bytes.size()));
+  aFrame.putBytes(iBatch._bytes);
+
+  std::lock_guard aLock{_mutex};
+  if (_fileDescriptor < 0) {
+    return std::unexpected{std::string{"Journal is not recovered."}};
+  }
+  if (_isFailed) {
+    return std::unexpected{std::string{"Journal failed on an earlier write."}};
+  }
+  const off_t aSize{::lseek(_fileDescriptor, 0, SEEK_END)};
+  if (aSize < 0) {
+    return std::unexpected{ErrnoMessage("lseek")};
+  }
+  if (!WriteAll(_fileDescriptor, aFrame.buffer())) {
+    const std::string aErrorMessage{ErrnoMessage("write")};
+    truncateLocked(aSize);
+    return std::unexpected{aErrorMessage};
+  }
+  ++_unsyncedRecords;
+  if (_unsyncedRecords >= _options.syncBatchSize && !syncLocked()) {
+    // The kernel may have dropped any of the unsynced records, so the log can
+    // no longer be trusted to hold what was acknowledged.
+    const std::string aErrorMessage{ErrnoMessage("fdatasync")};
+    truncateLocked(aSize);
+    _isFailed = true;
+    return std::unexpected{aErrorMessage};
+  }
+  ++_recordsSinceSnapshot;
+  return {};
+}
+
+bool Journal::sync() {
+  std::lock_guard aLock{_mutex};
+  return syncLocked();
+}
+
+bool Journal::isSnapshotDue() const {
+  std::lock_guard aLock{_mutex};
+  return _options.snapshotInterval &&
+         _recordsSinceSnapshot >= _options.snapshotInterval;
+}
+
+std::expected<std::uint64_t, std::string> Journal::rotate() {
+  std::lock_guard aLock{_mutex};
+  if (const auto aOpened{openLog(_sequence + 1)}; !aOpened) {
+    return std::unexpected{aOpened.error()};
+  }
+  _recordsSinceSnapshot = 0;
+  return _sequence;
+}
+
+std::expected<void, std::string>
+Journal::writeSnapshot(const std::uint64_t iSequence,
+                       const ProfileId iNextProfileId, const Batch& iProfiles) {
+  ByteWriter aWriter{16 + iProfiles._bytes.size()};
+  aWriter.putU32(kSnapshotMagic);
+  aWriter.putU64(iNextProfileId);
+  aWriter.putBytes(iProfiles._bytes);
+  aWriter.putU32(Crc32c(aWriter.buffer().data(), aWriter.size()));
+
+  std::lock_guard aLock{_snapshotMutex};
+  const std::filesystem::path aPath{snapshotPath(iSequence)};
+  std::filesystem::path aTemporaryPath{aPath};
+  aTemporaryPath += ".tmp";
+  const int aFileDescriptor{
+      ::open(aTemporaryPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644)};
+  if (aFileDescriptor < 0) {
+    return std::unexpected{ErrnoMessage("open " + aTemporaryPath.string())};
+  }
+  const bool aIsWritten{WriteAll(aFileDescriptor, aWriter.buffer()) &&
+                        ::fsync(aFileDescriptor) == 0};
+  if (::close(aFileDescriptor) != 0 || !aIsWritten) {
+    const std::string aErrorMessage{ErrnoMessage("Snapshot write")};
+    std::filesystem::remove(aTemporaryPath);
+    return std::unexpected{aErrorMessage};
+  }
+  std::error_code aError{};
+  std::filesystem::rename(aTemporaryPath, aPath, aError);
+  if (aError || !SyncDirectory(_directory)) {
+    return std::unexpected{"Cannot publish snapshot " +
+                           std::to_string(iSequence) + "."};
+  }
+
+  removeBefore(iSequence);
+  sLog.toFile(LogLevel::INFO,
+              "Snapshot " + std::to_string(iSequence) + " written.",
+              __PRETTY_FUNCTION__);
+  return {};
+}
+
+// Private API
+
+bool Journal::ReplayBatch(
+    std::string_view iBytes, ProfileId& ioNextProfileId,
+    const std::function<void(ProfileId, std::optional<Profile>&&)>& iApply) {
+  std::vector<std::pair<ProfileId, std::optional<Profile>>> sChanges{};
+  ByteReader sReader{iBytes};
+  while (sReader.remaining()) {
+    std::uint8_t sKind{};
+    ProfileId sProfileId{};
+    if (!sReader.getU8(sKind) || !sReader.getVarU64(sProfileId)) {
+      return false;
+    }
+    if (sKind == kRemoveRecord) {
+      sChanges.emplace_back(sProfileId, std::nullopt);
+      continue;
+    }
+    std::string sFullName{};
+    std::uint8_t sAge{};
+    std::int64_t sDeposit{};
+    if (sKind != kPutRecord || !sReader.getString(sFullName) ||
+        !sReader.getU8(sAge) || !sReader.getI64(sDeposit)) {
+      return false;
+    }
+    Profile sProfile{std::move(sFullName), sAge, 0};
+    sProfile._deposit = sDeposit;
+    sChanges.emplace_back(sProfileId, std::move(sProfile));
+  }
+
+  for (auto& [sProfileId, sProfile] : sChanges) {
+    ioNextProfileId = std::max(ioNextProfileId, sProfileId + 1);
+    iApply(sProfileId, std::move(sProfile));
+  }
+  return true;
+}
+
+std::filesystem::path Journal::logPath(const std::uint64_t iSequence) const {
+  char aFileName[32]{};
+  std::snprintf(aFileName, sizeof(aFileName), "log-%010" PRIu64 ".dat",
+                iSequence);
+  return _directory / aFileName;
+}
+
+std::filesystem::path
+Journal::snapshotPath(const std::uint64_t iSequence) const {
+  char aFileName[32]{};
+  std::snprintf(aFileName, sizeof(aFileName), "snapshot-%010" PRIu64 ".bin",
+                iSequence);
+  return _directory / aFileName;
+}
+
+std::expected<void, std::string>
+Journal::openLog(const std::uint64_t iSequence) {
+  const std::filesystem::path aPath{logPath(iSequence)};
+  const int aFileDescriptor{
+      ::open(aPath.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644)};
+  if (aFileDescriptor < 0) {
+    return std::unexpected{ErrnoMessage("open " + aPath.string())};
+  }
+  if (_fileDescriptor >= 0) {
+    // The previous log must be complete before a snapshot can rely on it.
+    if (!syncLocked()) {
+      ::close(aFileDescriptor);
+      return std::unexpected{ErrnoMessage("fdatasync")};
+    }
+    ::close(_fileDescriptor);
+  }
+  _fileDescriptor = aFileDescriptor;
+  _sequence = iSequence;
+  SyncDirectory(_directory);
+  return {};
+}
+
+bool Journal::syncLocked() {
+  if (_fileDescriptor < 0 || !_unsyncedRecords) {
+    return true;
+  }
+  if (::fdatasync(_fileDescriptor) != 0) {
+    return false;
+  }
+  _unsyncedRecords = 0;
+  return true;
+}
+
+void Journal::truncateLocked(const std::int64_t iSize) {
+  if (::ftruncate(_fileDescriptor, static_cast<off_t>(iSize)) != 0) {
+    sLog.toFile(LogLevel::ERROR,
+                ErrnoMessage("ftruncate") + ", refusing further appends.",
+                __PRETTY_FUNCTION__);
+    _isFailed = true;
+  }
+}
+
+void Journal::syncPeriodically(const std::stop_token iStopToken) {
+  std::unique_lock aLock{_mutex};
+  while (!iStopToken.stop_requested()) {
+    // Only woken early by a stop request.
+    _syncCondition.wait_for(aLock, iStopToken, _options.syncInterval,
+                            [] { return false; });
+    if (!_isFailed && !syncLocked()) {
+      sLog.toFile(LogLevel::ERROR,
+                  ErrnoMessage("fdatasync") + ", refusing further appends.",
+                  __PRETTY_FUNCTION__);
+      _isFailed = true;
+    }
+  }
+}
+
+void Journal::removeBefore(const std::uint64_t iSequence) {
+  std::error_code aError{};
+  for (const std::uint64_t aLog :
+       ListSequences(_directory, kLogPrefix, kLogExtension)) {
+    if (aLog < iSequence) {
+      std::filesystem::remove(logPath(aLog), aError);
+    }
+  }
+  for (const std::uint64_t aSnapshot :
+       ListSequences(_directory, kSnapshotPrefix, kSnapshotExtension)) {
+    if (aSnapshot < iSequence) {
+      std::filesystem::remove(snapshotPath(aSnapshot), aError);
+    }
+  }
+}
+} // namespace user
@@ -0,0 +1,180 @@
+// author: georgiosmatzarapis
+
+#include <algorithm>
+#include <limits>
+
+#include "Ledger.hpp"
+
+namespace ledger {
+
+Ledger::Ledger() = default;
+
+// Public API
+
+std::expected<void, std::string> Ledger::connect(const block::Block& iBlock) {
+  _journal.clear();
+
+  if (const auto& aCoinbases{iBlock.getCoinbases()}; aCoinbases.has_value()) {
+    for (const std::unique_ptr<transaction::Coinbase>& aCoinbase :
+         aCoinbases.value()) {
+      if (!credit(intern(aCoinbase->getOwner()),
+                  aCoinbase->getSatoshiAmount())) {
+        rollback();
+        return std::unexpected{"Balance overflow for owner '" +
+                               aCoinbase->getOwner() + "'."};
+      }
+    }
+  }
+  if (const auto& aPayloads{iBlock.getPayloads()}; aPayloads.has_value()) {
+    for (const std::unique_ptr<transaction::Payload>& aPayload :
+         aPayloads.value()) {
+      if (!debit(intern(aPayload->getOwner()), aPayload->getSatoshiAmount())) {
+        rollback();
+        return std::unexpected{"Insufficient balance for owner '" +
+                               aPayload->getOwner() + "'."};
+      }
+      if (!credit(intern(aPayload->getReceiver()),
+                  aPayload->getSatoshiAmount())) {
+        rollback();
+        return std::unexpected{"Balance overflow for owner '" +
+                               aPayload->getReceiver() + "'."};
+      }
+    }
+  }
+  return {};
+}
+
+std::expected<void, std::string> Ledger::connect(const block::Block& iBlock,
+                                                UndoRecord& ioUndo) {
+  if (const std::expected<void, std::string> aConnected{connect(iBlock)};
+      !aConnected) {
+    return aConnected;
+  }
+  // Fold the journal into one net change per owner.
+  std::sort(_journal.begin(), _journal.end(),
+            [](const auto& iLeft, const auto& iRight) {
+              return iLeft.first < iRight.first;
+            });
+  ioUndo.changes.clear();
+  for (const auto& [aOwnerId, aChange] : _journal) {
+    if (!ioUndo.changes.empty() && ioUndo.changes.back().first == aOwnerId) {
+      ioUndo.changes.back().second += aChange;
+    } else {
+      ioUndo.changes.emplace_back(aOwnerId, aChange);
+    }
+  }
+  std::erase_if(ioUndo.changes,
+                [](const auto& iChange) { return iChange.second == 0; });
+  _journal.clear();
+  return {};
+}
+
+std::expected<void, std::string>
+Ledger::disconnect(const block::Block& iBlock) {
+  _journal.clear();
+
+  if (const auto& aPayloads{iBlock.getPayloads()}; aPayloads.has_value()) {
+    for (auto aPayload{aPayloads.value().rbegin()};
+         aPayload != aPayloads.value().rend(); ++aPayload) {
+      if (!debit(intern((*aPayload)->getReceiver()),
+                 (*aPayload)->getSatoshiAmount()) ||
+          !credit(intern((*aPayload)->getOwner()),
+                  (*aPayload)->getSatoshiAmount())) {
+        rollback();
+        return std::unexpected{
+            std::string{"Block payloads were not connected."}};
+      }
+    }
+  }
+  if (const auto& aCoinbases{iBlock.getCoinbases()}; aCoinbases.has_value()) {
+    for (auto aCoinbase{aCoinbases.value().rbegin()};
+         aCoinbase != aCoinbases.value().rend(); ++aCoinbase) {
+      if (!debit(intern((*aCoinbase)->getOwner()),
+                 (*aCoinbase)->getSatoshiAmount())) {
+        rollback();
+        return std::unexpected{
+            std::string{"Block coinbases were not connected."}};
+      }
+    }
+  }
+  return {};
+}
+
+std::expected<void, std::string> Ledger::undo(const UndoRecord& iUndo) {
+  // Owners are unique within a record, so every change can be checked first.
+  for (const auto& [aOwnerId, aChange] : iUndo.changes) {
+    const std::uint64_t aAmount{aChange > 0
+                                    ? static_cast<std::uint64_t>(aChange)
+                                    : static_cast<std::uint64_t>(-aChange)};
+    if (aOwnerId >= _balances.size() ||
+        (aChange > 0 && _balances[aOwnerId] < aAmount) ||
+        (aChange < 0 && _balances[aOwnerId] >
+                            std::numeric_limits<std::uint64_t>::max() -
+                                aAmount)) {
+      return std::unexpected{
+          std::string{"Undo record does not match the ledger."}};
+    }
+  }
+  for (const auto& [aOwnerId, aChange] : iUndo.changes) {
+    _balances[aOwnerId] -= static_cast<std::uint64_t>(aChange);
+  }
+  return {};
+}
+
+void Ledger::restore(std::string_view iOwner, const std::uint64_t iBalance) {
+  _balances[intern(iOwner)] = iBalance;
+}
+
+void Ledger::reserve(const std::size_t iOwners) {
+  _owners.reserve(iOwners);
+  _balances.reserve(iOwners);
+}
+
+std::uint64_t Ledger::getBalance(std::string_view iOwner) const {
+  const std::optional<OwnerId> aOwnerId{_owners.find(iOwner)};
+  return aOwnerId.has_value() ? _balances[aOwnerId.value()] : 0;
+}
+
+std::uint64_t Ledger::getBalance(const OwnerId iOwnerId) const {
+  return iOwnerId < _balances.size() ? _balances[iOwnerId] : 0;
+}
+
+const OwnerTable& Ledger::getOwners() const { return _owners; }
+
+// Private API
+
+OwnerId Ledger::intern(std::string_view iOwner) {
+  const OwnerId aOwnerId{_owners.intern(iOwner)};
+  if (aOwnerId >= _balances.size()) {
+    _balances.resize(aOwnerId + 1);
+  }
+  return aOwnerId;
+}
+
+bool Ledger::credit(const OwnerId iOwnerId, const std::uint64_t iAmount) {
+  if (_balances[iOwnerId] >
+      std::numeric_limits<std::uint64_t>::max() - iAmount) {
+    return false;
+  }
+  _balances[iOwnerId] += iAmount;
+  _journal.emplace_back(iOwnerId, static_cast<std::int64_t>(iAmount));
+  return true;
+}
+
+bool Ledger::debit(const OwnerId iOwnerId, const std::uint64_t iAmount) {
+  if (_balances[iOwnerId] < iAmount) {
+    return false;
+  }
+  _balances[iOwnerId] -= iAmount;
+  _journal.emplace_back(iOwnerId, -static_cast<std::int64_t>(iAmount));
+  return true;
+}
+
+void Ledger::rollback() {
+  for (auto aChange{_journal.rbegin()}; aChange != _journal.rend();
+       ++aChange) {
+    _balances[aChange->first] -= static_cast<std::uint64_t>(aChange->second);
+  }
+  _journal.clear();
+}
+} // namespace ledger
@@ -0,0 +1,234 @@
+// author: georgiosmatzarapis
+
+#include <algorithm>
+#include <iterator>
+
+#include "Codec.hpp"
+#include "Common.hpp"
+#include "Logger.hpp"
+#include "Mempool.hpp"
+
+namespace mempool {
+
+using namespace utils;
+
+static const Log& sLog{Log::GetInstance()};
+
+/* === Helpers === */
+
+/**
+ * @brief Compare fee rates without dividing, i.e. iLeftFee / iLeftSize >
+ * iRightFee / iRightSize.
+ */
+static bool HasHigherFeeRate(const std::uint64_t iLeftFee,
+                             const std::uint32_t iLeftSize,
+                             const std::uint64_t iRightFee,
+                             const std::uint32_t iRightSize) {
+  return static_cast<unsigned __int128>(iLeftFee) * iRightSize >
+         static_cast<unsigned __int128>(iRightFee) * iLeftSize;
+}
+
+/* === Mempool Class === */
+
+Mempool::Mempool(MempoolOptions options)
+    : _options{options},
+      _filter{options.expectedPayloads, options.falsePositiveRate},
+      _filterCapacity{options.expectedPayloads} {}
+
+Mempool::Mempool(const ledger::Ledger& ledger, MempoolOptions options)
+    : _options{options}, _ledger{&ledger},
+      _filter{options.expectedPayloads, options.falsePositiveRate},
+      _filterCapacity{options.expectedPayloads} {}
+
+// Public API
+
+void Mempool::submit(transaction::Payload iPayload, const std::uint64_t iFee) {
+  _queue.push(Submission{std::move(iPayload), iFee});
+}
+
+std::size_t Mempool::process() {
+  std::size_t aAdmitted{};
+  while (std::optional<Submission> aSubmission{_queue.pop()}) {
+    aAdmitted += admit(std::move(aSubmission.value())) ? 1 : 0;
+  }
+  return aAdmitted;
+}
+
+void Mempool::removeForBlock(const block::Block& iBlock) {
+  if (!iBlock.getPayloads().has_value()) {
+    return;
+  }
+  for (const std::unique_ptr<transaction::Payload>& aPayload :
+       iBlock.getPayloads().value()) {
+    remove(aPayload->getHash());
+  }
+  if (!_ledger) {
+    return;
+  }
+  // The block may spend from owners through payloads the pool never saw.
+  for (const std::unique_ptr<transaction::Payload>& aPayload :
+       iBlock.getPayloads().value()) {
+    const std::string& aOwner{aPayload->getOwner()};
+    const std::uint64_t aBalance{_ledger->getBalance(aOwner)};
+    while (_conflicts.getPendingSpend(aOwner) > aBalance) {
+      erase(_entries.find(_conflicts.getNewest(aOwner)->hash));
+    }
+  }
+}
+
+bool Mempool::remove(const std::string& iHash) {
+  const auto aEntry{_entries.find(iHash)};
+  if (aEntry == _entries.end()) {
+    return false;
+  }
+  erase(aEntry);
+  return true;
+}
+
+void Mempool::onBlockConnected(const block::Block& iBlock) {
+  removeForBlock(iBlock);
+}
+
+void Mempool::onBlockDisconnected(const block::Block& iBlock) {
+  if (!iBlock.getPayloads().has_value()) {
+    return;
+  }
+  for (const std::unique_ptr<transaction::Payload>& aPayload :
+       iBlock.getPayloads().value()) {
+    admit(Submission{*aPayload, 0});
+  }
+}
+
+bool Mempool::contains(const std::string& iHash) const {
+  return isPooled(iHash);
+}
+
+const Entry* Mempool::find(const std::string& iHash) const {
+  if (!_filter.mayContain(BloomFilter::DigestKey(iHash))) {
+    return nullptr;
+  }
+  const auto aEntry{_entries.find(iHash)};
+  return aEntry == _entries.end() ? nullptr : &aEntry->second;
+}
+
+std::size_t Mempool::size() const { return _entries.size(); }
+
+std::uint64_t Mempool::getPendingSpend(const std::string& iOwner) const {
+  return _conflicts.getPendingSpend(iOwner);
+}
+
+std::size_t Mempool::getBytes() const { return _bytes; }
+
+void Mempool::forEachByFeeRate(
+    const std::function<bool(const Entry&)>& iVisitor) const {
+  for (const Entry* aEntry : _byFeeRate) {
+    if (!iVisitor(*aEntry)) {
+      return;
+    }
+  }
+}
+
+// Private API
+
+bool Mempool::ByFeeRate::operator()(const Entry* iLeft,
+                                    const Entry* iRight) const {
+  if (HasHigherFeeRate(iLeft->fee, iLeft->size, iRight->fee, iRight->size)) {
+    return true;
+  }
+  if (HasHigherFeeRate(iRight->fee, iRight->size, iLeft->fee, iLeft->size)) {
+    return false;
+  }
+  return iLeft->sequence < iRight->sequence;
+}
+
+bool Mempool::admit(Submission&& ioSubmission) {
+  transaction::Payload& aPayload{ioSubmission.payload};
+
+  // A carried hash identifies duplicates before paying for its verification;
+  // otherwise the hash is computed once and kept with the payload.
+  if (aPayload.hasHash()) {
+    const std::string aHash{aPayload.getHash()};
+    if (isPooled(aHash)) {
+      return false;
+    }
+    const std::expected<bool, std::string> aIsHashValid{
+        core_lib::IsHashValid(aPayload.getHashMessage(), aHash)};
+    if (!aIsHashValid || !aIsHashValid.value()) {
+      sLog.toFile(LogLevel::WARNING,
+                  "Hash inconsistency detected, payload dropped.",
+                  __PRETTY_FUNCTION__);
+      return false;
+    }
+  }
+  std::string aHash{};
+  try {
+    aHash = aPayload.getHash();
+  } catch (const core_lib::exception::HashCalculationError& iError) {
+    sLog.toFile(LogLevel::ERROR, iError.what(), __PRETTY_FUNCTION__);
+    return false;
+  }
+  if (isPooled(aHash)) {
+    return false;
+  }
+  if (_ledger &&
+      !_conflicts.canSpend(aPayload.getOwner(), aPayload.getSatoshiAmount(),
+                           _ledger->getBalance(aPayload.getOwner()))) {
+    return false;
+  }
+
+  const auto aSize{
+      static_cast<std::uint32_t>(block::codec::EncodedSize(aPayload, aHash))};
+  if (_bytes + aSize > _options.maxBytes && !_byFeeRate.empty()) {
+    const Entry* aLowest{*std::prev(_byFeeRate.end())};
+    if (!HasHigherFeeRate(ioSubmission.fee, aSize, aLowest->fee,
+                          aLowest->size)) {
+      return false;
+    }
+  }
+
+  const auto aEntry{_entries
+                        .try_emplace(aHash, Entry{std::move(aPayload), aHash,
+                                                  ioSubmission.fee, aSize,
+                                                  _nextSequence++})
+                        .first};
+  addToFilter(aHash);
+  _byFeeRate.insert(&aEntry->second);
+  _conflicts.add(aEntry->second);
+  _bytes += aSize;
+  evict();
+  return _entries.contains(aHash);
+}
+
+void Mempool::erase(std::unordered_map<std::string, Entry>::iterator iEntry) {
+  _byFeeRate.erase(&iEntry->second);
+  _conflicts.remove(iEntry->second);
+  _bytes -= iEntry->second.size;
+  _entries.erase(iEntry);
+}
+
+void Mempool::evict() {
+  while (_bytes > _options.maxBytes && !_byFeeRate.empty()) {
+    erase(_entries.find((*std::prev(_byFeeRate.end()))->hash));
+  }
+}
+
+bool Mempool::isPooled(const std::string& iHash) const {
+  return _filter.mayContain(BloomFilter::DigestKey(iHash)) &&
+         _entries.contains(iHash);
+}
+
+void Mempool::addToFilter(const std::string& iHash) {
+  if (_filterItems >= _filterCapacity) {
+    // Dropped payloads are removed from the filter on the way.
+    _filterCapacity = std::max(_filterCapacity, 2 * _entries.size());
+    _filter = BloomFilter{_filterCapacity, _options.falsePositiveRate};
+    _filterItems = _entries.size();
+    for (const auto& [aHash, aEntry] : _entries) {
+      _filter.add(BloomFilter::DigestKey(aHash));
+    }
+    return;
+  }
+  _filter.add(BloomFilter::DigestKey(iHash));
+  ++_filterItems;
+}
+} // namespace mempool
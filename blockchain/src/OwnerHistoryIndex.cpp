@@ -0,0 +1,171 @@
+// author: georgiosmatzarapis
+
+#include <algorithm>
+
+#include "ByteStream.hpp"
+#include "OwnerHistoryIndex.hpp"
+
+namespace chain {
+
+using namespace utils;
+
+/* === Helpers === */
+
+/**
+ * @brief Visit the owners of the transactions of a block with the position of
+ * each transaction in the block.
+ */
+template <typename Visitor>
+static void ForEachOwner(const block::Block& iBlock, const Visitor& iVisitor) {
+  std::uint32_t sPosition{};
+  if (const auto& sCoinbases{iBlock.getCoinbases()}; sCoinbases.has_value()) {
+    for (const auto& sCoinbase : sCoinbases.value()) {
+      iVisitor(sCoinbase->getOwner(), sPosition++);
+    }
+  }
+  if (const auto& sPayloads{iBlock.getPayloads()}; sPayloads.has_value()) {
+    for (const auto& sPayload : sPayloads.value()) {
+      iVisitor(sPayload->getOwner(), sPosition);
+      iVisitor(sPayload->getReceiver(), sPosition++);
+    }
+  }
+}
+
+/* === OwnerHistoryIndex Class === */
+
+// Public API
+
+std::expected<void, std::string>
+OwnerHistoryIndex::build(const Chain& iChain) {
+  const std::uint32_t aLength{iChain.getLength()};
+  for (std::uint32_t aHeight{iChain.getFirstBlockHeight()}; aHeight < aLength;
+       ++aHeight) {
+    const std::expected<block::Block, std::string> aBlock{
+        iChain.getBlock(aHeight)};
+    if (!aBlock) {
+      return std::unexpected{aBlock.error()};
+    }
+    onBlockConnected(aBlock.value());
+  }
+  return {};
+}
+
+void OwnerHistoryIndex::onBlockConnected(const block::Block& iBlock) {
+  ForEachOwner(iBlock, [this, &iBlock](const std::string& iOwner,
+                                       const std::uint32_t iPosition) {
+    add(iOwner, Posting{iBlock.getIndex(), iPosition});
+  });
+}
+
+void OwnerHistoryIndex::onBlockDisconnected(const block::Block& iBlock) {
+  ForEachOwner(iBlock, [this, &iBlock](const std::string& iOwner,
+                                       [[maybe_unused]] const std::uint32_t
+                                           iPosition) {
+    if (const std::optional<ledger::OwnerId> aOwnerId{_owners.find(iOwner)}) {
+      truncate(_lists[aOwnerId.value()], iBlock.getIndex());
+    }
+  });
+}
+
+HistoryPage OwnerHistoryIndex::getHistory(std::string_view iOwner,
+                                          const std::size_t iStart,
+                                          const std::size_t iLimit) const {
+  HistoryPage aPage{};
+  const std::optional<ledger::OwnerId> aOwnerId{_owners.find(iOwner)};
+  if (!aOwnerId || iStart >= _lists[aOwnerId.value()].count) {
+    return aPage;
+  }
+  const PostingList& aList{_lists[aOwnerId.value()]};
+  Cursor aCursor{aList.skips[iStart / kSkipInterval]};
+  while (aCursor.index < iStart) {
+    next(aList, aCursor);
+  }
+  aPage.postings.reserve(std::min(iLimit, aList.count - iStart));
+  while (aCursor.index < aList.count && aPage.postings.size() < iLimit) {
+    aPage.postings.push_back(next(aList, aCursor));
+  }
+  if (aCursor.index < aList.count) {
+    aPage.next = aCursor.index;
+  }
+  return aPage;
+}
+
+std::size_t OwnerHistoryIndex::getCount(std::string_view iOwner) const {
+  const std::optional<ledger::OwnerId> aOwnerId{_owners.find(iOwner)};
+  return aOwnerId ? _lists[aOwnerId.value()].count : 0;
+}
+
+std::size_t OwnerHistoryIndex::getBytes() const { return _bytes; }
+
+// Private API
+
+void OwnerHistoryIndex::add(std::string_view iOwner, const Posting& iPosting) {
+  const ledger::OwnerId aOwnerId{_owners.intern(iOwner)};
+  if (aOwnerId >= _lists.size()) {
+    _lists.resize(aOwnerId + 1);
+  }
+  PostingList& aList{_lists[aOwnerId]};
+  // A payload to oneself is a single transaction of its owner.
+  if (aList.count && aList.last == iPosting) {
+    return;
+  }
+  if (aList.count % kSkipInterval == 0) {
+    aList.skips.push_back(Cursor{aList.bytes.size(), aList.count, aList.last});
+  }
+
+  const std::uint32_t aHeightDelta{iPosting.height - aList.last.height};
+  const std::size_t aBytesBefore{aList.bytes.size()};
+  ByteWriter aWriter{std::move(aList.bytes)};
+  aWriter.putVarU64(aHeightDelta);
+  aWriter.putVarU64(aHeightDelta || !aList.count
+                        ? iPosting.position
+                        : iPosting.position - aList.last.position - 1);
+  aList.bytes = aWriter.take();
+  _bytes += aList.bytes.size() - aBytesBefore;
+  aList.last = iPosting;
+  ++aList.count;
+}
+
+void OwnerHistoryIndex::truncate(PostingList& ioList,
+                                 const std::uint32_t iHeight) {
+  if (!ioList.count || ioList.last.height < iHeight) {
+    return;
+  }
+  // Resume from the last skip entry preceding the first posting to drop.
+  const auto aSkip{std::partition_point(
+      ioList.skips.begin() + 1, ioList.skips.end(),
+      [iHeight](const Cursor& iCursor) {
+        return iCursor.previous.height < iHeight;
+      })};
+  Cursor aCursor{*std::prev(aSkip)};
+  for (Cursor aNext{aCursor};
+       aNext.index < ioList.count && next(ioList, aNext).height < iHeight;) {
+    aCursor = aNext;
+  }
+
+  _bytes -= ioList.bytes.size() - aCursor.offset;
+  ioList.bytes.resize(aCursor.offset);
+  ioList.count = aCursor.index;
+  ioList.last = aCursor.previous;
+  std::erase_if(ioList.skips, [&aCursor](const Cursor& iSkip) {
+    return iSkip.index >= aCursor.index;
+  });
+}
+
+Posting OwnerHistoryIndex::next(const PostingList& iList, Cursor& ioCursor) {
+  ByteReader aReader{std::string_view{iList.bytes}.substr(ioCursor.offset)};
+  std::uint64_t aHeightDelta{}, aPosition{};
+  aReader.getVarU64(aHeightDelta);
+  aReader.getVarU64(aPosition);
+  Posting aPosting{
+      static_cast<std::uint32_t>(ioCursor.previous.height + aHeightDelta),
+      static_cast<std::uint32_t>(aPosition)};
+  if (!aHeightDelta && ioCursor.index) {
+    aPosting.position += ioCursor.previous.position + 1;
+  }
+  ioCursor.offset += aReader.position();
+  ++ioCursor.index;
+  ioCursor.previous = aPosting;
+  return aPosting;
+}
+} // namespace chain
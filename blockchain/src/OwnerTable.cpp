@@ -0,0 +1,93 @@
+// author: georgiosmatzarapis
+
+#include <bit>
+#include <functional>
+
+#include "OwnerTable.hpp"
+
+namespace ledger {
+
+static constexpr std::size_t kMinimumSlots{64};
+
+/* === Helpers === */
+
+static std::uint64_t Hash(std::string_view iOwner) {
+  return std::hash<std::string_view>{}(iOwner);
+}
+
+/* === OwnerTable Class === */
+
+OwnerTable::OwnerTable() : _slots(kMinimumSlots) {}
+
+// Public API
+
+OwnerId OwnerTable::intern(std::string_view iOwner) {
+  const std::uint64_t aHash{Hash(iOwner)};
+  std::size_t aSlot{findSlot(iOwner, aHash)};
+  if (_slots[aSlot].ownerId != kEmptySlot) {
+    return _slots[aSlot].ownerId;
+  }
+
+  // Keep the load factor under 0.75 so that probe sequences stay short.
+  if ((_names.size() + 1) * 4 > _slots.size() * 3) {
+    rehash(_slots.size() * 2);
+    aSlot = findSlot(iOwner, aHash);
+  }
+  const auto aOwnerId{static_cast<OwnerId>(_names.size())};
+  _names.emplace_back(iOwner);
+  _slots[aSlot] = Slot{aHash, aOwnerId};
+  return aOwnerId;
+}
+
+std::optional<OwnerId> OwnerTable::find(std::string_view iOwner) const {
+  const Slot& aSlot{_slots[findSlot(iOwner, Hash(iOwner))]};
+  if (aSlot.ownerId == kEmptySlot) {
+    return std::nullopt;
+  }
+  return aSlot.ownerId;
+}
+
+const std::string& OwnerTable::getName(const OwnerId iOwnerId) const {
+  return _names.at(iOwnerId);
+}
+
+std::size_t OwnerTable::size() const { return _names.size(); }
+
+void OwnerTable::reserve(const std::size_t iOwners) {
+  _names.reserve(iOwners);
+  const std::size_t aSlotCount{std::bit_ceil(iOwners * 4 / 3 + 1)};
+  if (aSlotCount > _slots.size()) {
+    rehash(aSlotCount);
+  }
+}
+
+// Private API
+
+std::size_t OwnerTable::findSlot(std::string_view iOwner,
+                                 const std::uint64_t iHash) const {
+  const std::size_t aMask{_slots.size() - 1};
+  for (std::size_t aSlot{iHash & aMask};; aSlot = (aSlot + 1) & aMask) {
+    const Slot& aCandidate{_slots[aSlot]};
+    if (aCandidate.ownerId == kEmptySlot ||
+        (aCandidate.hash == iHash && _names[aCandidate.ownerId] == iOwner)) {
+      return aSlot;
+    }
+  }
+}
+
+void OwnerTable::rehash(const std::size_t iSlotCount) {
+  std::vector<Slot> aSlots(iSlotCount);
+  const std::size_t aMask{iSlotCount - 1};
+  for (const Slot& aSlot : _slots) {
+    if (aSlot.ownerId == kEmptySlot) {
+      continue;
+    }
+    std::size_t aTarget{aSlot.hash & aMask};
+    while (aSlots[aTarget].ownerId != kEmptySlot) {
+      aTarget = (aTarget + 1) & aMask;
+    }
+    aSlots[aTarget] = aSlot;
+  }
+  _slots = std::move(aSlots);
+}
+} // namespace ledger
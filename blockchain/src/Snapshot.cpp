@@ -0,0 +1,242 @@
+// author: georgiosmatzarapis
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "ByteStream.hpp"
+#include "Checksum.hpp"
+#include "Logger.hpp"
+#include "Snapshot.hpp"
+
+namespace ledger {
+
+using namespace utils;
+
+static const Log& sLog{Log::GetInstance()};
+
+static constexpr std::uint32_t kSnapshotMagic{0x31504E53}; // "SNP1"
+static constexpr std::string_view kSnapshotPrefix{"snapshot-"};
+static constexpr std::string_view kSnapshotExtension{".bin"};
+static constexpr std::size_t kChecksumSize{sizeof(std::uint32_t)};
+
+/* === Helpers === */
+
+static std::string ErrnoMessage(const std::string& iOperation) {
+  return iOperation + " failed: " + std::strerror(errno);
+}
+
+static std::filesystem::path
+SnapshotPath(const std::filesystem::path& iDirectory,
+             const std::uint32_t iChainLength) {
+  char sFileName[32]{};
+  std::snprintf(sFileName, sizeof(sFileName), "snapshot-%010u.bin",
+                iChainLength);
+  return iDirectory / sFileName;
+}
+
+/**
+ * @return Snapshot files of the directory, newest first.
+ */
+static std::vector<std::filesystem::path>
+ListSnapshots(const std::filesystem::path& iDirectory) {
+  std::vector<std::filesystem::path> sSnapshots{};
+  std::error_code sError{};
+  for (const auto& sEntry :
+       std::filesystem::directory_iterator{iDirectory, sError}) {
+    const std::string sFileName{sEntry.path().filename().string()};
+    if (sFileName.size() == kSnapshotPrefix.size() + 10 +
+                                kSnapshotExtension.size() &&
+        sFileName.starts_with(kSnapshotPrefix) &&
+        sFileName.ends_with(kSnapshotExtension)) {
+      sSnapshots.push_back(sEntry.path());
+    }
+  }
+  // Zero-padded lengths sort chronologically.
+  std::sort(sSnapshots.rbegin(), sSnapshots.rend());
+  return sSnapshots;
+}
+
+static bool WriteFile(const std::filesystem::path& iPath,
+                      std::string_view iBytes) {
+  const int sFileDescriptor{
+      ::open(iPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644)};
+  if (sFileDescriptor < 0) {
+    return false;
+  }
+  while (!iBytes.empty()) {
+    const ssize_t sWritten{
+        ::write(sFileDescriptor, iBytes.data(), iBytes.size())};
+    if (sWritten < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      ::close(sFileDescriptor);
+      return false;
+    }
+    iBytes.remove_prefix(static_cast<std::size_t>(sWritten));
+  }
+  const bool sIsSynced{::fsync(sFileDescriptor) == 0};
+  return ::close(sFileDescriptor) == 0 && sIsSynced;
+}
+
+static bool SyncDirectory(const std::filesystem::path& iDirectory) {
+  const int sFileDescriptor{::open(iDirectory.c_str(), O_RDONLY | O_DIRECTORY)};
+  if (sFileDescriptor < 0) {
+    return false;
+  }
+  const bool sIsSynced{::fsync(sFileDescriptor) == 0};
+  ::close(sFileDescriptor);
+  return sIsSynced;
+}
+
+static std::expected<Snapshot, std::string>
+ParseSnapshot(std::string_view iBytes) {
+  if (iBytes.size() < kChecksumSize) {
+    return std::unexpected{std::string{"Snapshot is truncated."}};
+  }
+  const std::string_view sBody{iBytes.substr(0, iBytes.size() - kChecksumSize)};
+  std::uint32_t sChecksum{};
+  ByteReader{iBytes.substr(sBody.size())}.getU32(sChecksum);
+  if (Crc32c(sBody.data(), sBody.size()) != sChecksum) {
+    return std::unexpected{std::string{"Snapshot checksum mismatch."}};
+  }
+
+  ByteReader sReader{sBody};
+  Snapshot sSnapshot{};
+  std::uint32_t sMagic{};
+  std::uint64_t sOwnerCount{};
+  if (!sReader.getU32(sMagic) || sMagic != kSnapshotMagic ||
+      !sReader.getU32(sSnapshot.chainLength) ||
+      !sReader.getString(sSnapshot.tipHash) || !sReader.getU64(sOwnerCount)) {
+    return std::unexpected{std::string{"Snapshot header is invalid."}};
+  }
+
+  sSnapshot.ledger.reserve(static_cast<std::size_t>(
+      std::min<std::uint64_t>(sOwnerCount, sReader.remaining())));
+  std::string_view sOwner{};
+  std::uint64_t sBalance{};
+  for (std::uint64_t sIndex{}; sIndex < sOwnerCount; ++sIndex) {
+    if (!sReader.getStringView(sOwner) || !sReader.getU64(sBalance)) {
+      return std::unexpected{std::string{"Snapshot balances are truncated."}};
+    }
+    sSnapshot.ledger.restore(sOwner, sBalance);
+  }
+  if (sReader.remaining()) {
+    return std::unexpected{std::string{"Snapshot has trailing bytes."}};
+  }
+  return sSnapshot;
+}
+
+static std::expected<Snapshot, std::string>
+MapSnapshot(const std::filesystem::path& iPath) {
+  const int sFileDescriptor{::open(iPath.c_str(), O_RDONLY)};
+  if (sFileDescriptor < 0) {
+    return std::unexpected{ErrnoMessage("open " + iPath.string())};
+  }
+  struct stat sStat{};
+  if (::fstat(sFileDescriptor, &sStat) != 0 || sStat.st_size <= 0) {
+    ::close(sFileDescriptor);
+    return std::unexpected{"Snapshot " + iPath.string() + " is empty."};
+  }
+  const auto sSize{static_cast<std::size_t>(sStat.st_size)};
+  void* sMapping{
+      ::mmap(nullptr, sSize, PROT_READ, MAP_PRIVATE, sFileDescriptor, 0)};
+  ::close(sFileDescriptor);
+  if (sMapping == MAP_FAILED) {
+    return std::unexpected{ErrnoMessage("mmap " + iPath.string())};
+  }
+  // Pages are faulted in on demand while parsing; hint the kernel to read
+  // ahead since the file is consumed front to back.
+  ::madvise(sMapping, sSize, MADV_SEQUENTIAL);
+
+  std::expected<Snapshot, std::string> sSnapshot{ParseSnapshot(
+      std::string_view{static_cast<const char*>(sMapping), sSize})};
+  ::munmap(sMapping, sSize);
+  return sSnapshot;
+}
+
+// Public API
+
+std::expected<void, std::string>
+WriteSnapshot(const std::filesystem::path& iDirectory, const Ledger& iLedger,
+              const std::uint32_t iChainLength, const std::string& iTipHash,
+              const std::size_t iKeep) {
+  const OwnerTable& sOwners{iLedger.getOwners()};
+  std::uint64_t sOwnerCount{};
+  for (OwnerId sOwnerId{}; sOwnerId < sOwners.size(); ++sOwnerId) {
+    sOwnerCount += iLedger.getBalance(sOwnerId) ? 1 : 0;
+  }
+
+  ByteWriter sWriter{64 + sOwners.size() * 32};
+  sWriter.putU32(kSnapshotMagic);
+  sWriter.putU32(iChainLength);
+  sWriter.putString(iTipHash);
+  sWriter.putU64(sOwnerCount);
+  for (OwnerId sOwnerId{}; sOwnerId < sOwners.size(); ++sOwnerId) {
+    if (const std::uint64_t sBalance{iLedger.getBalance(sOwnerId)}; sBalance) {
+      sWriter.putString(sOwners.getName(sOwnerId));
+      sWriter.putU64(sBalance);
+    }
+  }
+  sWriter.putU32(Crc32c(sWriter.buffer().data(), sWriter.size()));
+
+  const std::filesystem::path sPath{SnapshotPath(iDirectory, iChainLength)};
+  std::filesystem::path sTemporaryPath{sPath};
+  sTemporaryPath += ".tmp";
+  if (!WriteFile(sTemporaryPath, sWriter.buffer())) {
+    const std::string sErrorMessage{ErrnoMessage("Snapshot write")};
+    std::filesystem::remove(sTemporaryPath);
+    return std::unexpected{sErrorMessage};
+  }
+  std::error_code sError{};
+  std::filesystem::rename(sTemporaryPath, sPath, sError);
+  if (sError || !SyncDirectory(iDirectory)) {
+    std::filesystem::remove(sTemporaryPath, sError);
+    return std::unexpected{"Snapshot rename failed: " + sError.message()};
+  }
+
+  const std::vector<std::filesystem::path> sSnapshots{
+      ListSnapshots(iDirectory)};
+  for (std::size_t sIndex{std::max<std::size_t>(iKeep, 1)};
+       sIndex < sSnapshots.size(); ++sIndex) {
+    std::filesystem::remove(sSnapshots[sIndex], sError);
+  }
+  sLog.toFile(LogLevel::INFO,
+              "Snapshot written at chain length " +
+                  std::to_string(iChainLength) + ".",
+              __PRETTY_FUNCTION__);
+  return {};
+}
+
+std::expected<Snapshot, std::string> LoadLatestSnapshot(
+    const std::filesystem::path& iDirectory,
+    const std::function<bool(std::uint32_t, const std::string&)>& iIsUsable) {
+  for (const std::filesystem::path& sPath : ListSnapshots(iDirectory)) {
+    std::expected<Snapshot, std::string> sSnapshot{MapSnapshot(sPath)};
+    if (!sSnapshot) {
+      sLog.toFile(LogLevel::WARNING,
+                  "Skipping snapshot " + sPath.string() + ": " +
+                      sSnapshot.error(),
+                  __PRETTY_FUNCTION__);
+      continue;
+    }
+    if (!iIsUsable(sSnapshot.value().chainLength, sSnapshot.value().tipHash)) {
+      sLog.toFile(LogLevel::WARNING,
+                  "Skipping snapshot " + sPath.string() +
+                      " not matching the stored blocks.",
+                  __PRETTY_FUNCTION__);
+      continue;
+    }
+    return sSnapshot;
+  }
+  return std::unexpected{std::string{"No usable snapshot found."}};
+}
+} // namespace ledger
@@ -43,6 +43,17 @@ Coinbase::Coinbase(std::string owner, const double& bitcoinAmount)
       _timestamp{std::chrono::system_clock::now()},
       _unixTimestamp{utils::core_lib::GetUnixTimestamp(_timestamp)} {}
 
+Coinbase::Coinbase(std::string owner, const double& bitcoinAmount,
+                   const std::chrono::system_clock::time_point& timestamp,
+                   std::string hash)
+    : _hash{std::move(hash)},
+      _owner{std::move(owner)},
+      _bitcoinAmount{bitcoinAmount},
+      _timestamp{timestamp},
+      _unixTimestamp{utils::core_lib::GetUnixTimestamp(_timestamp)},
+      _satoshiAmount{BitcoinToSatoshi(_bitcoinAmount)},
+      _bitcoinRepresentation{BitcoinRepresentation(_bitcoinAmount)} {}
+
 Coinbase::Coinbase(const Coinbase& coinbase) = default;
 
 Coinbase& Coinbase::operator=(const Coinbase& coinbase) = default;
@@ -82,7 +93,7 @@ Coinbase::~Coinbase() = default;
 
 // Public API
 
-std::string Coinbase::getOwner() const { return _owner; }
+const std::string& Coinbase::getOwner() const { return _owner; }
 
 double Coinbase::getBitcoinAmount() const { return _bitcoinAmount; }
 
@@ -100,12 +111,8 @@ std::string Coinbase::getBitcoinRepresentation() const {
 
 std::string Coinbase::getHash() {
   if (!_hash.size()) {
-    const auto aSatoshiAmountCppStr{std::to_string(_satoshiAmount)};
-    const auto aUnixTimestampCppStr{std::to_string(_unixTimestamp)};
-    const std::string aMessage{_owner + aSatoshiAmountCppStr +
-                               aUnixTimestampCppStr};
     const std::expected<std::string, std::string> aHash{
-        utils::core_lib::ComputeHash(aMessage)};
+        utils::core_lib::ComputeHash(getHashMessage())};
     if (!aHash) {
       throw utils::core_lib::exception::HashCalculationError{aHash.error()};
     }
@@ -114,12 +121,25 @@ std::string Coinbase::getHash() {
   return _hash;
 }
 
+bool Coinbase::hasHash() const { return !_hash.empty(); }
+
+std::string Coinbase::getHashMessage() const {
+  return _owner + std::to_string(_satoshiAmount) +
+         std::to_string(_unixTimestamp);
+}
+
 /* === Payload Class === */
 
 Payload::Payload(std::string owner, std::string receiver, const double& amount)
     : Coinbase{owner, amount},
       _receiver{std::move(receiver)} {}
 
+Payload::Payload(std::string owner, std::string receiver, const double& amount,
+                 const std::chrono::system_clock::time_point& timestamp,
+                 std::string hash)
+    : Coinbase{std::move(owner), amount, timestamp, std::move(hash)},
+      _receiver{std::move(receiver)} {}
+
 Payload::Payload(const Payload& payload) = default;
 
 Payload& Payload::operator=(const Payload& payload) = default;
@@ -140,22 +160,13 @@ Payload::~Payload() = default;
 
 // Public API
 
-std::string Payload::getReceiver() const { return _receiver; }
+const std::string& Payload::getReceiver() const { return _receiver; }
 
-std::string Payload::getHash() {
-  if (!_hash.size()) {
-    const auto aSatoshiAmountCppStr{std::to_string(getSatoshiAmount())};
-    const auto aUnixTimestampCppStr{std::to_string(getUnixTimestamp())};
-    const std::string aMessage{getOwner() + _receiver + aSatoshiAmountCppStr +
-                               aUnixTimestampCppStr};
-    const std::expected<std::string, std::string> aHash{
-        utils::core_lib::ComputeHash(aMessage)};
-    if (!aHash) {
-      throw utils::core_lib::exception::HashCalculationError{aHash.error()};
-    }
-    _hash = aHash.value();
-  }
-  return _hash;
+std::string Payload::getHash() { return Coinbase::getHash(); }
+
+std::string Payload::getHashMessage() const {
+  return getOwner() + _receiver + std::to_string(getSatoshiAmount()) +
+         std::to_string(getUnixTimestamp());
 }
 
 } // namespace transaction
\ No newline at end of file
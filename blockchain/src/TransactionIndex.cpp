@@ -0,0 +1,105 @@
+// author: georgiosmatzarapis
+
+#include "TransactionIndex.hpp"
+
+namespace chain {
+
+/* === Helpers === */
+
+/**
+ * @brief Visit the hashes of the transactions of a block.
+ */
+template <typename Visitor>
+static void ForEachHash(const block::Block& iBlock, const Visitor& iVisitor) {
+  if (const auto& sCoinbases{iBlock.getCoinbases()}; sCoinbases.has_value()) {
+    for (const auto& sCoinbase : sCoinbases.value()) {
+      iVisitor(sCoinbase->getHash());
+    }
+  }
+  if (const auto& sPayloads{iBlock.getPayloads()}; sPayloads.has_value()) {
+    for (const auto& sPayload : sPayloads.value()) {
+      iVisitor(sPayload->getHash());
+    }
+  }
+}
+
+/* === TransactionIndex Class === */
+
+TransactionIndex::TransactionIndex(TransactionIndexOptions options)
+    : _options{options},
+      _filter{options.expectedTransactions, options.falsePositiveRate},
+      _filterCapacity{options.expectedTransactions} {}
+
+// Public API
+
+std::expected<void, std::string>
+TransactionIndex::build(const Chain& iChain) {
+  const std::uint32_t aLength{iChain.getLength()};
+  for (std::uint32_t aHeight{iChain.getFirstBlockHeight()}; aHeight < aLength;
+       ++aHeight) {
+    const std::expected<block::Block, std::string> aBlock{
+        iChain.getBlock(aHeight)};
+    if (!aBlock) {
+      return std::unexpected{aBlock.error()};
+    }
+    onBlockConnected(aBlock.value());
+  }
+  return {};
+}
+
+void TransactionIndex::onBlockConnected(const block::Block& iBlock) {
+  ForEachHash(iBlock, [this, &iBlock](const std::string& iHash) {
+    insert(iHash, iBlock.getIndex());
+  });
+}
+
+void TransactionIndex::onBlockDisconnected(const block::Block& iBlock) {
+  ForEachHash(iBlock, [this, &iBlock](const std::string& iHash) {
+    if (const auto aHeight{_heights.find(iHash)};
+        aHeight != _heights.end() && aHeight->second == iBlock.getIndex()) {
+      _heights.erase(aHeight);
+    }
+  });
+}
+
+bool TransactionIndex::contains(const std::string& iHash) const {
+  return findHeight(iHash).has_value();
+}
+
+std::optional<std::uint32_t>
+TransactionIndex::findHeight(const std::string& iHash) const {
+  if (!_filter.mayContain(utils::BloomFilter::DigestKey(iHash))) {
+    return std::nullopt;
+  }
+  const auto aHeight{_heights.find(iHash)};
+  return aHeight == _heights.end() ? std::nullopt
+                                   : std::make_optional(aHeight->second);
+}
+
+std::size_t TransactionIndex::size() const { return _heights.size(); }
+
+// Private API
+
+void TransactionIndex::insert(const std::string& iHash,
+                              const std::uint32_t iHeight) {
+  if (!_heights.insert_or_assign(iHash, iHeight).second) {
+    return;
+  }
+  if (_filterItems >= _filterCapacity) {
+    // Removed transactions are dropped from the filter on the way.
+    rebuildFilter(std::max(_filterCapacity, 2 * _heights.size()));
+    return;
+  }
+  _filter.add(utils::BloomFilter::DigestKey(iHash));
+  ++_filterItems;
+}
+
+void TransactionIndex::rebuildFilter(const std::size_t iCapacity) {
+  _filter = utils::BloomFilter{iCapacity, _options.falsePositiveRate};
+  _filterCapacity = iCapacity;
+  _filterItems = _heights.size();
+  for (const auto& [aHash, aHeight] : _heights) {
+    _filter.add(utils::BloomFilter::DigestKey(aHash));
+  }
+}
+} // namespace chain
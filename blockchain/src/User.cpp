@@ -1,7 +1,18 @@
 // author: georgiosmatzarapis
 
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <limits>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+
 #include "User.hpp"
+#include "Common.hpp"
+#include "Journal.hpp"
 #include "Logger.hpp"
+#include "Metrics.hpp"
 
 namespace user {
 
@@ -9,40 +20,234 @@ using namespace utils;
 
 static const Log& sLog{Log::GetInstance()};
 
+static constexpr std::size_t kMinimumBuckets{64};
+static constexpr double kSatoshiPerBitcoin{1e8};
+/**
+ * Operations are logged in full up to the burst, then sampled, so that bulk
+ * workloads are not bound by logging.
+ */
+static constexpr LogThrottlePolicy kOperationLogPolicy{
+    100, std::chrono::seconds{1}, 1000};
+
+/* === Helpers === */
+
+static std::int64_t ToSatoshi(const double iAmount) {
+  return std::llround(iAmount * kSatoshiPerBitcoin);
+}
+
+/**
+ * @brief Spread the ids, which are sequential and strided by shard, over the
+ * whole index.
+ */
+static std::uint64_t Hash(const ProfileId iProfileId) {
+  std::uint64_t sHash{iProfileId + 0x9e3779b97f4a7c15ULL};
+  sHash = (sHash ^ (sHash >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  sHash = (sHash ^ (sHash >> 27)) * 0x94d049bb133111ebULL;
+  return sHash ^ (sHash >> 31);
+}
+
+static bool Persist(Journal& ioJournal, const Journal::Batch& iBatch) {
+  if (const auto sAppended{ioJournal.append(iBatch)}; !sAppended) {
+    sLog.toFile(LogLevel::ERROR,
+                "[DB] Change could not be journaled. " + sAppended.error(),
+                __PRETTY_FUNCTION__);
+    return false;
+  }
+  return true;
+}
+
+static Histogram& OperationDuration(const std::string& iOperation) {
+  return MetricsRegistry::GetInstance().histogram(
+      "blockchain_db_operation_seconds",
+      "Duration of the operations of the user database.",
+      "operation=\"" + iOperation + "\"", 1e-9);
+}
+
+static Histogram& sInsertDuration{OperationDuration("insert")};
+static Histogram& sInsertManyDuration{OperationDuration("insert_many")};
+static Histogram& sGetDuration{OperationDuration("get")};
+static Histogram& sGetManyDuration{OperationDuration("get_many")};
+static Histogram& sRemoveDuration{OperationDuration("remove")};
+static Histogram& sTransferDuration{OperationDuration("transfer")};
+static Histogram& sUpdateDuration{OperationDuration("update")};
+
 /* === Profile Class === */
 
 Profile::Profile(std::string fullName, const std::uint8_t& age,
                  const double& deposit = 0)
     : _fullName{std::move(fullName)},
       _age{age},
-      _deposit{deposit} {}
+      _deposit{ToSatoshi(deposit)} {}
 
 // Public API
 
-std::string Profile::getFullName() const { return _fullName; }
+const std::string& Profile::getFullName() const { return _fullName; }
 
 std::uint8_t Profile::getAge() const { return _age; }
 
-double Profile::getDeposit() const { return _deposit; }
+double Profile::getDeposit() const {
+  return static_cast<double>(_deposit) / kSatoshiPerBitcoin;
+}
+
+std::int64_t Profile::getSatoshiDeposit() const { return _deposit; }
 
 bool Profile::updateDeposit(const double iAmount) {
-  const double aUpdatedDeposit{_deposit + iAmount};
+  const std::int64_t aUpdatedDeposit{_deposit + ToSatoshi(iAmount)};
   return [&]() -> bool {
     if (aUpdatedDeposit >= 0) {
       _deposit = aUpdatedDeposit;
-      sLog.toFile(LogLevel::INFO,
-                  "Deposit for user '" + _fullName + "' is updated.",
-                  __PRETTY_FUNCTION__);
+      LOG_STRUCTURED_THROTTLED(LogLevel::INFO, kOperationLogPolicy,
+                               "Deposit for user '{}' is updated.", _fullName);
       return true;
     }
 
-    sLog.toFile(LogLevel::WARNING,
-                "Invalid amount to update deposit of user '" + _fullName + "'.",
-                __PRETTY_FUNCTION__);
+    LOG_STRUCTURED_THROTTLED(LogLevel::WARNING, kOperationLogPolicy,
+                             "Invalid amount to update deposit of user '{}'.",
+                             _fullName);
     return false;
   }();
 }
 
+/* === ProfileTable Class === */
+
+ProfileTable::ProfileTable() : _buckets(kMinimumBuckets) {}
+
+// Public API
+
+StoredProfile* ProfileTable::find(const ProfileId iProfileId) {
+  const Bucket& aBucket{_buckets[findBucket(iProfileId)]};
+  return aBucket.slot == kEmptyBucket ? nullptr : &*getSlot(aBucket.slot);
+}
+
+const StoredProfile* ProfileTable::find(const ProfileId iProfileId) const {
+  const Bucket& aBucket{_buckets[findBucket(iProfileId)]};
+  return aBucket.slot == kEmptyBucket ? nullptr : &*getSlot(aBucket.slot);
+}
+
+bool ProfileTable::insert(const ProfileId iProfileId, Profile&& ioProfile,
+                          const std::uint64_t iVersion) {
+  std::size_t aBucket{findBucket(iProfileId)};
+  if (_buckets[aBucket].slot != kEmptyBucket) {
+    return false;
+  }
+
+  // Keep the load factor under 0.75 so that probe sequences stay short.
+  if ((_size + 1) * 4 > _buckets.size() * 3) {
+    rehash(_buckets.size() * 2);
+    aBucket = findBucket(iProfileId);
+  }
+  const std::uint32_t aSlot{allocateSlot()};
+  getSlot(aSlot).emplace(std::move(ioProfile), iVersion);
+  _buckets[aBucket] = Bucket{iProfileId, aSlot};
+  ++_size;
+  return true;
+}
+
+bool ProfileTable::erase(const ProfileId iProfileId) {
+  std::size_t aHole{findBucket(iProfileId)};
+  if (_buckets[aHole].slot == kEmptyBucket) {
+    return false;
+  }
+  getSlot(_buckets[aHole].slot).reset();
+  _freeSlots.push_back(_buckets[aHole].slot);
+  --_size;
+
+  // Shift back the following buckets of the cluster that would not be found
+  // past the hole anymore, instead of leaving a tombstone.
+  const std::size_t aMask{_buckets.size() - 1};
+  for (std::size_t aNext{(aHole + 1) & aMask};
+       _buckets[aNext].slot != kEmptyBucket; aNext = (aNext + 1) & aMask) {
+    const std::size_t aHome{Hash(_buckets[aNext].profileId) & aMask};
+    if (((aNext - aHome) & aMask) >= ((aNext - aHole) & aMask)) {
+      _buckets[aHole] = _buckets[aNext];
+      aHole = aNext;
+    }
+  }
+  _buckets[aHole] = Bucket{};
+  return true;
+}
+
+void ProfileTable::reserve(const std::size_t iProfiles) {
+  const std::size_t aBucketCount{
+      std::bit_ceil((_size + iProfiles) * 4 / 3 + 1)};
+  if (aBucketCount > _buckets.size()) {
+    rehash(aBucketCount);
+  }
+  const std::size_t aFreeSlots{_freeSlots.size() + getCapacity() - _usedSlots};
+  if (iProfiles > aFreeSlots) {
+    const std::size_t aSlabCount{
+        _slabs.size() + (iProfiles - aFreeSlots + kSlabSize - 1) / kSlabSize};
+    _slabs.reserve(aSlabCount);
+    while (_slabs.size() < aSlabCount) {
+      _slabs.push_back(
+          std::make_unique<std::optional<StoredProfile>[]>(kSlabSize));
+    }
+  }
+}
+
+void ProfileTable::prefetch(const ProfileId iProfileId) const {
+  __builtin_prefetch(&_buckets[Hash(iProfileId) & (_buckets.size() - 1)]);
+}
+
+std::size_t ProfileTable::size() const { return _size; }
+
+std::size_t ProfileTable::getCapacity() const {
+  return _slabs.size() * kSlabSize;
+}
+
+// Private API
+
+std::optional<StoredProfile>&
+ProfileTable::getSlot(const std::uint32_t iSlot) {
+  return _slabs[iSlot / kSlabSize][iSlot % kSlabSize];
+}
+
+const std::optional<StoredProfile>&
+ProfileTable::getSlot(const std::uint32_t iSlot) const {
+  return _slabs[iSlot / kSlabSize][iSlot % kSlabSize];
+}
+
+std::uint32_t ProfileTable::allocateSlot() {
+  if (!_freeSlots.empty()) {
+    const std::uint32_t aSlot{_freeSlots.back()};
+    _freeSlots.pop_back();
+    return aSlot;
+  }
+  if (_usedSlots == getCapacity()) {
+    _slabs.push_back(
+        std::make_unique<std::optional<StoredProfile>[]>(kSlabSize));
+  }
+  return _usedSlots++;
+}
+
+std::size_t ProfileTable::findBucket(const ProfileId iProfileId) const {
+  const std::size_t aMask{_buckets.size() - 1};
+  for (std::size_t aBucket{Hash(iProfileId) & aMask};;
+       aBucket = (aBucket + 1) & aMask) {
+    const Bucket& aCandidate{_buckets[aBucket]};
+    if (aCandidate.slot == kEmptyBucket ||
+        aCandidate.profileId == iProfileId) {
+      return aBucket;
+    }
+  }
+}
+
+void ProfileTable::rehash(const std::size_t iBucketCount) {
+  std::vector<Bucket> aBuckets(iBucketCount);
+  const std::size_t aMask{iBucketCount - 1};
+  for (const Bucket& aBucket : _buckets) {
+    if (aBucket.slot == kEmptyBucket) {
+      continue;
+    }
+    std::size_t aTarget{Hash(aBucket.profileId) & aMask};
+    while (aBuckets[aTarget].slot != kEmptyBucket) {
+      aTarget = (aTarget + 1) & aMask;
+    }
+    aBuckets[aTarget] = aBucket;
+  }
+  _buckets = std::move(aBuckets);
+}
+
 /* === InMemoryDatabase Class === */
 
 InMemoryDatabase::InMemoryDatabase() = default;
@@ -56,75 +261,610 @@ InMemoryDatabase& InMemoryDatabase::GetInstance() {
   return sInstance;
 }
 
-std::pair<bool, std::optional<std::uint16_t>>
-InMemoryDatabase::insert(Profile iProfile) {
-  std::uint16_t aProfileId{idGenerator()};
-  const auto aRecordIterator{_profiles.emplace(
-      aProfileId, std::make_unique<Profile>(std::move(iProfile)))};
-
-  if (aRecordIterator.second) {
-    sLog.toFile(LogLevel::INFO,
-                "[DB] Profile inserted with id: " + std::to_string(_profileId) +
-                    ".",
+std::expected<void, std::string>
+InMemoryDatabase::open(const std::filesystem::path& iDirectory,
+                       const JournalOptions& iOptions) {
+  std::unique_ptr<Journal> aJournal{};
+  try {
+    aJournal = std::make_unique<Journal>(iDirectory, iOptions);
+  } catch (const core_lib::exception::StorageError& iError) {
+    return std::unexpected{std::string{iError.what()}};
+  }
+
+  // Recover aside, so that a failure leaves the current profiles untouched.
+  std::array<ProfileTable, kShardCount> aTables{};
+  std::size_t aProfileCount{};
+  const std::expected<ProfileId, std::string> aNextProfileId{
+      aJournal->recover([&](const ProfileId iProfileId,
+                            std::optional<Profile>&& ioProfile) {
+        ProfileTable& aTable{aTables[iProfileId % kShardCount]};
+        aProfileCount -= aTable.erase(iProfileId) ? 1 : 0;
+        if (ioProfile) {
+          aTable.insert(iProfileId, std::move(*ioProfile));
+          ++aProfileCount;
+        }
+      })};
+  if (!aNextProfileId) {
+    sLog.toFile(LogLevel::ERROR,
+                "[DB] Recovery from " + iDirectory.string() + " failed. " +
+                    aNextProfileId.error(),
                 __PRETTY_FUNCTION__);
-    return {true, std::make_optional<std::uint16_t>(aProfileId)};
+    return std::unexpected{aNextProfileId.error()};
+  }
+
+  {
+    std::array<std::unique_lock<std::shared_mutex>, kShardCount> aLocks{};
+    for (std::size_t aShard{}; aShard < kShardCount; ++aShard) {
+      aLocks[aShard] = std::unique_lock{_shards[aShard].mutex};
+      std::swap(_shards[aShard].profiles, aTables[aShard]);
+      _shards[aShard].previousVersions.clear();
+      _shards[aShard].oldestSupersededVersion.store(
+          std::numeric_limits<std::uint64_t>::max(), std::memory_order_relaxed);
+    }
+    _nextProfileId.store(*aNextProfileId, std::memory_order_relaxed);
+    _journal = std::move(aJournal);
   }
 
-  sLog.toFile(LogLevel::WARNING,
-              "[DB] Profile insertion failed with id: " +
-                  std::to_string(_profileId) + ".",
+  sLog.toFile(LogLevel::INFO,
+              "[DB] " + std::to_string(aProfileCount) +
+                  " profile(s) recovered from " + iDirectory.string() + ".",
               __PRETTY_FUNCTION__);
+  return {};
+}
+
+std::expected<void, std::string>
+InMemoryDatabase::open(const std::filesystem::path& iDirectory) {
+  return open(iDirectory, JournalOptions{});
+}
+
+bool InMemoryDatabase::sync() { return !_journal || _journal->sync(); }
+
+std::expected<void, std::string> InMemoryDatabase::checkpoint() {
+  if (!_journal) {
+    return std::unexpected{std::string{"Database is not persisted."}};
+  }
+
+  std::uint64_t aSequence{};
+  ProfileId aNextProfileId{};
+  Journal::Batch aProfiles{};
+  {
+    std::array<std::shared_lock<std::shared_mutex>, kShardCount> aLocks{};
+    for (std::size_t aShard{}; aShard < kShardCount; ++aShard) {
+      aLocks[aShard] = std::shared_lock{_shards[aShard].mutex};
+    }
+    const std::expected<std::uint64_t, std::string> aRotated{
+        _journal->rotate()};
+    if (!aRotated) {
+      return std::unexpected{aRotated.error()};
+    }
+    aSequence = *aRotated;
+    aNextProfileId = _nextProfileId.load(std::memory_order_relaxed);
+    for (const Shard& aShard : _shards) {
+      aShard.profiles.forEach(
+          [&aProfiles](const ProfileId iProfileId,
+                       const StoredProfile& iStored) {
+            aProfiles.put(iProfileId, iStored.profile);
+          });
+    }
+  }
+  return _journal->writeSnapshot(aSequence, aNextProfileId, aProfiles);
+}
+
+std::pair<bool, std::optional<ProfileId>>
+InMemoryDatabase::insert(Profile iProfile) {
+  const MetricsTimer aTimer{sInsertDuration};
+  const ProfileId aProfileId{idGenerator()};
+  bool aIsInserted{};
+  {
+    Shard& aShard{getShard(aProfileId)};
+    std::unique_lock aLock{aShard.mutex};
+    aIsInserted = (!_journal || persistPut(aProfileId, iProfile)) &&
+                  aShard.profiles.insert(aProfileId, std::move(iProfile),
+                                         nextVersion());
+  }
+  checkpointIfDue();
+
+  if (aIsInserted) {
+    LOG_STRUCTURED_THROTTLED(LogLevel::INFO, kOperationLogPolicy,
+                             "[DB] Profile inserted with id: {}.", aProfileId);
+    return {true, std::make_optional<ProfileId>(aProfileId)};
+  }
+
+  LOG_STRUCTURED_THROTTLED(LogLevel::WARNING, kOperationLogPolicy,
+                           "[DB] Profile insertion failed with id: {}.",
+                           aProfileId);
   return {false, std::nullopt};
 }
 
-std::pair<bool, std::optional<Profile>>
-InMemoryDatabase::get(const std::uint16_t iProfileId) const {
-  std::unordered_map<std::uint16_t, std::unique_ptr<Profile>>::const_iterator
-      aProfilesIterator{_profiles.find(iProfileId)};
+std::pair<bool, std::optional<ProfileId>>
+InMemoryDatabase::insertMany(std::vector<Profile> iProfiles) {
+  const MetricsTimer aTimer{sInsertManyDuration};
+  if (iProfiles.empty()) {
+    return {true, std::nullopt};
+  }
+  const ProfileId aFirstId{idGenerator(iProfiles.size())};
+  const std::size_t aShardCount{std::min(iProfiles.size(), kShardCount)};
+  // The ids are not visible to anyone yet, so the batch is encoded before
+  // locking; only the append must happen under the locks, so that a
+  // checkpoint cannot come between it and the insertion.
+  Journal::Batch aBatch{};
+  if (_journal) {
+    for (std::size_t aIndex{}; aIndex < iProfiles.size(); ++aIndex) {
+      aBatch.put(aFirstId + aIndex, iProfiles[aIndex]);
+    }
+  }
+  bool aIsInserted{true};
+  {
+    // Contiguous ids cover the shards that follow the first one in turn.
+    std::array<std::unique_lock<std::shared_mutex>, kShardCount> aLocks{};
+    for (std::size_t aIndex{}; aIndex < kShardCount; ++aIndex) {
+      if ((aIndex + kShardCount - aFirstId % kShardCount) % kShardCount <
+          aShardCount) {
+        aLocks[aIndex] = std::unique_lock{_shards[aIndex].mutex};
+      }
+    }
 
-  if (aProfilesIterator != _profiles.end()) {
-    return {true, std::make_optional<Profile>(*(aProfilesIterator->second))};
+    if (_journal) {
+      aIsInserted = Persist(*_journal, aBatch);
+    }
+    if (aIsInserted) {
+      const std::uint64_t aVersion{nextVersion()};
+      for (std::size_t aIndex{}; aIndex < aShardCount; ++aIndex) {
+        getShard(aFirstId + aIndex)
+            .profiles.reserve((iProfiles.size() - aIndex + kShardCount - 1) /
+                              kShardCount);
+      }
+      for (std::size_t aIndex{}; aIndex < iProfiles.size(); ++aIndex) {
+        getShard(aFirstId + aIndex)
+            .profiles.insert(aFirstId + aIndex, std::move(iProfiles[aIndex]),
+                             aVersion);
+      }
+    }
   }
+  checkpointIfDue();
 
-  sLog.toFile(LogLevel::WARNING,
-              "[DB] Profile retrieval failed with id: " +
-                  std::to_string(_profileId) + ".",
-              __PRETTY_FUNCTION__);
+  if (!aIsInserted) {
+    LOG_STRUCTURED_THROTTLED(LogLevel::WARNING, kOperationLogPolicy,
+                             "[DB] Insertion of {} profile(s) failed.",
+                             iProfiles.size());
+    return {false, std::nullopt};
+  }
+  LOG_STRUCTURED_THROTTLED(LogLevel::INFO, kOperationLogPolicy,
+                           "[DB] {} profile(s) inserted with ids: {} to {}.",
+                           iProfiles.size(), aFirstId,
+                           aFirstId + iProfiles.size() - 1);
+  return {true, std::make_optional<ProfileId>(aFirstId)};
+}
+
+std::pair<bool, std::optional<Profile>>
+InMemoryDatabase::get(const ProfileId iProfileId) const {
+  const MetricsTimer aTimer{sGetDuration};
+  std::optional<Profile> aProfile{};
+  if (read(iProfileId, [&aProfile](const Profile& iProfile) {
+        aProfile.emplace(iProfile);
+      })) {
+    return {true, std::move(aProfile)};
+  }
   return {false, std::nullopt};
 }
 
-bool InMemoryDatabase::remove(const std::uint16_t iProfileId) {
-  if (_profiles.count(iProfileId) == 1) {
-    _profiles.erase(iProfileId);
-    sLog.toFile(LogLevel::INFO,
-                "[DB] Profile removed with id: " + std::to_string(_profileId) +
-                    ".",
-                __PRETTY_FUNCTION__);
+std::vector<std::optional<Profile>>
+InMemoryDatabase::getMany(std::span<const ProfileId> iProfileIds) const {
+  const MetricsTimer aTimer{sGetManyDuration};
+  static constexpr std::size_t kPrefetchDistance{8};
+
+  // Counting sort of the positions of the ids by shard.
+  std::array<std::size_t, kShardCount + 1> aShardStarts{};
+  for (const ProfileId aProfileId : iProfileIds) {
+    ++aShardStarts[aProfileId % kShardCount + 1];
+  }
+  for (std::size_t aShard{}; aShard < kShardCount; ++aShard) {
+    aShardStarts[aShard + 1] += aShardStarts[aShard];
+  }
+  std::vector<std::size_t> aPositions(iProfileIds.size());
+  std::array<std::size_t, kShardCount> aNextPositions{};
+  std::copy_n(aShardStarts.begin(), kShardCount, aNextPositions.begin());
+  for (std::size_t aPosition{}; aPosition < iProfileIds.size(); ++aPosition) {
+    aPositions[aNextPositions[iProfileIds[aPosition] % kShardCount]++] =
+        aPosition;
+  }
+
+  std::vector<std::optional<Profile>> aProfiles(iProfileIds.size());
+  std::size_t aMissingCount{};
+  for (std::size_t aShard{}; aShard < kShardCount; ++aShard) {
+    const std::size_t aBegin{aShardStarts[aShard]};
+    const std::size_t aEnd{aShardStarts[aShard + 1]};
+    if (aBegin == aEnd) {
+      continue;
+    }
+    const ProfileTable& aTable{_shards[aShard].profiles};
+    std::shared_lock aLock{_shards[aShard].mutex};
+    for (std::size_t aIndex{aBegin};
+         aIndex < std::min(aEnd, aBegin + kPrefetchDistance); ++aIndex) {
+      aTable.prefetch(iProfileIds[aPositions[aIndex]]);
+    }
+    for (std::size_t aIndex{aBegin}; aIndex < aEnd; ++aIndex) {
+      if (aIndex + kPrefetchDistance < aEnd) {
+        aTable.prefetch(iProfileIds[aPositions[aIndex + kPrefetchDistance]]);
+      }
+      const std::size_t aPosition{aPositions[aIndex]};
+      if (const StoredProfile* aStored{aTable.find(iProfileIds[aPosition])}) {
+        aProfiles[aPosition].emplace(aStored->profile);
+      } else {
+        ++aMissingCount;
+      }
+    }
+  }
+
+  if (aMissingCount) {
+    LOG_STRUCTURED_THROTTLED(LogLevel::WARNING, kOperationLogPolicy,
+                             "[DB] {} of {} profile(s) not found.",
+                             aMissingCount, iProfileIds.size());
+  }
+  return aProfiles;
+}
+
+bool InMemoryDatabase::remove(const ProfileId iProfileId) {
+  const MetricsTimer aTimer{sRemoveDuration};
+  bool aIsRemoved{};
+  {
+    Shard& aShard{getShard(iProfileId)};
+    std::unique_lock aLock{aShard.mutex};
+    const StoredProfile* aStored{aShard.profiles.find(iProfileId)};
+    if (aStored && (!_journal || persistRemove(iProfileId))) {
+      preserve(aShard, iProfileId, *aStored, nextVersion());
+      aIsRemoved = aShard.profiles.erase(iProfileId);
+    }
+  }
+  checkpointIfDue();
+
+  if (aIsRemoved) {
+    LOG_STRUCTURED_THROTTLED(LogLevel::INFO, kOperationLogPolicy,
+                             "[DB] Profile removed with id: {}.", iProfileId);
     return true;
   }
 
-  sLog.toFile(LogLevel::WARNING,
-              "[DB] Profile removal failed with id: " +
-                  std::to_string(_profileId) + ".",
-              __PRETTY_FUNCTION__);
+  LOG_STRUCTURED_THROTTLED(LogLevel::WARNING, kOperationLogPolicy,
+                           "[DB] Profile removal failed with id: {}.",
+                           iProfileId);
   return false;
 }
 
-bool InMemoryDatabase::update(const std::uint16_t iProfileId,
+bool InMemoryDatabase::update(const ProfileId iProfileId,
                               Profile iProfile) {
-  if (_profiles.count(iProfileId) == 1) {
-    _profiles[iProfileId] = std::make_unique<Profile>(std::move(iProfile));
-    sLog.toFile(LogLevel::INFO,
-                "[DB] Profile updated with id: " + std::to_string(_profileId) +
-                    ".",
+  const MetricsTimer aTimer{sUpdateDuration};
+  bool aIsFound{};
+  bool aIsUpdated{};
+  {
+    Shard& aShard{getShard(iProfileId)};
+    std::unique_lock aLock{aShard.mutex};
+    // The stored profile is left untouched until the new one is journaled.
+    if (StoredProfile* aStored{aShard.profiles.find(iProfileId)}) {
+      aIsFound = true;
+      if (!_journal || persistPut(iProfileId, iProfile)) {
+        const std::uint64_t aVersion{nextVersion()};
+        preserve(aShard, iProfileId, *aStored, aVersion);
+        // The replaced profile is destroyed once the lock is released.
+        std::swap(aStored->profile, iProfile);
+        aStored->version = aVersion;
+        aIsUpdated = true;
+      }
+    }
+  }
+  checkpointIfDue();
+
+  if (!aIsUpdated) {
+    if (!aIsFound) {
+      LOG_STRUCTURED_THROTTLED(LogLevel::WARNING, kOperationLogPolicy,
+                               "[DB] Profile update failed with id: {}.",
+                               iProfileId);
+    }
+    return false;
+  }
+  LOG_STRUCTURED_THROTTLED(LogLevel::INFO, kOperationLogPolicy,
+                           "[DB] Profile updated with id: {}.", iProfileId);
+  return true;
+}
+
+ProfileSnapshot InMemoryDatabase::snapshot() {
+  std::lock_guard aLock{_snapshotsMutex};
+  // Registered before the version is read: a writer either sees the snapshot
+  // and keeps what it replaces, or took its version before this one.
+  _snapshotCount.fetch_add(1);
+  const std::uint64_t aVersion{_version.load()};
+  _snapshotVersions.insert(aVersion);
+  return ProfileSnapshot{*this, aVersion};
+}
+
+std::expected<void, std::string>
+InMemoryDatabase::transfer(const Transfer& iTransfer) {
+  return transferMany(std::span<const Transfer>{&iTransfer, 1});
+}
+
+std::expected<void, std::string>
+InMemoryDatabase::transferMany(std::span<const Transfer> iTransfers) {
+  const MetricsTimer aTimer{sTransferDuration};
+  std::array<bool, kShardCount> aIsInvolved{};
+  for (const Transfer& aTransfer : iTransfers) {
+    aIsInvolved[aTransfer.from % kShardCount] = true;
+    aIsInvolved[aTransfer.to % kShardCount] = true;
+  }
+
+  const auto aResult{[&]() -> std::expected<void, std::string> {
+    std::array<std::unique_lock<std::shared_mutex>, kShardCount> aLocks{};
+    for (std::size_t aShard{}; aShard < kShardCount; ++aShard) {
+      if (aIsInvolved[aShard]) {
+        aLocks[aShard] = std::unique_lock{_shards[aShard].mutex};
+      }
+    }
+
+    // Work on copies of the deposits so that a rejected transfer leaves every
+    // profile of the batch untouched.
+    std::unordered_map<ProfileId, std::pair<StoredProfile*, std::int64_t>>
+        aDeposits{};
+    aDeposits.reserve(std::min<std::size_t>(iTransfers.size() * 2, 1024));
+    const auto aGetDeposit{[&](const ProfileId iProfileId) -> std::int64_t* {
+      auto [aEntry, aIsNew]{aDeposits.try_emplace(iProfileId)};
+      if (aIsNew) {
+        StoredProfile* aStored{getShard(iProfileId).profiles.find(iProfileId)};
+        if (!aStored) {
+          aDeposits.erase(aEntry);
+          return nullptr;
+        }
+        aEntry->second = {aStored, aStored->profile._deposit};
+      }
+      return &aEntry->second.second;
+    }};
+
+    const auto aPrefix{[](const std::size_t iIndex) {
+      return "Transfer " + std::to_string(iIndex) + ": ";
+    }};
+    for (std::size_t aIndex{}; aIndex < iTransfers.size(); ++aIndex) {
+      const Transfer& aTransfer{iTransfers[aIndex]};
+      std::int64_t* aFrom{aGetDeposit(aTransfer.from)};
+      std::int64_t* aTo{aGetDeposit(aTransfer.to)};
+      if (!aFrom || !aTo) {
+        return std::unexpected{aPrefix(aIndex) + "unknown profile id " +
+                               std::to_string(aFrom ? aTransfer.to
+                                                    : aTransfer.from) +
+                               "."};
+      }
+      if (*aFrom < 0 ||
+          aTransfer.amount > static_cast<std::uint64_t>(*aFrom)) {
+        return std::unexpected{aPrefix(aIndex) + "profile " +
+                               std::to_string(aTransfer.from) +
+                               " cannot afford " +
+                               std::to_string(aTransfer.amount) + " satoshi."};
+      }
+      const auto aAmount{static_cast<std::int64_t>(aTransfer.amount)};
+      if (*aTo > std::numeric_limits<std::int64_t>::max() - aAmount) {
+        return std::unexpected{aPrefix(aIndex) + "deposit of profile " +
+                               std::to_string(aTransfer.to) + " overflows."};
+      }
+      *aFrom -= aAmount;
+      *aTo += aAmount;
+    }
+
+    const auto aSwapDeposits{[&aDeposits] {
+      for (auto& [aProfileId, aDeposit] : aDeposits) {
+        std::swap(aDeposit.first->profile._deposit, aDeposit.second);
+      }
+    }};
+    if (_journal) {
+      // Journal the profiles with their new deposit, then put the previous
+      // deposits back until the batch is applied.
+      Journal::Batch aBatch{};
+      aSwapDeposits();
+      for (const auto& [aProfileId, aDeposit] : aDeposits) {
+        aBatch.put(aProfileId, aDeposit.first->profile);
+      }
+      aSwapDeposits();
+      if (!Persist(*_journal, aBatch)) {
+        return std::unexpected{
+            std::string{"Transfers could not be journaled."}};
+      }
+    }
+
+    const std::uint64_t aVersion{nextVersion()};
+    for (const auto& [aProfileId, aDeposit] : aDeposits) {
+      preserve(getShard(aProfileId), aProfileId, *aDeposit.first, aVersion);
+    }
+    aSwapDeposits();
+    for (const auto& [aProfileId, aDeposit] : aDeposits) {
+      aDeposit.first->version = aVersion;
+    }
+    return {};
+  }()};
+  checkpointIfDue();
+
+  if (!aResult) {
+    LOG_STRUCTURED_THROTTLED(LogLevel::WARNING, kOperationLogPolicy,
+                             "[DB] Transfers rejected. {}", aResult.error());
+    return aResult;
+  }
+  LOG_STRUCTURED_THROTTLED(LogLevel::INFO, kOperationLogPolicy,
+                           "[DB] {} transfer(s) applied.", iTransfers.size());
+  return {};
+}
+
+// Private API
+
+bool InMemoryDatabase::persistPut(const ProfileId iProfileId,
+                                  const Profile& iProfile) {
+  // Reused by the thread, so that single changes do not allocate.
+  static thread_local Journal::Batch sBatch{};
+  sBatch.clear();
+  sBatch.put(iProfileId, iProfile);
+  return Persist(*_journal, sBatch);
+}
+
+bool InMemoryDatabase::persistRemove(const ProfileId iProfileId) {
+  static thread_local Journal::Batch sBatch{};
+  sBatch.clear();
+  sBatch.remove(iProfileId);
+  return Persist(*_journal, sBatch);
+}
+
+void InMemoryDatabase::preserve(Shard& ioShard, const ProfileId iProfileId,
+                                const StoredProfile& iStored,
+                                const std::uint64_t iVersion) {
+  if (_snapshotCount.load()) {
+    ioShard.previousVersions[iProfileId].push_back(
+        PreviousVersion{iStored.version, iVersion, iStored.profile});
+    if (iVersion <
+        ioShard.oldestSupersededVersion.load(std::memory_order_relaxed)) {
+      ioShard.oldestSupersededVersion.store(iVersion,
+                                            std::memory_order_relaxed);
+    }
+  }
+}
+
+const Profile*
+InMemoryDatabase::findVersion(const Shard& iShard, const ProfileId iProfileId,
+                              const std::uint64_t iVersion) const {
+  if (const StoredProfile* aStored{iShard.profiles.find(iProfileId)};
+      aStored && aStored->version <= iVersion) {
+    return &aStored->profile;
+  }
+  const auto aPreviousVersions{iShard.previousVersions.find(iProfileId)};
+  if (aPreviousVersions == iShard.previousVersions.end()) {
+    return nullptr;
+  }
+  for (const PreviousVersion& aPrevious : aPreviousVersions->second) {
+    if (aPrevious.version <= iVersion &&
+        iVersion < aPrevious.supersededVersion) {
+      return &aPrevious.profile;
+    }
+  }
+  return nullptr;
+}
+
+void InMemoryDatabase::releaseSnapshot(const std::uint64_t iVersion) {
+  std::uint64_t aOldestVersion{std::numeric_limits<std::uint64_t>::max()};
+  {
+    std::lock_guard aLock{_snapshotsMutex};
+    _snapshotVersions.erase(_snapshotVersions.find(iVersion));
+    _snapshotCount.fetch_sub(1);
+    if (!_snapshotVersions.empty()) {
+      aOldestVersion = *_snapshotVersions.begin();
+    }
+  }
+
+  // Versions superseded at or before the oldest snapshot are not read by any
+  // snapshot, nor by the ones taken later.
+  for (Shard& aShard : _shards) {
+    if (aShard.oldestSupersededVersion.load(std::memory_order_relaxed) >
+        aOldestVersion) {
+      continue;
+    }
+    std::unique_lock aLock{aShard.mutex};
+    std::uint64_t aOldestSupersededVersion{
+        std::numeric_limits<std::uint64_t>::max()};
+    for (auto aEntry{aShard.previousVersions.begin()};
+         aEntry != aShard.previousVersions.end();) {
+      std::vector<PreviousVersion>& aPreviousVersions{aEntry->second};
+      std::erase_if(aPreviousVersions,
+                    [aOldestVersion](const PreviousVersion& iPrevious) {
+                      return iPrevious.supersededVersion <= aOldestVersion;
+                    });
+      if (aPreviousVersions.empty()) {
+        aEntry = aShard.previousVersions.erase(aEntry);
+        continue;
+      }
+      // Versions of a profile are kept aside oldest first.
+      aOldestSupersededVersion =
+          std::min(aOldestSupersededVersion,
+                   aPreviousVersions.front().supersededVersion);
+      ++aEntry;
+    }
+    aShard.oldestSupersededVersion.store(aOldestSupersededVersion,
+                                         std::memory_order_relaxed);
+  }
+}
+
+void InMemoryDatabase::checkpointIfDue() {
+  if (!_journal || !_journal->isSnapshotDue()) {
+    return;
+  }
+  if (const auto aCheckpoint{checkpoint()}; !aCheckpoint) {
+    sLog.toFile(LogLevel::ERROR,
+                "[DB] Checkpoint failed. " + aCheckpoint.error(),
                 __PRETTY_FUNCTION__);
-    return true;
   }
+}
 
-  sLog.toFile(
-      LogLevel::WARNING,
-      "[DB] Profile update failed with id: " + std::to_string(_profileId) + ".",
-      __PRETTY_FUNCTION__);
-  return false;
+void InMemoryDatabase::logMissingRetrieval(const ProfileId iProfileId) const {
+  LOG_STRUCTURED_THROTTLED(LogLevel::WARNING, kOperationLogPolicy,
+                           "[DB] Profile retrieval failed with id: {}.",
+                           iProfileId);
+}
+
+void InMemoryDatabase::logMissingUpdate(const ProfileId iProfileId) const {
+  LOG_STRUCTURED_THROTTLED(LogLevel::WARNING, kOperationLogPolicy,
+                           "[DB] Profile update failed with id: {}.",
+                           iProfileId);
+}
+
+/* === ProfileSnapshot Class === */
+
+ProfileSnapshot::ProfileSnapshot(InMemoryDatabase& database,
+                                 const std::uint64_t version)
+    : _database{&database},
+      _version{version} {}
+
+ProfileSnapshot::ProfileSnapshot(ProfileSnapshot&& other) noexcept
+    : _database{std::exchange(other._database, nullptr)},
+      _version{other._version} {}
+
+ProfileSnapshot::~ProfileSnapshot() {
+  if (_database) {
+    _database->releaseSnapshot(_version);
+  }
+}
+
+// Public API
+
+std::uint64_t ProfileSnapshot::getVersion() const { return _version; }
+
+std::optional<Profile> ProfileSnapshot::get(const ProfileId iProfileId) const {
+  const InMemoryDatabase::Shard& aShard{_database->getShard(iProfileId)};
+  std::shared_lock aLock{aShard.mutex};
+  if (const Profile* aProfile{
+          _database->findVersion(aShard, iProfileId, _version)}) {
+    return *aProfile;
+  }
+  return std::nullopt;
+}
+
+void ProfileSnapshot::forEach(
+    const std::function<void(ProfileId, const Profile&)>& iVisitor) const {
+  std::vector<std::pair<ProfileId, Profile>> aProfiles{};
+  for (const InMemoryDatabase::Shard& aShard : _database->_shards) {
+    aProfiles.clear();
+    {
+      std::shared_lock aLock{aShard.mutex};
+      aProfiles.reserve(aShard.profiles.size());
+      // A profile is either stored as it was at the snapshot version, or
+      // kept aside by the change that superseded it, never both.
+      aShard.profiles.forEach(
+          [&](const ProfileId iProfileId, const StoredProfile& iStored) {
+            if (iStored.version <= _version) {
+              aProfiles.emplace_back(iProfileId, iStored.profile);
+            }
+          });
+      for (const auto& [aProfileId, aPreviousVersions] :
+           aShard.previousVersions) {
+        for (const auto& aPrevious : aPreviousVersions) {
+          if (aPrevious.version <= _version &&
+              _version < aPrevious.supersededVersion) {
+            aProfiles.emplace_back(aProfileId, aPrevious.profile);
+          }
+        }
+      }
+    }
+    for (const auto& [aProfileId, aProfile] : aProfiles) {
+      iVisitor(aProfileId, aProfile);
+    }
+  }
 }
 } // namespace user
\ No newline at end of file
@@ -0,0 +1,152 @@
+// author: georgiosmatzarapis
+
+#include <filesystem>
+#include <fstream>
+
+#include <gtest/gtest.h>
+
+#include "BlockStore.hpp"
+#include "TestHelpers.hpp"
+
+namespace storage {
+namespace tests {
+
+class BlockStoreTest : public test_helpers::TemporaryDirectoryTest {
+ protected:
+  BlockStoreOptions _options{4096, 1};
+};
+
+TEST_F(BlockStoreTest, ShouldReadBackAppendedRecords) {
+  BlockStore sStore{_directory, _options};
+  ASSERT_EQ(sStore.append("first").value(), 0);
+  ASSERT_EQ(sStore.append("second").value(), 1);
+  EXPECT_EQ(sStore.size(), 2);
+  EXPECT_EQ(sStore.read(0).value(), "first");
+  EXPECT_EQ(sStore.read(1).value(), "second");
+}
+
+TEST_F(BlockStoreTest, ShouldReturnErrorWhenRecordIdIsOutOfRange) {
+  BlockStore sStore{_directory, _options};
+  ASSERT_FALSE(sStore.read(0).has_value());
+}
+
+TEST_F(BlockStoreTest, ShouldRejectRecordLargerThanSegment) {
+  BlockStore sStore{_directory, _options};
+  ASSERT_FALSE(sStore.append(std::string(_options.segmentSize, 'x')));
+  EXPECT_EQ(sStore.size(), 0);
+}
+
+TEST_F(BlockStoreTest, ShouldRollOverToNewSegmentWhenSegmentIsFull) {
+  BlockStore sStore{_directory, _options};
+  const std::string sRecord(1500, 'r');
+  for (int sIndex{}; sIndex < 5; ++sIndex) {
+    ASSERT_TRUE(sStore.append(sRecord));
+  }
+  EXPECT_TRUE(std::filesystem::exists(_directory / "blk00001.dat"));
+  EXPECT_TRUE(std::filesystem::exists(_directory / "blk00002.dat"));
+  EXPECT_EQ(sStore.read(4).value(), sRecord);
+}
+
+TEST_F(BlockStoreTest, ShouldKeepRecordsWhenReopened) {
+  {
+    BlockStore sStore{_directory, BlockStoreOptions{4096, 16}};
+    sStore.append("first");
+    sStore.append("second");
+  }
+  BlockStore sStore{_directory, _options};
+  ASSERT_EQ(sStore.size(), 2);
+  EXPECT_EQ(sStore.read(1).value(), "second");
+}
+
+TEST_F(BlockStoreTest, ShouldTruncateTornTailWhenReopened) {
+  {
+    BlockStore sStore{_directory, _options};
+    sStore.append("first");
+    sStore.append("second");
+  }
+  // Simulate a crash in the middle of the last record write.
+  const std::filesystem::path sSegment{_directory / "blk00000.dat"};
+  std::filesystem::resize_file(sSegment,
+                               std::filesystem::file_size(sSegment) - 3);
+
+  BlockStore sStore{_directory, _options};
+  ASSERT_EQ(sStore.size(), 1);
+  EXPECT_EQ(sStore.read(0).value(), "first");
+  ASSERT_EQ(sStore.append("third").value(), 1);
+  EXPECT_EQ(sStore.read(1).value(), "third");
+}
+
+TEST_F(BlockStoreTest, ShouldRebuildIndexFromSegmentsWhenIndexIsBehind) {
+  {
+    BlockStore sStore{_directory, _options};
+    sStore.append("first");
+    sStore.append("second");
+  }
+  // Simulate a crash after the record write but before the index write.
+  std::filesystem::resize_file(_directory / "index.dat", 24 + 7);
+
+  BlockStore sStore{_directory, _options};
+  ASSERT_EQ(sStore.size(), 2);
+  EXPECT_EQ(sStore.read(1).value(), "second");
+  EXPECT_EQ(std::filesystem::file_size(_directory / "index.dat"), 48);
+}
+
+TEST_F(BlockStoreTest, ShouldDropRecordWithChecksumMismatch) {
+  {
+    BlockStore sStore{_directory, _options};
+    sStore.append("first");
+    sStore.append("second");
+  }
+  std::fstream sSegment{_directory / "blk00000.dat",
+                        std::ios::in | std::ios::out | std::ios::binary};
+  sSegment.seekp(-1, std::ios::end);
+  sSegment.put('X');
+  sSegment.close();
+
+  BlockStore sStore{_directory, _options};
+  ASSERT_EQ(sStore.size(), 1);
+  EXPECT_EQ(sStore.read(0).value(), "first");
+}
+
+TEST_F(BlockStoreTest, ShouldDropTruncatedRecordsAcrossSegments) {
+  {
+    BlockStore sStore{_directory, _options};
+    const std::string sRecord(1500, 'r');
+    for (int sIndex{}; sIndex < 5; ++sIndex) {
+      ASSERT_TRUE(sStore.append(sRecord));
+    }
+    ASSERT_TRUE(sStore.truncate(1));
+    EXPECT_EQ(sStore.size(), 1);
+    EXPECT_FALSE(std::filesystem::exists(_directory / "blk00001.dat"));
+    ASSERT_EQ(sStore.append("replacement").value(), 1);
+  }
+  BlockStore sStore{_directory, _options};
+  ASSERT_EQ(sStore.size(), 2);
+  EXPECT_EQ(sStore.read(1).value(), "replacement");
+}
+
+TEST_F(BlockStoreTest, ShouldPruneOldestSegments) {
+  const std::string sRecord(1500, 'r');
+  {
+    BlockStore sStore{_directory, _options};
+    for (int sIndex{}; sIndex < 5; ++sIndex) {
+      ASSERT_TRUE(sStore.append(sRecord));
+    }
+    EXPECT_EQ(sStore.findTail(3000), 3);
+    ASSERT_EQ(sStore.prune(3).value(), 2);
+    EXPECT_FALSE(std::filesystem::exists(_directory / "blk00000.dat"));
+    EXPECT_FALSE(sStore.read(1).has_value());
+    EXPECT_EQ(sStore.read(2).value(), sRecord);
+  }
+  BlockStore sStore{_directory, _options};
+  ASSERT_EQ(sStore.size(), 5);
+  EXPECT_EQ(sStore.getFirstRecord(), 2);
+  EXPECT_FALSE(sStore.read(0).has_value());
+  EXPECT_EQ(sStore.read(4).value(), sRecord);
+  EXPECT_FALSE(sStore.truncate(1));
+  ASSERT_TRUE(sStore.truncate(2));
+  ASSERT_EQ(sStore.append("replacement").value(), 2);
+  EXPECT_EQ(sStore.read(2).value(), "replacement");
+}
+} // namespace tests
+} // namespace storage
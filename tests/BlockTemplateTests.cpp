@@ -0,0 +1,78 @@
+// author: georgiosmatzarapis
+
+#include <filesystem>
+
+#include <gtest/gtest.h>
+
+#include "BlockTemplate.hpp"
+#include "TestHelpers.hpp"
+
+namespace mempool {
+namespace tests {
+
+using namespace transaction;
+
+class BlockTemplateTest : public test_helpers::TemporaryDirectoryTest {
+ protected:
+  std::unique_ptr<chain::Chain> _chain{};
+  Mempool _mempool{};
+
+  void SetUp() override {
+    _chain = std::make_unique<chain::Chain>(_directory);
+
+    std::vector<std::unique_ptr<Coinbase>> sCoinbases{};
+    sCoinbases.push_back(std::make_unique<Coinbase>("Alice", 10));
+    ASSERT_TRUE(
+        _chain->append(block::Block{"genesis", 0, std::move(sCoinbases)}));
+  }
+
+  static std::vector<std::string> Receivers(const block::Block& iBlock) {
+    std::vector<std::string> sReceivers{};
+    for (const auto& sPayload : iBlock.getPayloads().value()) {
+      sReceivers.push_back(sPayload->getReceiver());
+    }
+    return sReceivers;
+  }
+};
+
+TEST_F(BlockTemplateTest, ShouldSelectHighestFeeRatesWithinCountBudget) {
+  _mempool.submit(Payload{"Alice", "Bob", 1}, 10);
+  _mempool.submit(Payload{"Alice", "Carol", 1}, 300);
+  _mempool.submit(Payload{"Alice", "Dave", 1}, 200);
+  _mempool.process();
+
+  const BlockTemplate sTemplate{BuildBlockTemplate(
+      _mempool, *_chain, "Miner", TemplateOptions{.maxPayloads = 2})};
+  EXPECT_EQ(Receivers(sTemplate.block),
+            (std::vector<std::string>{"Bob", "Carol"}));
+  EXPECT_EQ(sTemplate.fees, 310);
+  EXPECT_EQ(sTemplate.block.getCoinbases().value()[0]->getOwner(), "Miner");
+}
+
+TEST_F(BlockTemplateTest, ShouldRespectOwnerOrderAndBalances) {
+  _mempool.submit(Payload{"Alice", "Bob", 6}, 1);
+  _mempool.submit(Payload{"Bob", "Carol", 3}, 100);
+  _mempool.submit(Payload{"Alice", "Dave", 6}, 50);
+  _mempool.process();
+
+  const BlockTemplate sTemplate{BuildBlockTemplate(_mempool, *_chain, "Miner")};
+  EXPECT_EQ(Receivers(sTemplate.block),
+            (std::vector<std::string>{"Bob", "Carol"}));
+  ASSERT_TRUE(_chain->append(sTemplate.block));
+  EXPECT_EQ(_chain->getLedger().getBalance("Carol"), 300000000);
+}
+
+TEST_F(BlockTemplateTest, ShouldStopOwnerAtFirstPayloadOverByteBudget) {
+  _mempool.submit(Payload{"Alice", "Bob", 1}, 100);
+  _mempool.submit(Payload{"Alice", "Ben", 2}, 100);
+  _mempool.process();
+  const std::size_t sPayloadSize{_mempool.getBytes() / 2};
+
+  const BlockTemplate sTemplate{BuildBlockTemplate(
+      _mempool, *_chain, "Miner",
+      TemplateOptions{.maxBytes = sPayloadSize + sPayloadSize / 2})};
+  EXPECT_EQ(sTemplate.block.getPayloads().value().size(), 1);
+  EXPECT_EQ(sTemplate.bytes, sPayloadSize);
+}
+} // namespace tests
+} // namespace mempool
@@ -4,6 +4,8 @@
 
 #include "Block.hpp"
 #include "Common.hpp"
+#include "Metrics.hpp"
+#include "Tracing.hpp"
 
 namespace block {
 namespace tests {
@@ -97,6 +99,55 @@ TEST(BlockInitializationTest, ShouldStoreAllValidTransactions) {
   ASSERT_EQ(sBlockPayloads[2]->getBitcoinAmount(), 3);
 }
 
+TEST(BlockInitializationTest, ShouldRecordStageMetricsWhenEnabled) {
+  MetricsRegistry& sMetrics{MetricsRegistry::GetInstance()};
+  std::vector<std::unique_ptr<Coinbase>> sUnrecordedCoinbases{};
+  sUnrecordedCoinbases.push_back(
+      std::make_unique<Coinbase>(std::string{"Owner"}, 1));
+  const Block sUnrecordedBlock{"previousHash", 1,
+                               std::move(sUnrecordedCoinbases)};
+
+  sMetrics.setEnabled(true);
+  std::vector<std::unique_ptr<Coinbase>> sCoinbases{};
+  sCoinbases.push_back(std::make_unique<Coinbase>(std::string{"Owner"}, 1));
+  const Block sBlock{"previousHash", 1, std::move(sCoinbases)};
+  sMetrics.setEnabled(false);
+
+  const std::string sText{sMetrics.toPrometheus()};
+  for (const std::string sStage :
+       {"initialize", "validate_and_store_transactions",
+        "group_transaction_hashes", "calculate_merkle_root_hash",
+        "calculate_block_hash"}) {
+    EXPECT_NE(sText.find("blockchain_block_stage_seconds_count{stage=\"" +
+                         sStage + "\"} 1\n"),
+              std::string::npos)
+        << sStage;
+  }
+  EXPECT_NE(sText.find("blockchain_mining_attempts_count 1\n"),
+            std::string::npos);
+}
+
+TEST(BlockInitializationTest, ShouldTraceConstructionStagesWhenEnabled) {
+  Tracer& sTracer{Tracer::GetInstance()};
+  sTracer.setEnabled(true);
+  std::vector<std::unique_ptr<Payload>> sPayloads{};
+  sPayloads.push_back(
+      std::make_unique<Payload>(std::string{"Owner"}, "Receiver", 1));
+  const Block sBlock{"previousHash", 1, std::move(sPayloads)};
+  sTracer.setEnabled(false);
+
+  const std::string sJson{sTracer.toJson()};
+  EXPECT_NE(sJson.find("\"Block::initialize\",\"ph\":\"X\""),
+            std::string::npos);
+  for (const std::string sStage :
+       {"validateAndStoreTransactions", "groupTransactionHashes",
+        "calculateMerkleRootHash", "calculateBlockHash"}) {
+    const std::size_t sEvent{sJson.find("\"Block::" + sStage + "\"")};
+    ASSERT_NE(sEvent, std::string::npos) << sStage;
+    EXPECT_NE(sJson.find("\"depth\":1}", sEvent), std::string::npos);
+  }
+}
+
 TEST(BlockInitializationTest, ShouldThrowWhenNoValidTransactionHashFound) {
   std::vector<std::unique_ptr<Coinbase>> sCoinbases{};
   sCoinbases.push_back(std::make_unique<Coinbase>("owner", 1));
@@ -0,0 +1,226 @@
+// author: georgiosmatzarapis
+
+#include <filesystem>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include "Chain.hpp"
+#include "TestHelpers.hpp"
+
+namespace chain {
+namespace tests {
+
+using namespace transaction;
+using test_helpers::MakeBlock;
+
+using ChainTest = test_helpers::TemporaryDirectoryTest;
+
+TEST_F(ChainTest, ShouldAppendLinkedBlocks) {
+  Chain sChain{_directory};
+  const block::Block sGenesis{MakeBlock("genesis", 0)};
+  ASSERT_TRUE(sChain.append(sGenesis));
+  const block::Block sNext{MakeBlock(sGenesis.getHash(), 1)};
+  ASSERT_TRUE(sChain.append(sNext));
+  EXPECT_EQ(sChain.getLength(), 2);
+  EXPECT_EQ(sChain.getTipHash(), sNext.getHash());
+  EXPECT_EQ(sChain.getBlock(1).value().getHash(), sNext.getHash());
+}
+
+TEST_F(ChainTest, ShouldRejectBlockWithUnexpectedIndex) {
+  Chain sChain{_directory};
+  ASSERT_FALSE(sChain.append(MakeBlock("genesis", 1)));
+  EXPECT_EQ(sChain.getLength(), 0);
+}
+
+TEST_F(ChainTest, ShouldRejectBlockNotLinkedToTip) {
+  Chain sChain{_directory};
+  ASSERT_TRUE(sChain.append(MakeBlock("genesis", 0)));
+  ASSERT_FALSE(sChain.append(MakeBlock("unknownHash", 1)));
+  EXPECT_EQ(sChain.getLength(), 1);
+}
+
+TEST_F(ChainTest, ShouldRejectBlockThatOverspends) {
+  Chain sChain{_directory};
+  const block::Block sGenesis{MakeBlock("genesis", 0)};
+  ASSERT_TRUE(sChain.append(sGenesis));
+
+  std::vector<std::unique_ptr<Payload>> sPayloads{};
+  sPayloads.push_back(std::make_unique<Payload>("Miner", "Receiver", 7));
+  ASSERT_FALSE(sChain.append(
+      block::Block{sGenesis.getHash(), 1, std::move(sPayloads)}));
+  EXPECT_EQ(sChain.getLength(), 1);
+  EXPECT_EQ(sChain.getLedger().getBalance("Miner"), 625000000);
+}
+
+TEST_F(ChainTest, ShouldRestoreTipWhenReopened) {
+  std::string sTipHash{};
+  {
+    Chain sChain{_directory};
+    const block::Block sGenesis{MakeBlock("genesis", 0)};
+    sChain.append(sGenesis);
+    sTipHash = sGenesis.getHash();
+  }
+  Chain sChain{_directory};
+  EXPECT_EQ(sChain.getLength(), 1);
+  EXPECT_EQ(sChain.getTipHash(), sTipHash);
+  EXPECT_EQ(sChain.getLedger().getBalance("Miner"), 625000000);
+  ASSERT_TRUE(sChain.append(MakeBlock(sTipHash, 1)));
+}
+
+TEST_F(ChainTest, ShouldRestoreLedgerFromSnapshotWhenReopened) {
+  const ChainOptions sOptions{.snapshotInterval = 2};
+  std::string sTipHash{"genesis"};
+  {
+    Chain sChain{_directory, sOptions};
+    for (std::uint32_t sIndex{}; sIndex < 3; ++sIndex) {
+      const block::Block sBlock{MakeBlock(sTipHash, sIndex)};
+      ASSERT_TRUE(sChain.append(sBlock));
+      sTipHash = sBlock.getHash();
+    }
+  }
+  ASSERT_TRUE(
+      std::filesystem::exists(_directory / "snapshot-0000000002.bin"));
+  Chain sChain{_directory, sOptions};
+  EXPECT_EQ(sChain.getLength(), 3);
+  EXPECT_EQ(sChain.getTipHash(), sTipHash);
+  EXPECT_EQ(sChain.getLedger().getBalance("Miner"), 3 * 625000000ULL);
+}
+class ObserverMock : public IObserver {
+ public:
+  MOCK_METHOD(void, onBlockConnected, (const block::Block& iBlock), (override));
+  MOCK_METHOD(void, onBlockDisconnected, (const block::Block& iBlock),
+              (override));
+};
+
+TEST_F(ChainTest, ShouldKeepSideBranchWithoutMoreWork) {
+  Chain sChain{_directory};
+  const block::Block sGenesis{MakeBlock("genesis", 0)};
+  const block::Block sActive{MakeBlock(sGenesis.getHash(), 1)};
+  ASSERT_TRUE(sChain.append(sGenesis));
+  ASSERT_TRUE(sChain.append(sActive));
+
+  ASSERT_TRUE(sChain.append(MakeBlock(sGenesis.getHash(), 1, "Other")));
+  EXPECT_EQ(sChain.getTipHash(), sActive.getHash());
+  EXPECT_EQ(sChain.getLedger().getBalance("Other"), 0);
+}
+
+TEST_F(ChainTest, ShouldReorganiseOntoBranchWithMoreWork) {
+  Chain sChain{_directory};
+  ::testing::StrictMock<ObserverMock> sObserver{};
+  const block::Block sGenesis{MakeBlock("genesis", 0)};
+  const block::Block sActive{MakeBlock(sGenesis.getHash(), 1)};
+  ASSERT_TRUE(sChain.append(sGenesis));
+  ASSERT_TRUE(sChain.append(sActive));
+  sChain.addObserver(sObserver);
+
+  const block::Block sSide{MakeBlock(sGenesis.getHash(), 1, "Other")};
+  const block::Block sSideTip{MakeBlock(sSide.getHash(), 2, "Other")};
+  ASSERT_TRUE(sChain.append(sSide));
+  {
+    ::testing::InSequence sSequence{};
+    EXPECT_CALL(sObserver, onBlockDisconnected(::testing::Property(
+                               &block::Block::getHash, sActive.getHash())));
+    EXPECT_CALL(sObserver, onBlockConnected(::testing::Property(
+                               &block::Block::getHash, sSide.getHash())));
+    EXPECT_CALL(sObserver, onBlockConnected(::testing::Property(
+                               &block::Block::getHash, sSideTip.getHash())));
+  }
+  ASSERT_TRUE(sChain.append(sSideTip));
+  EXPECT_EQ(sChain.getLength(), 3);
+  EXPECT_EQ(sChain.getTipHash(), sSideTip.getHash());
+  EXPECT_EQ(sChain.getBlock(1).value().getHash(), sSide.getHash());
+  EXPECT_EQ(sChain.getLedger().getBalance("Miner"), 625000000);
+  EXPECT_EQ(sChain.getLedger().getBalance("Other"), 2 * 625000000ULL);
+  sChain.removeObserver(sObserver);
+
+  // The replaced block is kept aside and can win back.
+  const block::Block sActiveNext{MakeBlock(sActive.getHash(), 2)};
+  ASSERT_TRUE(sChain.append(sActiveNext));
+  ASSERT_TRUE(sChain.append(MakeBlock(sActiveNext.getHash(), 3)));
+  EXPECT_EQ(sChain.getBlock(1).value().getHash(), sActive.getHash());
+  EXPECT_EQ(sChain.getLedger().getBalance("Other"), 0);
+}
+
+TEST_F(ChainTest, ShouldKeepActiveChainWhenBranchIsInvalid) {
+  Chain sChain{_directory};
+  const block::Block sGenesis{MakeBlock("genesis", 0)};
+  const block::Block sActive{MakeBlock(sGenesis.getHash(), 1)};
+  ASSERT_TRUE(sChain.append(sGenesis));
+  ASSERT_TRUE(sChain.append(sActive));
+
+  std::vector<std::unique_ptr<Payload>> sPayloads{};
+  sPayloads.push_back(std::make_unique<Payload>("Nobody", "Receiver", 1));
+  const block::Block sSide{MakeBlock(sGenesis.getHash(), 1, "Other")};
+  const block::Block sInvalid{sSide.getHash(), 2, std::move(sPayloads)};
+  ASSERT_TRUE(sChain.append(sSide));
+  ASSERT_FALSE(sChain.append(sInvalid));
+  EXPECT_EQ(sChain.getTipHash(), sActive.getHash());
+  EXPECT_EQ(sChain.getLedger().getBalance("Miner"), 2 * 625000000ULL);
+  EXPECT_EQ(sChain.getLedger().getBalance("Other"), 0);
+}
+
+TEST_F(ChainTest, ShouldReopenOnReorganisedBranch) {
+  std::string sTipHash{};
+  {
+    Chain sChain{_directory};
+    const block::Block sGenesis{MakeBlock("genesis", 0)};
+    ASSERT_TRUE(sChain.append(sGenesis));
+    ASSERT_TRUE(sChain.append(MakeBlock(sGenesis.getHash(), 1)));
+    const block::Block sSide{MakeBlock(sGenesis.getHash(), 1, "Other")};
+    const block::Block sSideTip{MakeBlock(sSide.getHash(), 2, "Other")};
+    ASSERT_TRUE(sChain.append(sSide));
+    ASSERT_TRUE(sChain.append(sSideTip));
+    sTipHash = sSideTip.getHash();
+  }
+  Chain sChain{_directory};
+  EXPECT_EQ(sChain.getLength(), 3);
+  EXPECT_EQ(sChain.getTipHash(), sTipHash);
+  EXPECT_EQ(sChain.getLedger().getBalance("Other"), 2 * 625000000ULL);
+}
+
+TEST_F(ChainTest, ShouldPruneBodiesOfOldBlocks) {
+  ChainOptions sOptions{.store = {512, 1},
+                        .snapshotInterval = 2,
+                        .maxReorgDepth = 1};
+  sOptions.pruning.keepBlocks = 1;
+  std::string sTipHash{"genesis"};
+  {
+    Chain sChain{_directory, sOptions};
+    for (std::uint32_t sIndex{}; sIndex < 8; ++sIndex) {
+      const block::Block sBlock{MakeBlock(sTipHash, sIndex)};
+      ASSERT_TRUE(sChain.append(sBlock));
+      sTipHash = sBlock.getHash();
+    }
+    ASSERT_GT(sChain.getFirstBlockHeight(), 0);
+    EXPECT_FALSE(std::filesystem::exists(_directory / "blk00000.dat"));
+    EXPECT_FALSE(sChain.getBlock(0).has_value());
+    EXPECT_EQ(sChain.getHeader(0).value().index, 0);
+    EXPECT_TRUE(sChain.getBlock(7).has_value());
+  }
+  Chain sChain{_directory, sOptions};
+  EXPECT_EQ(sChain.getLength(), 8);
+  EXPECT_EQ(sChain.getTipHash(), sTipHash);
+  EXPECT_EQ(sChain.getHeader(1).value().previousHash,
+            sChain.getHeader(0).value().hash);
+  EXPECT_EQ(sChain.getLedger().getBalance("Miner"), 8 * 625000000ULL);
+  ASSERT_TRUE(sChain.append(MakeBlock(sTipHash, 8)));
+}
+
+TEST_F(ChainTest, ShouldRebuildMissingHeadersFromBlocks) {
+  std::string sTipHash{};
+  {
+    Chain sChain{_directory};
+    const block::Block sGenesis{MakeBlock("genesis", 0)};
+    ASSERT_TRUE(sChain.append(sGenesis));
+    ASSERT_TRUE(sChain.append(MakeBlock(sGenesis.getHash(), 1)));
+    sTipHash = sChain.getTipHash().value();
+  }
+  std::filesystem::remove_all(_directory / "headers");
+  Chain sChain{_directory};
+  EXPECT_EQ(sChain.getLength(), 2);
+  EXPECT_EQ(sChain.getTipHash(), sTipHash);
+  EXPECT_EQ(sChain.getHeader(1).value().hash, sTipHash);
+}
+} // namespace tests
+} // namespace chain
@@ -0,0 +1,94 @@
+// author: georgiosmatzarapis
+
+#include <filesystem>
+
+#include <gtest/gtest.h>
+
+#include "ChainVerifier.hpp"
+#include "TestHelpers.hpp"
+
+namespace chain {
+namespace tests {
+
+using namespace transaction;
+
+class ChainVerifierTest : public test_helpers::TemporaryDirectoryTest {
+ protected:
+  static void AppendBlocks(Chain& ioChain, const std::uint32_t iCount) {
+    for (std::uint32_t aIndex{}; aIndex < iCount; ++aIndex) {
+      std::vector<std::unique_ptr<Coinbase>> aCoinbases{};
+      aCoinbases.push_back(std::make_unique<Coinbase>("Miner", 6.25));
+      std::vector<std::unique_ptr<Payload>> aPayloads{};
+      aPayloads.push_back(std::make_unique<Payload>("Miner", "Receiver", 1));
+      const block::Block aBlock{ioChain.getTipHash().value_or("genesis"),
+                                ioChain.getLength(), std::move(aCoinbases),
+                                std::move(aPayloads)};
+      ASSERT_TRUE(ioChain.append(aBlock));
+    }
+  }
+};
+
+TEST_F(ChainVerifierTest, ShouldAcceptValidChain) {
+  Chain sChain{_directory};
+  AppendBlocks(sChain, 100);
+
+  std::uint32_t sReportedBlocks{};
+  const VerificationReport sReport{
+      ChainVerifier{sChain, 4}.run([&](const VerificationProgress& iProgress) {
+        sReportedBlocks = iProgress.verifiedBlocks;
+      })};
+  ASSERT_TRUE(sReport.isValid);
+  EXPECT_FALSE(sReport.invalidHeight.has_value());
+  EXPECT_EQ(sReport.progress.verifiedBlocks, 100);
+  EXPECT_EQ(sReport.progress.verifiedTransactions, 200);
+  EXPECT_EQ(sReportedBlocks, 100);
+}
+
+TEST_F(ChainVerifierTest, ShouldAcceptEmptyChain) {
+  Chain sChain{_directory};
+  ASSERT_TRUE(ChainVerifier{sChain}.run().isValid);
+}
+
+TEST_F(ChainVerifierTest, ShouldReportBlockWithInvalidProofOfWork) {
+  Chain sChain{_directory};
+  AppendBlocks(sChain, 10);
+
+  block::Block sTip{sChain.getBlock(9).value()};
+  block::Header sForgedHeader{sTip.getHeader()};
+  sForgedHeader.index = 10;
+  sForgedHeader.previousHash = sTip.getHash();
+  sForgedHeader.hash = "forgedHash";
+  std::vector<std::unique_ptr<Coinbase>> sCoinbases{};
+  sCoinbases.push_back(std::make_unique<Coinbase>("Miner", 6.25));
+  ASSERT_TRUE(sChain.append(block::Block{sForgedHeader, std::move(sCoinbases),
+                                         std::nullopt}));
+  AppendBlocks(sChain, 5);
+
+  const VerificationReport sReport{ChainVerifier{sChain, 3}.run()};
+  ASSERT_FALSE(sReport.isValid);
+  EXPECT_EQ(sReport.invalidHeight, 10);
+  EXPECT_FALSE(sReport.error.empty());
+}
+
+TEST_F(ChainVerifierTest, ShouldReportBlockWithTamperedTransaction) {
+  Chain sChain{_directory};
+  AppendBlocks(sChain, 3);
+
+  const block::Block sTip{sChain.getBlock(2).value()};
+  block::Header sHeader{sTip.getHeader()};
+  sHeader.index = 3;
+  sHeader.previousHash = sTip.getHash();
+  // The chain refuses a block hash it already knows.
+  sHeader.hash = "forgedHash";
+  std::vector<std::unique_ptr<Coinbase>> sCoinbases{};
+  sCoinbases.push_back(std::make_unique<Coinbase>(
+      "Miner", 600, std::chrono::system_clock::now(), "tamperedHash"));
+  ASSERT_TRUE(sChain.append(
+      block::Block{sHeader, std::move(sCoinbases), std::nullopt}));
+
+  const VerificationReport sReport{ChainVerifier{sChain, 2}.run()};
+  ASSERT_FALSE(sReport.isValid);
+  EXPECT_EQ(sReport.invalidHeight, 3);
+}
+} // namespace tests
+} // namespace chain
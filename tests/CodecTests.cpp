@@ -0,0 +1,122 @@
+// author: georgiosmatzarapis
+
+#include <gtest/gtest.h>
+
+#include "ByteStream.hpp"
+#include "Codec.hpp"
+
+namespace block {
+namespace tests {
+
+class CodecTest : public ::testing::Test {
+ protected:
+  CodecTest() {
+    std::vector<std::unique_ptr<Coinbase>> aCoinbases{};
+    aCoinbases.push_back(std::make_unique<Coinbase>("Miner", 6.25));
+    std::vector<std::unique_ptr<Payload>> aPayloads{};
+    aPayloads.push_back(std::make_unique<Payload>("Owner", "Receiver", 1.2));
+    aPayloads.push_back(std::make_unique<Payload>("Receiver", "Owner", 0.3));
+    _block = Block{"previousHash", 7, std::move(aCoinbases),
+                   std::move(aPayloads)};
+  }
+
+  Block _block{};
+};
+
+TEST_F(CodecTest, ShouldRestoreHeaderWhenDecoded) {
+  const Block sDecoded{codec::Decode(codec::Encode(_block)).value()};
+  EXPECT_EQ(sDecoded.getIndex(), _block.getIndex());
+  EXPECT_EQ(sDecoded.getPreviousHash(), _block.getPreviousHash());
+  EXPECT_EQ(sDecoded.getMerkleRootHash(), _block.getMerkleRootHash());
+  EXPECT_EQ(sDecoded.getCreationTime(), _block.getCreationTime());
+  EXPECT_EQ(sDecoded.getNonce(), _block.getNonce());
+  EXPECT_EQ(sDecoded.getHash(), _block.getHash());
+}
+
+TEST_F(CodecTest, ShouldRestoreTransactionsWhenDecoded) {
+  const Block sDecoded{codec::Decode(codec::Encode(_block)).value()};
+  ASSERT_TRUE(sDecoded.getCoinbases().has_value());
+  ASSERT_EQ(sDecoded.getCoinbases().value().size(), 1);
+  const Coinbase& sCoinbase{*sDecoded.getCoinbases().value()[0]};
+  EXPECT_EQ(sCoinbase.getOwner(), "Miner");
+  EXPECT_EQ(sCoinbase.getSatoshiAmount(), 625000000);
+  EXPECT_EQ(sCoinbase.getTimestamp(),
+            _block.getCoinbases().value()[0]->getTimestamp());
+
+  ASSERT_EQ(sDecoded.getPayloads().value().size(), 2);
+  for (std::size_t sIndex{}; sIndex < 2; ++sIndex) {
+    Payload& sPayload{*sDecoded.getPayloads().value()[sIndex]};
+    Payload& sOriginal{*_block.getPayloads().value()[sIndex]};
+    EXPECT_EQ(sPayload.getOwner(), sOriginal.getOwner());
+    EXPECT_EQ(sPayload.getReceiver(), sOriginal.getReceiver());
+    EXPECT_EQ(sPayload.getBitcoinAmount(), sOriginal.getBitcoinAmount());
+    EXPECT_EQ(sPayload.getUnixTimestamp(), sOriginal.getUnixTimestamp());
+    EXPECT_EQ(sPayload.getHash(), sOriginal.getHash());
+  }
+}
+
+TEST_F(CodecTest, ShouldKeepAmountsThatAreNotWholeSatoshi) {
+  std::vector<std::unique_ptr<Payload>> sPayloads{};
+  sPayloads.push_back(std::make_unique<Payload>("Owner", "Receiver", 1e-9));
+  const Block sBlock{"previousHash", 1, std::move(sPayloads)};
+  const Block sDecoded{codec::Decode(codec::Encode(sBlock)).value()};
+  EXPECT_EQ(sDecoded.getPayloads().value()[0]->getBitcoinAmount(), 1e-9);
+}
+
+TEST_F(CodecTest, ShouldCompressRepeatedOwners) {
+  std::vector<std::unique_ptr<Payload>> sPayloads{};
+  std::size_t sUncompressedSize{};
+  for (int sIndex{}; sIndex < 50; ++sIndex) {
+    sPayloads.push_back(std::make_unique<Payload>("Owner", "Receiver", 0.5));
+    sUncompressedSize += codec::EncodedSize(*sPayloads.back(),
+                                            sPayloads.back()->getHash());
+  }
+  const Block sBlock{"previousHash", 1, std::move(sPayloads)};
+  EXPECT_LT(codec::Encode(sBlock).size(), sUncompressedSize * 3 / 4);
+}
+
+TEST_F(CodecTest, ShouldDecodeLegacyRecord) {
+  utils::ByteWriter sWriter{};
+  sWriter.putU8(1);
+  sWriter.putU32(3);
+  sWriter.putString("previousHash");
+  sWriter.putString("merkleRootHash");
+  sWriter.putI64(946684800);
+  sWriter.putU32(5);
+  sWriter.putString("hash");
+  sWriter.putU8(0x02);
+  sWriter.putU32(1);
+  sWriter.putString("Owner");
+  sWriter.putString("Receiver");
+  sWriter.putF64(1.5);
+  sWriter.putI64(946684800000000000);
+  sWriter.putString("payloadHash");
+
+  const Block sDecoded{codec::Decode(sWriter.buffer()).value()};
+  EXPECT_EQ(sDecoded.getIndex(), 3);
+  EXPECT_EQ(sDecoded.getHash(), "hash");
+  const Payload& sPayload{*sDecoded.getPayloads().value()[0]};
+  EXPECT_EQ(sPayload.getReceiver(), "Receiver");
+  EXPECT_EQ(sPayload.getSatoshiAmount(), 150000000);
+  EXPECT_EQ(sPayload.getUnixTimestamp(), 946684800);
+}
+
+TEST_F(CodecTest, ShouldDecodeHeaderOnly) {
+  const Header sHeader{codec::DecodeHeader(codec::Encode(_block)).value()};
+  EXPECT_EQ(sHeader.index, _block.getIndex());
+  EXPECT_EQ(sHeader.hash, _block.getHash());
+}
+
+TEST_F(CodecTest, ShouldReturnErrorWhenRecordIsTruncated) {
+  const std::string sRecord{codec::Encode(_block)};
+  ASSERT_FALSE(codec::Decode(sRecord.substr(0, sRecord.size() - 1)));
+  ASSERT_FALSE(codec::Decode(std::string{}));
+}
+
+TEST_F(CodecTest, ShouldReturnErrorWhenVersionIsUnknown) {
+  std::string sRecord{codec::Encode(_block)};
+  sRecord[0] = static_cast<char>(0x7F);
+  ASSERT_FALSE(codec::Decode(sRecord));
+}
+} // namespace tests
+} // namespace block
@@ -36,6 +36,11 @@ TEST(ComputeHashTest, ShouldReturnDifferentHashWhenMessageIsNotTheSame) {
             ComputeHash(std::string{"dummyTextTwo"}));
 }
 
+TEST(ComputeHashTest, ShouldHashWholeMessageWhenItContainsNullByte) {
+  ASSERT_NE(ComputeHash(std::string{"dummy\0TextOne", 13}),
+            ComputeHash(std::string{"dummy\0TextTwo", 13}));
+}
+
 // IsHashValid
 
 TEST(IsHashValidTest, ShouldReturnTrueWhenHashIsValid) {
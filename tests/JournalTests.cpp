@@ -0,0 +1,149 @@
+// author: georgiosmatzarapis
+
+#include <expected>
+#include <filesystem>
+#include <fstream>
+#include <map>
+
+#include <gtest/gtest.h>
+
+#include "Journal.hpp"
+#include "TestHelpers.hpp"
+
+namespace user {
+namespace tests {
+
+class JournalTest : public test_helpers::TemporaryDirectoryTest {
+ protected:
+  JournalOptions _options{1, 0};
+
+  /**
+   * @brief Recover a journal of the directory into a map of deposits.
+   */
+  std::map<ProfileId, std::int64_t> recover(ProfileId& ioNextProfileId) {
+    std::map<ProfileId, std::int64_t> sDeposits{};
+    Journal sJournal{_directory, _options};
+    ioNextProfileId =
+        sJournal
+            .recover([&sDeposits](const ProfileId iProfileId,
+                                  std::optional<Profile>&& ioProfile) {
+              if (ioProfile) {
+                sDeposits[iProfileId] = ioProfile->getSatoshiDeposit();
+              } else {
+                sDeposits.erase(iProfileId);
+              }
+            })
+            .value();
+    return sDeposits;
+  }
+
+  static Journal::Batch Put(const ProfileId iProfileId, const double iDeposit) {
+    Journal::Batch sBatch{};
+    sBatch.put(iProfileId, Profile{"User", 30, iDeposit});
+    return sBatch;
+  }
+};
+
+TEST_F(JournalTest, ShouldReplayAppendedChanges) {
+  {
+    Journal sJournal{_directory, _options};
+    ASSERT_TRUE(sJournal.recover([](ProfileId, std::optional<Profile>&&) {}));
+    ASSERT_TRUE(sJournal.append(Put(0, 1)));
+    ASSERT_TRUE(sJournal.append(Put(1, 2)));
+    ASSERT_TRUE(sJournal.append(Put(0, 3)));
+    Journal::Batch sRemoval{};
+    sRemoval.remove(1);
+    ASSERT_TRUE(sJournal.append(sRemoval));
+  }
+
+  ProfileId sNextProfileId{};
+  const std::map<ProfileId, std::int64_t> sDeposits{recover(sNextProfileId)};
+  EXPECT_EQ(sDeposits, (std::map<ProfileId, std::int64_t>{{0, 300000000}}));
+  EXPECT_EQ(sNextProfileId, 2);
+}
+
+TEST_F(JournalTest, ShouldTruncateTornTailOfLog) {
+  {
+    Journal sJournal{_directory, _options};
+    ASSERT_TRUE(sJournal.recover([](ProfileId, std::optional<Profile>&&) {}));
+    ASSERT_TRUE(sJournal.append(Put(0, 1)));
+  }
+  const std::filesystem::path sLog{_directory / "log-0000000000.dat"};
+  const std::uintmax_t sIntactSize{std::filesystem::file_size(sLog)};
+  {
+    // A record whose length runs past the end of the file.
+    std::ofstream sFile{sLog, std::ios::binary | std::ios::app};
+    sFile.write("\x40\x00\x00\x00\x01\x02", 6);
+  }
+
+  ProfileId sNextProfileId{};
+  EXPECT_EQ(recover(sNextProfileId).size(), 1);
+  EXPECT_EQ(std::filesystem::file_size(sLog), sIntactSize);
+}
+
+TEST_F(JournalTest, ShouldReplayOnlyLogsFollowingSnapshot) {
+  {
+    Journal sJournal{_directory, _options};
+    ASSERT_TRUE(sJournal.recover([](ProfileId, std::optional<Profile>&&) {}));
+    ASSERT_TRUE(sJournal.append(Put(0, 1)));
+    ASSERT_TRUE(sJournal.append(Put(5, 2)));
+
+    const std::uint64_t sSequence{sJournal.rotate().value()};
+    ASSERT_TRUE(sJournal.append(Put(6, 4)));
+    Journal::Batch sProfiles{Put(0, 1)};
+    sProfiles.put(5, Profile{"User", 30, 2});
+    ASSERT_TRUE(sJournal.writeSnapshot(sSequence, 6, sProfiles));
+  }
+  EXPECT_FALSE(std::filesystem::exists(_directory / "log-0000000000.dat"));
+
+  ProfileId sNextProfileId{};
+  const std::map<ProfileId, std::int64_t> sDeposits{recover(sNextProfileId)};
+  EXPECT_EQ(sDeposits, (std::map<ProfileId, std::int64_t>{
+                           {0, 100000000}, {5, 200000000}, {6, 400000000}}));
+  EXPECT_EQ(sNextProfileId, 7);
+}
+
+TEST_F(JournalTest, ShouldFailRecoveryWhenSnapshotIsCorrupted) {
+  {
+    Journal sJournal{_directory, _options};
+    ASSERT_TRUE(sJournal.recover([](ProfileId, std::optional<Profile>&&) {}));
+    ASSERT_TRUE(sJournal.append(Put(0, 1)));
+    const std::uint64_t sSequence{sJournal.rotate().value()};
+    ASSERT_TRUE(sJournal.writeSnapshot(sSequence, 1, Put(0, 1)));
+  }
+  {
+    std::fstream sFile{_directory / "snapshot-0000000001.bin",
+                       std::ios::binary | std::ios::in | std::ios::out};
+    sFile.seekp(4);
+    sFile.put('\x7F');
+  }
+
+  Journal sJournal{_directory, _options};
+  const std::expected<ProfileId, std::string> sRecovered{
+      sJournal.recover([](ProfileId, std::optional<Profile>&&) {})};
+  ASSERT_FALSE(sRecovered);
+  EXPECT_NE(sRecovered.error().find("Snapshot 1 is damaged"),
+            std::string::npos);
+}
+
+TEST_F(JournalTest, ShouldFallBackToLogsWhenSnapshotIsCorrupted) {
+  {
+    Journal sJournal{_directory, _options};
+    ASSERT_TRUE(sJournal.recover([](ProfileId, std::optional<Profile>&&) {}));
+    ASSERT_TRUE(sJournal.append(Put(0, 1)));
+    ASSERT_TRUE(sJournal.rotate());
+  }
+  // A snapshot torn before the logs it replaces were deleted.
+  {
+    std::ofstream sFile{_directory / "snapshot-0000000001.bin",
+                        std::ios::binary};
+    sFile.write("\x55\x4E\x50", 3);
+  }
+
+  ProfileId sNextProfileId{};
+  const std::map<ProfileId, std::int64_t> sDeposits{recover(sNextProfileId)};
+  EXPECT_EQ(sDeposits, (std::map<ProfileId, std::int64_t>{{0, 100000000}}));
+  EXPECT_EQ(sNextProfileId, 1);
+}
+} // namespace tests
+} // namespace user
@@ -0,0 +1,113 @@
+// author: georgiosmatzarapis
+
+#include <gtest/gtest.h>
+
+#include "Ledger.hpp"
+#include "TestHelpers.hpp"
+
+namespace ledger {
+namespace tests {
+
+using namespace transaction;
+
+using test_helpers::MakeBlock;
+
+/* === OwnerTable Tests === */
+
+TEST(OwnerTableTest, ShouldReturnSameIdWhenOwnerIsInternedTwice) {
+  OwnerTable sTable{};
+  const OwnerId sFirst{sTable.intern("Owner")};
+  EXPECT_EQ(sTable.intern("Receiver"), sFirst + 1);
+  EXPECT_EQ(sTable.intern("Owner"), sFirst);
+  EXPECT_EQ(sTable.size(), 2);
+  EXPECT_EQ(sTable.getName(sFirst), "Owner");
+}
+
+TEST(OwnerTableTest, ShouldFindOwnersAfterGrowing) {
+  OwnerTable sTable{};
+  for (int sIndex{}; sIndex < 10000; ++sIndex) {
+    ASSERT_EQ(sTable.intern("owner" + std::to_string(sIndex)), sIndex);
+  }
+  for (int sIndex{}; sIndex < 10000; ++sIndex) {
+    ASSERT_EQ(sTable.find("owner" + std::to_string(sIndex)), sIndex);
+  }
+  EXPECT_FALSE(sTable.find("unknown").has_value());
+}
+
+/* === Ledger Tests === */
+
+TEST(LedgerTest, ShouldCreditCoinbaseOwner) {
+  Ledger sLedger{};
+  std::vector<std::unique_ptr<Coinbase>> sCoinbases{};
+  sCoinbases.push_back(std::make_unique<Coinbase>("Miner", 6.25));
+  ASSERT_TRUE(sLedger.connect(MakeBlock(std::move(sCoinbases), {})));
+  EXPECT_EQ(sLedger.getBalance("Miner"), 625000000);
+  EXPECT_EQ(sLedger.getBalance("Unknown"), 0);
+}
+
+TEST(LedgerTest, ShouldMovePayloadAmountFromOwnerToReceiver) {
+  Ledger sLedger{};
+  std::vector<std::unique_ptr<Coinbase>> sCoinbases{};
+  sCoinbases.push_back(std::make_unique<Coinbase>("Owner", 2));
+  std::vector<std::unique_ptr<Payload>> sPayloads{};
+  sPayloads.push_back(std::make_unique<Payload>("Owner", "Receiver", 0.5));
+  sPayloads.push_back(std::make_unique<Payload>("Receiver", "Third", 0.25));
+  ASSERT_TRUE(sLedger.connect(MakeBlock(std::move(sCoinbases),
+                                        std::move(sPayloads))));
+  EXPECT_EQ(sLedger.getBalance("Owner"), 150000000);
+  EXPECT_EQ(sLedger.getBalance("Receiver"), 25000000);
+  EXPECT_EQ(sLedger.getBalance("Third"), 25000000);
+}
+
+TEST(LedgerTest, ShouldRejectBlockAtomicallyWhenPayloadOverspends) {
+  Ledger sLedger{};
+  std::vector<std::unique_ptr<Coinbase>> sCoinbases{};
+  sCoinbases.push_back(std::make_unique<Coinbase>("Owner", 1));
+  std::vector<std::unique_ptr<Payload>> sPayloads{};
+  sPayloads.push_back(std::make_unique<Payload>("Owner", "Receiver", 0.75));
+  sPayloads.push_back(std::make_unique<Payload>("Owner", "Receiver", 0.75));
+  ASSERT_FALSE(sLedger.connect(MakeBlock(std::move(sCoinbases),
+                                         std::move(sPayloads))));
+  EXPECT_EQ(sLedger.getBalance("Owner"), 0);
+  EXPECT_EQ(sLedger.getBalance("Receiver"), 0);
+}
+
+TEST(LedgerTest, ShouldRestoreBalancesWhenBlockIsDisconnected) {
+  Ledger sLedger{};
+  std::vector<std::unique_ptr<Coinbase>> sFirstCoinbases{};
+  sFirstCoinbases.push_back(std::make_unique<Coinbase>("Owner", 1));
+  ASSERT_TRUE(sLedger.connect(MakeBlock(std::move(sFirstCoinbases), {})));
+
+  std::vector<std::unique_ptr<Coinbase>> sCoinbases{};
+  sCoinbases.push_back(std::make_unique<Coinbase>("Miner", 1));
+  std::vector<std::unique_ptr<Payload>> sPayloads{};
+  sPayloads.push_back(std::make_unique<Payload>("Owner", "Receiver", 0.5));
+  const block::Block sBlock{
+      MakeBlock(std::move(sCoinbases), std::move(sPayloads))};
+  ASSERT_TRUE(sLedger.connect(sBlock));
+  ASSERT_TRUE(sLedger.disconnect(sBlock));
+  EXPECT_EQ(sLedger.getBalance("Owner"), 100000000);
+  EXPECT_EQ(sLedger.getBalance("Receiver"), 0);
+  EXPECT_EQ(sLedger.getBalance("Miner"), 0);
+}
+
+TEST(LedgerTest, ShouldRevertBlockThroughCompactUndoRecord) {
+  Ledger sLedger{};
+  std::vector<std::unique_ptr<Coinbase>> sCoinbases{};
+  sCoinbases.push_back(std::make_unique<Coinbase>("Owner", 2));
+  std::vector<std::unique_ptr<Payload>> sPayloads{};
+  sPayloads.push_back(std::make_unique<Payload>("Owner", "Receiver", 0.5));
+  sPayloads.push_back(std::make_unique<Payload>("Receiver", "Owner", 0.5));
+  UndoRecord sUndo{};
+  ASSERT_TRUE(sLedger.connect(
+      MakeBlock(std::move(sCoinbases), std::move(sPayloads)), sUndo));
+  // Owner is credited, debited and credited again; Receiver nets to zero.
+  ASSERT_EQ(sUndo.changes.size(), 1);
+  EXPECT_EQ(sUndo.changes[0].second, 200000000);
+
+  ASSERT_TRUE(sLedger.undo(sUndo));
+  EXPECT_EQ(sLedger.getBalance("Owner"), 0);
+  EXPECT_FALSE(sLedger.undo(sUndo));
+}
+} // namespace tests
+} // namespace ledger
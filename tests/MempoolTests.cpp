@@ -0,0 +1,180 @@
+// author: georgiosmatzarapis
+
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "Mempool.hpp"
+
+namespace mempool {
+namespace tests {
+
+using namespace transaction;
+
+static std::vector<std::string> HashesByFeeRate(const Mempool& iMempool) {
+  std::vector<std::string> sHashes{};
+  iMempool.forEachByFeeRate([&sHashes](const Entry& iEntry) {
+    sHashes.push_back(iEntry.hash);
+    return true;
+  });
+  return sHashes;
+}
+
+TEST(MempoolTest, ShouldAdmitPayloadsSubmittedConcurrently) {
+  constexpr int kProducers{4}, kPayloads{250};
+  Mempool sMempool{};
+  {
+    std::vector<std::jthread> sProducers{};
+    for (int sProducer{}; sProducer < kProducers; ++sProducer) {
+      sProducers.emplace_back([&sMempool, sProducer] {
+        for (int sIndex{}; sIndex < kPayloads; ++sIndex) {
+          sMempool.submit(Payload{"Owner" + std::to_string(sProducer),
+                                  "Receiver", sIndex + 1.0},
+                          10);
+        }
+      });
+    }
+  }
+  EXPECT_EQ(sMempool.process(), kProducers * kPayloads);
+  EXPECT_EQ(sMempool.size(), kProducers * kPayloads);
+}
+
+TEST(MempoolTest, ShouldDropDuplicatePayloads) {
+  Mempool sMempool{};
+  Payload sPayload{"Owner", "Receiver", 1};
+  const std::string sHash{sPayload.getHash()};
+  sMempool.submit(sPayload, 10);
+  sMempool.submit(sPayload, 20);
+  EXPECT_EQ(sMempool.process(), 1);
+  EXPECT_EQ(sMempool.find(sHash)->fee, 10);
+}
+
+TEST(MempoolTest, ShouldDropPayloadWithInconsistentHash) {
+  Mempool sMempool{};
+  sMempool.submit(Payload{"Owner", "Receiver", 1,
+                          std::chrono::system_clock::now(), "forgedHash"},
+                  10);
+  EXPECT_EQ(sMempool.process(), 0);
+  EXPECT_EQ(sMempool.size(), 0);
+}
+
+TEST(MempoolTest, ShouldOrderPayloadsByFeeRate) {
+  Mempool sMempool{};
+  Payload sLow{"Owner", "Receiver", 1}, sHigh{"Owner", "Receiver", 2},
+      sMiddle{"Owner", "Receiver", 3};
+  sMempool.submit(sLow, 10);
+  sMempool.submit(sHigh, 1000);
+  sMempool.submit(sMiddle, 100);
+  sMempool.process();
+  EXPECT_EQ(HashesByFeeRate(sMempool),
+            (std::vector<std::string>{sHigh.getHash(), sMiddle.getHash(),
+                                      sLow.getHash()}));
+}
+
+TEST(MempoolTest, ShouldEvictLowestFeeRateWhenFull) {
+  Payload sLow{"Owner", "Receiver", 1}, sHigh{"Owner", "Receiver", 2},
+      sNew{"Owner", "Receiver", 3}, sLowest{"Owner", "Receiver", 4};
+  Mempool sMempool{MempoolOptions{.maxBytes = 2 * 100}};
+  sMempool.submit(sLow, 10);
+  sMempool.submit(sHigh, 1000);
+  sMempool.submit(sNew, 100);
+  sMempool.submit(sLowest, 1);
+  EXPECT_EQ(sMempool.process(), 3);
+  EXPECT_LE(sMempool.getBytes(), 200);
+  EXPECT_EQ(HashesByFeeRate(sMempool),
+            (std::vector<std::string>{sHigh.getHash(), sNew.getHash()}));
+}
+
+TEST(MempoolTest, ShouldFindPooledPayloadsWhenFilterIsRebuilt) {
+  Mempool sMempool{MempoolOptions{.expectedPayloads = 2}};
+  std::vector<std::string> sHashes{};
+  for (int sIndex{}; sIndex < 10; ++sIndex) {
+    Payload sPayload{"Owner", "Receiver", sIndex + 1.0};
+    sHashes.push_back(sPayload.getHash());
+    sMempool.submit(std::move(sPayload), 10);
+  }
+  ASSERT_EQ(sMempool.process(), 10);
+  ASSERT_TRUE(sMempool.remove(sHashes[0]));
+  sMempool.submit(Payload{"Owner", "Receiver", 11}, 10);
+  ASSERT_EQ(sMempool.process(), 1);
+
+  EXPECT_FALSE(sMempool.contains(sHashes[0]));
+  for (std::size_t sIndex{1}; sIndex < sHashes.size(); ++sIndex) {
+    EXPECT_TRUE(sMempool.contains(sHashes[sIndex]));
+    EXPECT_EQ(sMempool.find(sHashes[sIndex])->hash, sHashes[sIndex]);
+  }
+  EXPECT_EQ(sMempool.find("unknownHash"), nullptr);
+}
+
+TEST(MempoolTest, ShouldRemovePayloadsIncludedInBlock) {
+  Mempool sMempool{};
+  Payload sIncluded{"Owner", "Receiver", 1}, sPending{"Owner", "Receiver", 2};
+  sMempool.submit(sIncluded, 10);
+  sMempool.submit(sPending, 10);
+  sMempool.process();
+
+  std::vector<std::unique_ptr<Payload>> sPayloads{};
+  sPayloads.push_back(std::make_unique<Payload>(sIncluded));
+  sMempool.removeForBlock(
+      block::Block{"previousHash", 1, std::move(sPayloads)});
+  EXPECT_FALSE(sMempool.contains(sIncluded.getHash()));
+  EXPECT_TRUE(sMempool.contains(sPending.getHash()));
+}
+
+TEST(MempoolTest, ShouldRejectPayloadsOverspendingConfirmedBalance) {
+  ledger::Ledger sLedger{};
+  sLedger.restore("Owner", BitcoinToSatoshi(5));
+  Mempool sMempool{sLedger};
+  sMempool.submit(Payload{"Owner", "Receiver", 3}, 10);
+  sMempool.submit(Payload{"Owner", "Other", 3}, 1000);
+  sMempool.submit(Payload{"Owner", "Other", 2}, 10);
+  EXPECT_EQ(sMempool.process(), 2);
+  EXPECT_EQ(sMempool.getPendingSpend("Owner"), BitcoinToSatoshi(5));
+}
+
+TEST(MempoolTest, ShouldReleasePendingSpendWhenPayloadIsEvicted) {
+  ledger::Ledger sLedger{};
+  sLedger.restore("Owner", BitcoinToSatoshi(5));
+  Mempool sMempool{sLedger, MempoolOptions{.maxBytes = 100}};
+  sMempool.submit(Payload{"Owner", "Receiver", 3}, 10);
+  sMempool.submit(Payload{"Other", "Receiver", 0}, 1000);
+  sMempool.submit(Payload{"Owner", "Other", 5}, 100);
+  EXPECT_EQ(sMempool.process(), 2);
+  EXPECT_EQ(sMempool.getPendingSpend("Owner"), 0);
+}
+
+TEST(MempoolTest, ShouldDropNewestPayloadsNoLongerAffordableAfterBlock) {
+  ledger::Ledger sLedger{};
+  sLedger.restore("Owner", BitcoinToSatoshi(5));
+  Mempool sMempool{sLedger};
+  Payload sOlder{"Owner", "Receiver", 2}, sNewer{"Owner", "Receiver", 3};
+  sMempool.submit(sOlder, 10);
+  sMempool.submit(sNewer, 10);
+  ASSERT_EQ(sMempool.process(), 2);
+
+  // A block spends from the owner through a payload unknown to the pool.
+  std::vector<std::unique_ptr<Payload>> sPayloads{};
+  sPayloads.push_back(std::make_unique<Payload>("Owner", "Elsewhere", 1));
+  const block::Block sBlock{"previousHash", 1, std::move(sPayloads)};
+  sLedger.restore("Owner", BitcoinToSatoshi(4));
+  sMempool.removeForBlock(sBlock);
+  EXPECT_TRUE(sMempool.contains(sOlder.getHash()));
+  EXPECT_FALSE(sMempool.contains(sNewer.getHash()));
+  EXPECT_EQ(sMempool.getPendingSpend("Owner"), BitcoinToSatoshi(2));
+}
+
+TEST(MempoolTest, ShouldAdmitBackPayloadsOfDisconnectedBlock) {
+  Mempool sMempool{};
+  Payload sPayload{"Owner", "Receiver", 1};
+  std::vector<std::unique_ptr<Payload>> sPayloads{};
+  sPayloads.push_back(std::make_unique<Payload>(sPayload));
+  const block::Block sBlock{"previousHash", 1, std::move(sPayloads)};
+
+  sMempool.onBlockDisconnected(sBlock);
+  EXPECT_TRUE(sMempool.contains(sPayload.getHash()));
+  sMempool.onBlockConnected(sBlock);
+  EXPECT_FALSE(sMempool.contains(sPayload.getHash()));
+}
+} // namespace tests
+} // namespace mempool
@@ -0,0 +1,73 @@
+// author: georgiosmatzarapis
+
+#include <gtest/gtest.h>
+
+#include "OwnerHistoryIndex.hpp"
+#include "TestHelpers.hpp"
+
+namespace chain {
+namespace tests {
+
+using namespace transaction;
+
+using test_helpers::MakeBlock;
+
+TEST(OwnerHistoryIndexTest, ShouldListTransactionsOfEveryParty) {
+  OwnerHistoryIndex sIndex{};
+  sIndex.onBlockConnected(
+      MakeBlock("previousHash", 0, "Miner", {"Alice", "Bob", "Alice"}));
+  sIndex.onBlockConnected(MakeBlock("previousHash", 1, "Miner", {"Miner"}));
+
+  EXPECT_EQ(sIndex.getHistory("Alice", 0, 10).postings,
+            (std::vector<Posting>{{0, 1}, {0, 3}}));
+  EXPECT_EQ(sIndex.getHistory("Miner", 0, 10).postings,
+            (std::vector<Posting>{{0, 0}, {0, 1}, {0, 2}, {0, 3}, {1, 0},
+                                  {1, 1}}));
+  EXPECT_EQ(sIndex.getCount("Bob"), 1);
+  EXPECT_EQ(sIndex.getCount("Nobody"), 0);
+  EXPECT_TRUE(sIndex.getHistory("Nobody", 0, 10).postings.empty());
+}
+
+TEST(OwnerHistoryIndexTest, ShouldPageThroughLongHistory) {
+  OwnerHistoryIndex sIndex{};
+  for (std::uint32_t sHeight{}; sHeight < 100; ++sHeight) {
+    sIndex.onBlockConnected(MakeBlock("previousHash", sHeight, "Miner",
+                                      {"Alice", "Alice", "Bob"}));
+  }
+  ASSERT_EQ(sIndex.getCount("Alice"), 200);
+  EXPECT_LT(sIndex.getBytes(), 2 * 4 * 400);
+
+  std::vector<Posting> sPostings{};
+  std::optional<std::size_t> sNext{0};
+  while (sNext) {
+    const HistoryPage sPage{sIndex.getHistory("Alice", sNext.value(), 30)};
+    sPostings.insert(sPostings.end(), sPage.postings.begin(),
+                     sPage.postings.end());
+    sNext = sPage.next;
+  }
+  ASSERT_EQ(sPostings.size(), 200);
+  EXPECT_EQ(sPostings[131], (Posting{65, 2}));
+  EXPECT_EQ(sIndex.getHistory("Alice", 199, 30).postings,
+            (std::vector<Posting>{{99, 2}}));
+}
+
+TEST(OwnerHistoryIndexTest, ShouldForgetDisconnectedBlocks) {
+  OwnerHistoryIndex sIndex{};
+  for (std::uint32_t sHeight{}; sHeight < 70; ++sHeight) {
+    sIndex.onBlockConnected(
+        MakeBlock("previousHash", sHeight, "Miner", {"Alice"}));
+  }
+  const block::Block sTip{
+      MakeBlock("previousHash", 70, "Miner", {"Alice", "Bob"})};
+  sIndex.onBlockConnected(sTip);
+  sIndex.onBlockDisconnected(sTip);
+  EXPECT_EQ(sIndex.getCount("Alice"), 70);
+  EXPECT_EQ(sIndex.getCount("Bob"), 0);
+
+  sIndex.onBlockConnected(
+      MakeBlock("previousHash", 70, "Miner", {"Bob", "Alice"}));
+  EXPECT_EQ(sIndex.getHistory("Alice", 69, 10).postings,
+            (std::vector<Posting>{{69, 1}, {70, 2}}));
+}
+} // namespace tests
+} // namespace chain
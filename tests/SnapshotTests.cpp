@@ -0,0 +1,78 @@
+// author: georgiosmatzarapis
+
+#include <filesystem>
+#include <fstream>
+
+#include <gtest/gtest.h>
+
+#include "Snapshot.hpp"
+#include "TestHelpers.hpp"
+
+namespace ledger {
+namespace tests {
+
+class SnapshotTest : public test_helpers::TemporaryDirectoryTest {
+ protected:
+  Ledger _ledger{};
+
+  void SetUp() override {
+    std::filesystem::create_directories(_directory);
+    _ledger.restore("Owner", 100);
+    _ledger.restore("Receiver", 25);
+    _ledger.restore("Empty", 0);
+  }
+
+  static bool AcceptAll(std::uint32_t, const std::string&) { return true; }
+};
+
+TEST_F(SnapshotTest, ShouldRestoreWrittenBalances) {
+  ASSERT_TRUE(WriteSnapshot(_directory, _ledger, 10, "tipHash"));
+  const std::expected<Snapshot, std::string> sSnapshot{
+      LoadLatestSnapshot(_directory, AcceptAll)};
+  ASSERT_TRUE(sSnapshot);
+  EXPECT_EQ(sSnapshot.value().chainLength, 10);
+  EXPECT_EQ(sSnapshot.value().tipHash, "tipHash");
+  EXPECT_EQ(sSnapshot.value().ledger.getBalance("Owner"), 100);
+  EXPECT_EQ(sSnapshot.value().ledger.getBalance("Receiver"), 25);
+  EXPECT_FALSE(
+      sSnapshot.value().ledger.getOwners().find("Empty").has_value());
+}
+
+TEST_F(SnapshotTest, ShouldFallBackToOlderSnapshotWhenNewestIsCorrupted) {
+  ASSERT_TRUE(WriteSnapshot(_directory, _ledger, 10, "olderTip"));
+  ASSERT_TRUE(WriteSnapshot(_directory, _ledger, 20, "newerTip"));
+  {
+    std::fstream sFile{_directory / "snapshot-0000000020.bin",
+                       std::ios::binary | std::ios::in | std::ios::out};
+    sFile.seekp(12);
+    sFile.put('X');
+  }
+  const std::expected<Snapshot, std::string> sSnapshot{
+      LoadLatestSnapshot(_directory, AcceptAll)};
+  ASSERT_TRUE(sSnapshot);
+  EXPECT_EQ(sSnapshot.value().chainLength, 10);
+}
+
+TEST_F(SnapshotTest, ShouldSkipSnapshotsRejectedByPredicate) {
+  ASSERT_TRUE(WriteSnapshot(_directory, _ledger, 10, "olderTip"));
+  ASSERT_TRUE(WriteSnapshot(_directory, _ledger, 20, "newerTip"));
+  const std::expected<Snapshot, std::string> sSnapshot{LoadLatestSnapshot(
+      _directory, [](const std::uint32_t iChainLength, const std::string&) {
+        return iChainLength <= 15;
+      })};
+  ASSERT_TRUE(sSnapshot);
+  EXPECT_EQ(sSnapshot.value().tipHash, "olderTip");
+}
+
+TEST_F(SnapshotTest, ShouldKeepOnlyNewestSnapshots) {
+  for (std::uint32_t sLength{1}; sLength <= 4; ++sLength) {
+    ASSERT_TRUE(WriteSnapshot(_directory, _ledger, sLength, "tipHash", 2));
+  }
+  // An interrupted write leaves a temporary file that must be ignored.
+  std::ofstream{_directory / "snapshot-0000000005.bin.tmp"} << "partial";
+  EXPECT_FALSE(std::filesystem::exists(_directory / "snapshot-0000000002.bin"));
+  EXPECT_TRUE(std::filesystem::exists(_directory / "snapshot-0000000003.bin"));
+  EXPECT_EQ(LoadLatestSnapshot(_directory, AcceptAll).value().chainLength, 4);
+}
+} // namespace tests
+} // namespace ledger
@@ -0,0 +1,72 @@
+// author: georgiosmatzarapis
+
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "Block.hpp"
+
+namespace test_helpers {
+
+/**
+ * @brief Fixture of the tests working on files, in a temporary directory
+ * named after the running test. The directory is emptied before the test and
+ * deleted after it, once the members of the derived fixture are destroyed.
+ */
+class TemporaryDirectoryTest : public ::testing::Test {
+ protected:
+  const std::filesystem::path _directory{
+      std::filesystem::temp_directory_path() /
+      (std::string{::testing::UnitTest::GetInstance()
+                       ->current_test_info()
+                       ->test_suite_name()} +
+       "_" +
+       ::testing::UnitTest::GetInstance()->current_test_info()->name())};
+
+  TemporaryDirectoryTest() { std::filesystem::remove_all(_directory); }
+  ~TemporaryDirectoryTest() override {
+    std::filesystem::remove_all(_directory);
+  }
+};
+
+/**
+ * @brief Mine a block of the given transactions.
+ */
+inline block::Block
+MakeBlock(std::vector<std::unique_ptr<transaction::Coinbase>> iCoinbases,
+          std::vector<std::unique_ptr<transaction::Payload>> iPayloads,
+          std::string iPreviousHash = "previousHash",
+          const std::uint32_t iIndex = 0) {
+  return block::Block{std::move(iPreviousHash), iIndex, std::move(iCoinbases),
+                      std::move(iPayloads)};
+}
+
+/**
+ * @brief Mine a block rewarding a miner with 6.25, in which the miner pays 1
+ * to each receiver. Without receivers, the block holds no payloads.
+ */
+inline block::Block MakeBlock(std::string iPreviousHash,
+                              const std::uint32_t iIndex,
+                              const std::string& iMiner = "Miner",
+                              const std::vector<std::string>& iReceivers = {}) {
+  std::vector<std::unique_ptr<transaction::Coinbase>> sCoinbases{};
+  sCoinbases.push_back(std::make_unique<transaction::Coinbase>(iMiner, 6.25));
+  if (iReceivers.empty()) {
+    return block::Block{std::move(iPreviousHash), iIndex,
+                        std::move(sCoinbases)};
+  }
+  std::vector<std::unique_ptr<transaction::Payload>> sPayloads{};
+  for (const std::string& sReceiver : iReceivers) {
+    sPayloads.push_back(
+        std::make_unique<transaction::Payload>(iMiner, sReceiver, 1));
+  }
+  return MakeBlock(std::move(sCoinbases), std::move(sPayloads),
+                   std::move(iPreviousHash), iIndex);
+}
+} // namespace test_helpers
@@ -0,0 +1,69 @@
+// author: georgiosmatzarapis
+
+#include <gtest/gtest.h>
+
+#include "TestHelpers.hpp"
+#include "TransactionIndex.hpp"
+
+namespace chain {
+namespace tests {
+
+using namespace transaction;
+
+using test_helpers::MakeBlock;
+using TransactionIndexChainTest = test_helpers::TemporaryDirectoryTest;
+
+static std::string PayloadHash(const block::Block& iBlock) {
+  return iBlock.getPayloads().value().front()->getHash();
+}
+
+TEST(TransactionIndexTest, ShouldFollowConnectedAndDisconnectedBlocks) {
+  TransactionIndex sIndex{};
+  const block::Block sGenesis{MakeBlock("genesis", 0, "Alice", {"Receiver"})};
+  const block::Block sNext{
+      MakeBlock(sGenesis.getHash(), 1, "Bob", {"Receiver"})};
+  sIndex.onBlockConnected(sGenesis);
+  sIndex.onBlockConnected(sNext);
+  EXPECT_EQ(sIndex.size(), 4);
+  EXPECT_EQ(sIndex.findHeight(PayloadHash(sNext)), 1);
+  EXPECT_FALSE(sIndex.contains(Payload{"Carol", "Receiver", 1}.getHash()));
+
+  sIndex.onBlockDisconnected(sNext);
+  EXPECT_FALSE(sIndex.contains(PayloadHash(sNext)));
+  EXPECT_TRUE(sIndex.contains(PayloadHash(sGenesis)));
+}
+
+TEST(TransactionIndexTest, ShouldKeepFindingTransactionsWhenFilterGrows) {
+  TransactionIndex sIndex{TransactionIndexOptions{.expectedTransactions = 4}};
+  std::vector<std::string> sHashes{};
+  std::string sPreviousHash{"genesis"};
+  for (std::uint32_t sHeight{}; sHeight < 20; ++sHeight) {
+    const block::Block sBlock{
+        MakeBlock(sPreviousHash, sHeight, "Miner" + std::to_string(sHeight),
+                  {"Receiver"})};
+    sIndex.onBlockConnected(sBlock);
+    sHashes.push_back(PayloadHash(sBlock));
+    sPreviousHash = sBlock.getHash();
+  }
+  for (std::uint32_t sHeight{}; sHeight < 20; ++sHeight) {
+    EXPECT_EQ(sIndex.findHeight(sHashes[sHeight]), sHeight);
+  }
+}
+
+TEST_F(TransactionIndexChainTest, ShouldIndexStoredBlocksOfChain) {
+  Chain sChain{_directory};
+  const block::Block sGenesis{MakeBlock("genesis", 0, "Alice", {"Receiver"})};
+  const block::Block sUnknown{MakeBlock("genesis", 0, "Carol", {"Receiver"})};
+  const block::Block sNext{
+      MakeBlock(sGenesis.getHash(), 1, "Bob", {"Receiver"})};
+  ASSERT_TRUE(sChain.append(sGenesis));
+  ASSERT_TRUE(sChain.append(sNext));
+
+  TransactionIndex sIndex{};
+  ASSERT_TRUE(sIndex.build(sChain));
+  EXPECT_EQ(sIndex.size(), 4);
+  EXPECT_EQ(sIndex.findHeight(PayloadHash(sNext)), 1);
+  EXPECT_FALSE(sIndex.contains(PayloadHash(sUnknown)));
+}
+} // namespace tests
+} // namespace chain
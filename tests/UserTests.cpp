@@ -1,9 +1,13 @@
 // author: georgiosmatzarapis
 
+#include <filesystem>
+#include <set>
+#include <thread>
 #include <variant>
 
 #include <gtest/gtest.h>
 
+#include "Journal.hpp"
 #include "User.hpp"
 
 namespace user {
@@ -30,8 +34,8 @@ class UserInMemoryDatabaseTest : public UserProfileTest {
       : _profileId{user::InMemoryDatabase::GetInstance().insert(_profile)},
         _profileIdValue{_profileId.second.value()} {};
 
-  const std::pair<bool, std::optional<std::uint16_t>> _profileId{};
-  const std::uint16_t _profileIdValue{};
+  const std::pair<bool, std::optional<ProfileId>> _profileId{};
+  const ProfileId _profileIdValue{};
 };
 
 /* === Profile Tests === */
@@ -71,6 +75,54 @@ TEST_F(UserProfileTest, ShouldNotUpdateDepositWhenNewDepositIsNegative) {
   EXPECT_EQ(_profile.getDeposit(), std::get<double>(_testData["deposit"]));
 }
 
+/* === ProfileTable Tests === */
+
+TEST(ProfileTableTest, ShouldFindProfilesBeyondSixteenBitIds) {
+  ProfileTable sTable{};
+  constexpr ProfileId kFirstId{ProfileId{1} << 40};
+  for (ProfileId sProfileId{kFirstId}; sProfileId < kFirstId + 1000;
+       ++sProfileId) {
+    ASSERT_TRUE(sTable.insert(
+        sProfileId, Profile{"User" + std::to_string(sProfileId), 30, 1}));
+  }
+  EXPECT_FALSE(sTable.insert(kFirstId, Profile{"Duplicate", 30, 1}));
+  EXPECT_EQ(sTable.size(), 1000);
+  EXPECT_EQ(sTable.find(0), nullptr);
+  for (ProfileId sProfileId{kFirstId}; sProfileId < kFirstId + 1000;
+       ++sProfileId) {
+    const StoredProfile* sProfile{sTable.find(sProfileId)};
+    ASSERT_NE(sProfile, nullptr);
+    EXPECT_EQ(sProfile->profile.getFullName(),
+              "User" + std::to_string(sProfileId));
+  }
+}
+
+TEST(ProfileTableTest, ShouldReuseSlotsOfRemovedProfiles) {
+  ProfileTable sTable{};
+  for (ProfileId sProfileId{}; sProfileId < 1000; ++sProfileId) {
+    ASSERT_TRUE(sTable.insert(sProfileId, Profile{"User", 30, 1}));
+  }
+  const std::size_t sCapacity{sTable.getCapacity()};
+
+  // Removing every other profile leaves holes in the probe sequences, the
+  // remaining profiles must still be found.
+  for (ProfileId sProfileId{}; sProfileId < 1000; sProfileId += 2) {
+    ASSERT_TRUE(sTable.erase(sProfileId));
+  }
+  EXPECT_FALSE(sTable.erase(0));
+  for (ProfileId sProfileId{}; sProfileId < 1000; ++sProfileId) {
+    EXPECT_EQ(sTable.find(sProfileId) != nullptr, sProfileId % 2 == 1);
+  }
+
+  for (ProfileId sProfileId{1000}; sProfileId < 1500; ++sProfileId) {
+    ASSERT_TRUE(sTable.insert(sProfileId, Profile{"NewUser", 25, 2}));
+  }
+  EXPECT_EQ(sTable.size(), 1000);
+  EXPECT_EQ(sTable.getCapacity(), sCapacity);
+  EXPECT_EQ(sTable.find(1499)->profile.getFullName(), "NewUser");
+  EXPECT_EQ(sTable.find(999)->profile.getFullName(), "User");
+}
+
 /* === InMemoryDatabase Tests === */
 
 TEST_F(UserInMemoryDatabaseTest, ShouldInsertProfileWhenRecordDoesNotExist) {
@@ -80,7 +132,7 @@ TEST_F(UserInMemoryDatabaseTest, ShouldInsertProfileWhenRecordDoesNotExist) {
 
 TEST_F(UserInMemoryDatabaseTest,
        ShouldIncreaseUniqueIdWhenNewProfileIsInserted) {
-  std::pair<bool, std::optional<std::uint16_t>> sProfileId{
+  std::pair<bool, std::optional<ProfileId>> sProfileId{
       user::InMemoryDatabase::GetInstance().insert(_profile)};
   EXPECT_TRUE(_profileId.first);
   EXPECT_EQ(_profileId.second, 0);
@@ -154,5 +206,300 @@ TEST_F(UserInMemoryDatabaseTest, ShouldNotUpdateProfileWhenPassedIdIsInvalid) {
   ASSERT_EQ(sRetrievedProfileValue.getDeposit(),
             std::get<double>(_testData["deposit"]));
 }
+
+TEST_F(UserInMemoryDatabaseTest, ShouldAccessProfileInPlace) {
+  InMemoryDatabase& sDatabase{InMemoryDatabase::GetInstance()};
+  ASSERT_TRUE(sDatabase.modify(_profileIdValue, [](Profile& ioProfile) {
+    ioProfile.updateDeposit(0.8);
+  }));
+
+  double sDeposit{};
+  const std::string* sFullName{};
+  ASSERT_TRUE(sDatabase.read(_profileIdValue, [&](const Profile& iProfile) {
+    sDeposit = iProfile.getDeposit();
+    sFullName = &iProfile.getFullName();
+  }));
+  EXPECT_EQ(sDeposit, std::get<double>(_testData["deposit"]) + 0.8);
+  // The visitor sees the stored record, not a copy of it.
+  ASSERT_TRUE(sDatabase.read(_profileIdValue, [&](const Profile& iProfile) {
+    EXPECT_EQ(&iProfile.getFullName(), sFullName);
+  }));
+
+  bool sIsVisited{};
+  EXPECT_FALSE(sDatabase.read(1, [&](const Profile&) { sIsVisited = true; }));
+  EXPECT_FALSE(sDatabase.modify(1, [&](Profile&) { sIsVisited = true; }));
+  EXPECT_FALSE(sIsVisited);
+}
+
+TEST_F(UserInMemoryDatabaseTest, ShouldTransferBetweenProfiles) {
+  InMemoryDatabase& sDatabase{InMemoryDatabase::GetInstance()};
+  const ProfileId sOtherId{
+      sDatabase.insert(Profile{"Other", 40, 0.5}).second.value()};
+
+  ASSERT_TRUE(
+      sDatabase.transfer(Transfer{_profileIdValue, sOtherId, 20000000}));
+  EXPECT_EQ(sDatabase.get(_profileIdValue).second->getSatoshiDeposit(),
+            100000000);
+  EXPECT_EQ(sDatabase.get(sOtherId).second->getSatoshiDeposit(), 70000000);
+
+  // The second transfer spends what the first one credits.
+  const std::vector<Transfer> sTransfers{
+      {sOtherId, _profileIdValue, 70000000},
+      {_profileIdValue, sOtherId, 170000000}};
+  ASSERT_TRUE(sDatabase.transferMany(sTransfers));
+  EXPECT_EQ(sDatabase.get(_profileIdValue).second->getSatoshiDeposit(), 0);
+  EXPECT_EQ(sDatabase.get(sOtherId).second->getSatoshiDeposit(), 170000000);
+}
+
+TEST_F(UserInMemoryDatabaseTest, ShouldRejectWholeBatchWhenTransferFails) {
+  InMemoryDatabase& sDatabase{InMemoryDatabase::GetInstance()};
+  const ProfileId sOtherId{
+      sDatabase.insert(Profile{"Other", 40, 0}).second.value()};
+
+  const std::vector<Transfer> sOverspending{{_profileIdValue, sOtherId, 100},
+                                            {sOtherId, _profileIdValue, 101}};
+  EXPECT_FALSE(sDatabase.transferMany(sOverspending));
+  const std::vector<Transfer> sUnknown{{_profileIdValue, sOtherId, 100},
+                                       {_profileIdValue, 1000, 100}};
+  EXPECT_FALSE(sDatabase.transferMany(sUnknown));
+
+  EXPECT_EQ(sDatabase.get(_profileIdValue).second->getSatoshiDeposit(),
+            120000000);
+  EXPECT_EQ(sDatabase.get(sOtherId).second->getSatoshiDeposit(), 0);
+}
+
+TEST_F(UserInMemoryDatabaseTest,
+       ShouldConserveDepositsUnderConcurrentTransfers) {
+  constexpr int kThreads{4}, kBatches{50};
+  InMemoryDatabase& sDatabase{InMemoryDatabase::GetInstance()};
+  const ProfileId sOtherId{
+      sDatabase.insert(Profile{"Other", 40, 1.2}).second.value()};
+
+  {
+    std::vector<std::jthread> sWorkers{};
+    for (int sThread{}; sThread < kThreads; ++sThread) {
+      // Half of the threads transfer one way, half the other way, so that
+      // both lock orders are requested.
+      const ProfileId sFrom{sThread % 2 ? sOtherId : _profileIdValue};
+      const ProfileId sTo{sThread % 2 ? _profileIdValue : sOtherId};
+      sWorkers.emplace_back([&sDatabase, sFrom, sTo] {
+        const std::vector<Transfer> sBatch(10, Transfer{sFrom, sTo, 1000});
+        for (int sIndex{}; sIndex < kBatches; ++sIndex) {
+          static_cast<void>(sDatabase.transferMany(sBatch));
+        }
+      });
+    }
+  }
+
+  EXPECT_EQ(sDatabase.get(_profileIdValue).second->getSatoshiDeposit() +
+                sDatabase.get(sOtherId).second->getSatoshiDeposit(),
+            240000000);
+}
+
+TEST_F(UserInMemoryDatabaseTest, ShouldInsertAndGetManyProfiles) {
+  constexpr std::size_t kProfiles{1000};
+  InMemoryDatabase& sDatabase{InMemoryDatabase::GetInstance()};
+  std::vector<Profile> sProfiles{};
+  for (std::size_t sIndex{}; sIndex < kProfiles; ++sIndex) {
+    sProfiles.emplace_back("User" + std::to_string(sIndex), 30, 1);
+  }
+  const std::pair<bool, std::optional<ProfileId>> sFirstId{
+      sDatabase.insertMany(std::move(sProfiles))};
+  ASSERT_TRUE(sFirstId.first);
+  EXPECT_EQ(sFirstId.second, _profileIdValue + 1);
+  EXPECT_EQ(sDatabase.insert(_profile).second, *sFirstId.second + kProfiles);
+
+  // Ids in reverse order, with unknown ones in between.
+  std::vector<ProfileId> sProfileIds{};
+  for (std::size_t sIndex{kProfiles}; sIndex-- > 0;) {
+    sProfileIds.push_back(*sFirstId.second + sIndex);
+    if (sIndex % 100 == 0) {
+      sProfileIds.push_back(1'000'000 + sIndex);
+    }
+  }
+  const std::vector<std::optional<Profile>> sRetrievedProfiles{
+      sDatabase.getMany(sProfileIds)};
+  ASSERT_EQ(sRetrievedProfiles.size(), sProfileIds.size());
+  for (std::size_t sIndex{}; sIndex < sProfileIds.size(); ++sIndex) {
+    if (sProfileIds[sIndex] >= 1'000'000) {
+      EXPECT_FALSE(sRetrievedProfiles[sIndex]);
+      continue;
+    }
+    ASSERT_TRUE(sRetrievedProfiles[sIndex]);
+    EXPECT_EQ(sRetrievedProfiles[sIndex]->getFullName(),
+              "User" + std::to_string(sProfileIds[sIndex] - *sFirstId.second));
+  }
+}
+
+TEST_F(UserInMemoryDatabaseTest, ShouldInsertEmptyBatchWithoutId) {
+  InMemoryDatabase& sDatabase{InMemoryDatabase::GetInstance()};
+  const std::pair<bool, std::optional<ProfileId>> sFirstId{
+      sDatabase.insertMany(std::vector<Profile>{})};
+  EXPECT_TRUE(sFirstId.first);
+  EXPECT_FALSE(sFirstId.second);
+  EXPECT_EQ(sDatabase.insert(_profile).second, _profileIdValue + 1);
+}
+
+TEST_F(UserInMemoryDatabaseTest, ShouldReadProfilesAsOfSnapshot) {
+  InMemoryDatabase& sDatabase{InMemoryDatabase::GetInstance()};
+  const ProfileId sRemovedId{
+      sDatabase.insert(Profile{"Removed", 40, 1}).second.value()};
+  const ProfileSnapshot sSnapshot{sDatabase.snapshot()};
+
+  ASSERT_TRUE(sDatabase.modify(
+      _profileIdValue, [](Profile& ioProfile) { ioProfile.updateDeposit(1); }));
+  ASSERT_TRUE(sDatabase.modify(
+      _profileIdValue, [](Profile& ioProfile) { ioProfile.updateDeposit(1); }));
+  ASSERT_TRUE(sDatabase.remove(sRemovedId));
+  const ProfileId sInsertedId{sDatabase.insert(_profile).second.value()};
+
+  EXPECT_EQ(sSnapshot.get(_profileIdValue)->getDeposit(),
+            std::get<double>(_testData["deposit"]));
+  EXPECT_EQ(sSnapshot.get(sRemovedId)->getFullName(), "Removed");
+  EXPECT_FALSE(sSnapshot.get(sInsertedId));
+  EXPECT_EQ(sDatabase.get(_profileIdValue).second->getDeposit(), 3.2);
+
+  std::map<ProfileId, std::string> sNames{};
+  sSnapshot.forEach([&sNames](const ProfileId iProfileId,
+                              const Profile& iProfile) {
+    EXPECT_TRUE(sNames.emplace(iProfileId, iProfile.getFullName()).second);
+  });
+  EXPECT_EQ(sNames, (std::map<ProfileId, std::string>{
+                        {_profileIdValue, _profile.getFullName()},
+                        {sRemovedId, "Removed"}}));
+}
+
+TEST_F(UserInMemoryDatabaseTest, ShouldReadReplacedProfileAsOfSnapshot) {
+  InMemoryDatabase& sDatabase{InMemoryDatabase::GetInstance()};
+  const ProfileSnapshot sSnapshot{sDatabase.snapshot()};
+  ASSERT_TRUE(sDatabase.update(_profileIdValue, Profile{"NewUser", 25, 1.5}));
+
+  const std::optional<Profile> sSnapshotProfile{
+      sSnapshot.get(_profileIdValue)};
+  ASSERT_TRUE(sSnapshotProfile);
+  EXPECT_EQ(sSnapshotProfile->getFullName(), _profile.getFullName());
+  EXPECT_EQ(sSnapshotProfile->getAge(), _profile.getAge());
+  EXPECT_EQ(sSnapshotProfile->getSatoshiDeposit(),
+            _profile.getSatoshiDeposit());
+  EXPECT_EQ(sDatabase.get(_profileIdValue).second->getFullName(), "NewUser");
+}
+
+TEST_F(UserInMemoryDatabaseTest, ShouldSeeConsistentSnapshotsUnderTransfers) {
+  constexpr int kProfiles{32};
+  InMemoryDatabase& sDatabase{InMemoryDatabase::GetInstance()};
+  ASSERT_TRUE(sDatabase.remove(_profileIdValue));
+  const ProfileId sFirstId{
+      sDatabase.insertMany(std::vector<Profile>(kProfiles, _profile))
+          .second.value()};
+  const std::int64_t sTotal{kProfiles * _profile.getSatoshiDeposit()};
+
+  std::atomic<bool> sIsDone{};
+  std::jthread sWriter{[&] {
+    for (ProfileId sIndex{}; !sIsDone; ++sIndex) {
+      const std::vector<Transfer> sBatch{
+          {sFirstId + sIndex % kProfiles, sFirstId + (sIndex + 5) % kProfiles,
+           1000},
+          {sFirstId + (sIndex + 7) % kProfiles,
+           sFirstId + (sIndex + 3) % kProfiles, 1000}};
+      static_cast<void>(sDatabase.transferMany(sBatch));
+    }
+  }};
+  for (int sScan{}; sScan < 50; ++sScan) {
+    const ProfileSnapshot sSnapshot{sDatabase.snapshot()};
+    std::int64_t sSum{};
+    int sCount{};
+    sSnapshot.forEach([&](ProfileId, const Profile& iProfile) {
+      sSum += iProfile.getSatoshiDeposit();
+      ++sCount;
+    });
+    EXPECT_EQ(sCount, kProfiles);
+    EXPECT_EQ(sSum, sTotal);
+  }
+  sIsDone = true;
+}
+
+TEST_F(UserInMemoryDatabaseTest, ShouldRecoverPersistedProfiles) {
+  const std::filesystem::path sDirectory{
+      std::filesystem::temp_directory_path() / "user_database_recovery"};
+  std::filesystem::remove_all(sDirectory);
+  InMemoryDatabase& sDatabase{InMemoryDatabase::GetInstance()};
+  ASSERT_TRUE(sDatabase.open(sDirectory, JournalOptions{1, 4}));
+  EXPECT_FALSE(sDatabase.get(_profileIdValue).first);
+
+  const ProfileId sFirstId{sDatabase.insert(_profile).second.value()};
+  const ProfileId sSecondId{
+      sDatabase.insert(Profile{"Other", 40, 0}).second.value()};
+  const ProfileId sRemovedId{sDatabase.insert(_profile).second.value()};
+  ASSERT_TRUE(sDatabase.transfer(Transfer{sFirstId, sSecondId, 20000000}));
+  ASSERT_TRUE(sDatabase.modify(
+      sSecondId, [](Profile& ioProfile) { ioProfile.updateDeposit(1); }));
+  ASSERT_TRUE(sDatabase.remove(sRemovedId));
+
+  // Reopening drops the profiles in memory and restores the persisted ones,
+  // from the snapshot taken after 4 changes and the log that follows it.
+  ASSERT_TRUE(sDatabase.open(sDirectory, JournalOptions{1, 4}));
+  EXPECT_EQ(sDatabase.get(sFirstId).second->getSatoshiDeposit(), 100000000);
+  EXPECT_EQ(sDatabase.get(sSecondId).second->getSatoshiDeposit(), 120000000);
+  EXPECT_EQ(sDatabase.get(sSecondId).second->getFullName(), "Other");
+  EXPECT_FALSE(sDatabase.get(sRemovedId).first);
+  EXPECT_GT(sDatabase.insert(_profile).second.value(), sRemovedId);
+  std::filesystem::remove_all(sDirectory);
+}
+
+TEST_F(UserInMemoryDatabaseTest, ShouldKeepProfileWhenUpdateIsNotJournaled) {
+  const std::filesystem::path sDirectory{
+      std::filesystem::temp_directory_path() / "user_database_failed_update"};
+  std::filesystem::remove_all(sDirectory);
+  InMemoryDatabase& sDatabase{InMemoryDatabase::GetInstance()};
+  ASSERT_TRUE(sDatabase.open(sDirectory, JournalOptions{1, 1}));
+  // The log started by the first snapshot cannot be written to.
+  std::filesystem::create_symlink("/dev/full",
+                                  sDirectory / "log-0000000001.dat");
+  const ProfileId sProfileId{sDatabase.insert(_profile).second.value()};
+
+  EXPECT_FALSE(sDatabase.update(sProfileId, Profile{"NewUser", 25, 1.5}));
+  const Profile sProfile{sDatabase.get(sProfileId).second.value()};
+  EXPECT_EQ(sProfile.getFullName(), _profile.getFullName());
+  EXPECT_EQ(sProfile.getAge(), _profile.getAge());
+  EXPECT_EQ(sProfile.getSatoshiDeposit(), _profile.getSatoshiDeposit());
+
+  // Leave the database on a journal that accepts changes.
+  ASSERT_TRUE(sDatabase.open(sDirectory / "reopened"));
+  std::filesystem::remove_all(sDirectory);
+}
+
+TEST_F(UserInMemoryDatabaseTest, ShouldKeepProfilesConsistentUnderConcurrency) {
+  constexpr int kThreads{4}, kProfiles{200};
+  std::vector<std::vector<ProfileId>> sProfileIds(kThreads);
+  {
+    std::vector<std::jthread> sWorkers{};
+    for (int sThread{}; sThread < kThreads; ++sThread) {
+      sWorkers.emplace_back([this, &sProfileIds, sThread] {
+        InMemoryDatabase& sDatabase{InMemoryDatabase::GetInstance()};
+        for (int sIndex{}; sIndex < kProfiles; ++sIndex) {
+          const ProfileId sProfileId{
+              sDatabase.insert(_profile).second.value()};
+          sProfileIds[sThread].push_back(sProfileId);
+          ASSERT_TRUE(sDatabase.update(
+              sProfileId, Profile{"User" + std::to_string(sThread), 30, 2}));
+          ASSERT_TRUE(sDatabase.get(_profileIdValue).first);
+        }
+      });
+    }
+  }
+
+  std::set<ProfileId> sUniqueIds{_profileIdValue};
+  for (int sThread{}; sThread < kThreads; ++sThread) {
+    for (const ProfileId sProfileId : sProfileIds[sThread]) {
+      sUniqueIds.insert(sProfileId);
+      EXPECT_EQ(InMemoryDatabase::GetInstance()
+                    .get(sProfileId)
+                    .second.value()
+                    .getFullName(),
+                "User" + std::to_string(sThread));
+    }
+  }
+  EXPECT_EQ(sUniqueIds.size(), kThreads * kProfiles + 1);
+}
 } // namespace tests
 } // namespace user
\ No newline at end of file
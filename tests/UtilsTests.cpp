@@ -1,11 +1,29 @@
 // author: georgiosmatzarapis
 
+#include <arpa/inet.h>
 #include <cstring>
+#include <ctime>
+#include <fstream>
 #include <gtest/gtest.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
 
+#include "BloomFilter.hpp"
+#include "ByteStream.hpp"
+#include "Checksum.hpp"
 #include "Hmac.hpp"
+#include "LogDecoder.hpp"
+#include "LogThrottle.hpp"
+#include "Logger.hpp"
+#include "Metrics.hpp"
+#include "MpscQueue.hpp"
+#include "MpscRingBuffer.hpp"
 #include "OpenSslApi.hpp"
 #include "OpenSslApiMock.hpp"
+#include "Tracing.hpp"
 
 namespace utils {
 namespace tests {
@@ -120,5 +138,372 @@ TEST_F(HmacItTest, ShouldDigestBeNullWhenDigestFinalDoesNotReturnOne) {
   ASSERT_FALSE(_digest);
 }
 
+// Crc32c
+
+TEST(Crc32cTest, ShouldMatchKnownCheckValue) {
+  const std::string sMessage{"123456789"};
+  ASSERT_EQ(Crc32c(sMessage.data(), sMessage.size()), 0xE3069283);
+}
+
+TEST(Crc32cTest, ShouldComputeSameChecksumWhenDataIsChunked) {
+  const std::string sMessage{"dummyTextOne"};
+  const std::uint32_t sFirstChunk{Crc32c(sMessage.data(), 5)};
+  ASSERT_EQ(Crc32c(sMessage.data() + 5, sMessage.size() - 5, sFirstChunk),
+            Crc32c(sMessage.data(), sMessage.size()));
+}
+
+// ByteWriter / ByteReader
+
+TEST(ByteStreamTest, ShouldReadBackWrittenValues) {
+  ByteWriter sWriter{};
+  sWriter.putU8(7);
+  sWriter.putU32(0xDEADBEEF);
+  sWriter.putI64(-42);
+  sWriter.putF64(1.25);
+  sWriter.putString("dummyText");
+
+  ByteReader sReader{sWriter.buffer()};
+  std::uint8_t sU8{};
+  std::uint32_t sU32{};
+  std::int64_t sI64{};
+  double sF64{};
+  std::string sString{};
+  ASSERT_TRUE(sReader.getU8(sU8) && sReader.getU32(sU32) &&
+              sReader.getI64(sI64) && sReader.getF64(sF64) &&
+              sReader.getString(sString));
+  EXPECT_EQ(sU8, 7);
+  EXPECT_EQ(sU32, 0xDEADBEEF);
+  EXPECT_EQ(sI64, -42);
+  EXPECT_EQ(sF64, 1.25);
+  EXPECT_EQ(sString, "dummyText");
+  EXPECT_EQ(sReader.remaining(), 0);
+}
+
+TEST(ByteStreamTest, ShouldReadBackVarints) {
+  ByteWriter sWriter{};
+  for (const std::uint64_t sValue : {0ULL, 127ULL, 128ULL, ~0ULL}) {
+    sWriter.putVarU64(sValue);
+  }
+  EXPECT_EQ(sWriter.size(), 1 + 1 + 2 + 10);
+
+  ByteReader sReader{sWriter.buffer()};
+  for (const std::uint64_t sExpected : {0ULL, 127ULL, 128ULL, ~0ULL}) {
+    std::uint64_t sValue{};
+    ASSERT_TRUE(sReader.getVarU64(sValue));
+    EXPECT_EQ(sValue, sExpected);
+  }
+  ByteWriter sSigned{};
+  sSigned.putVarI64(-1);
+  sSigned.putVarI64(-65);
+  EXPECT_EQ(sSigned.size(), 1 + 2);
+  ByteReader sSignedReader{sSigned.buffer()};
+  std::int64_t sSignedValue{};
+  ASSERT_TRUE(sSignedReader.getVarI64(sSignedValue));
+  EXPECT_EQ(sSignedValue, -1);
+  ASSERT_TRUE(sSignedReader.getVarI64(sSignedValue));
+  EXPECT_EQ(sSignedValue, -65);
+
+  std::uint64_t sValue{};
+  ByteReader sTruncated{std::string_view{"\x80", 1}};
+  EXPECT_FALSE(sTruncated.getVarU64(sValue));
+}
+
+TEST(ByteStreamTest, ShouldFailWhenBufferIsTooShort) {
+  ByteWriter sWriter{};
+  sWriter.putString("dummyText");
+  const std::string sTruncated{sWriter.buffer().substr(0, 6)};
+
+  ByteReader sReader{sTruncated};
+  std::string sString{};
+  std::uint64_t sU64{};
+  ASSERT_FALSE(sReader.getString(sString));
+  ASSERT_FALSE(sReader.getU64(sU64));
+  EXPECT_EQ(sReader.position(), 0);
+}
+
+TEST(MpscQueueTest, ShouldDeliverEveryElementInProducerOrder) {
+  constexpr int kProducers{4}, kElements{10000};
+  MpscQueue<std::pair<int, int>> sQueue{};
+  {
+    std::vector<std::jthread> sProducers{};
+    for (int sProducer{}; sProducer < kProducers; ++sProducer) {
+      sProducers.emplace_back([&sQueue, sProducer] {
+        for (int sElement{}; sElement < kElements; ++sElement) {
+          sQueue.push({sProducer, sElement});
+        }
+      });
+    }
+  }
+
+  std::vector<int> sNextElements(kProducers, 0);
+  while (std::optional<std::pair<int, int>> sValue{sQueue.pop()}) {
+    ASSERT_EQ(sValue->second, sNextElements[sValue->first]++);
+  }
+  for (const int sNextElement : sNextElements) {
+    EXPECT_EQ(sNextElement, kElements);
+  }
+}
+
+TEST(MpscRingBufferTest, ShouldRejectElementsWhenFull) {
+  MpscRingBuffer<int> sRing{3};
+  ASSERT_EQ(sRing.getCapacity(), 4);
+  for (int sElement{}; sElement < 4; ++sElement) {
+    ASSERT_TRUE(sRing.tryPush(int{sElement}));
+  }
+  EXPECT_FALSE(sRing.tryPush(4));
+
+  EXPECT_EQ(sRing.pop(), 0);
+  EXPECT_TRUE(sRing.tryPush(4));
+  for (int sElement{1}; sElement <= 4; ++sElement) {
+    EXPECT_EQ(sRing.pop(), sElement);
+  }
+  EXPECT_FALSE(sRing.pop());
+}
+
+TEST(MpscRingBufferTest, ShouldDeliverEveryElementInProducerOrder) {
+  constexpr int kProducers{4}, kElements{10000};
+  MpscRingBuffer<std::pair<int, int>> sRing{64};
+  std::vector<int> sNextElements(kProducers, 0);
+  {
+    std::vector<std::jthread> sProducers{};
+    for (int sProducer{}; sProducer < kProducers; ++sProducer) {
+      sProducers.emplace_back([&sRing, sProducer] {
+        for (int sElement{}; sElement < kElements; ++sElement) {
+          while (!sRing.tryPush({sProducer, sElement})) {
+            std::this_thread::yield();
+          }
+        }
+      });
+    }
+
+    for (int sReceived{}; sReceived < kProducers * kElements;) {
+      if (std::optional<std::pair<int, int>> sValue{sRing.pop()}) {
+        ASSERT_EQ(sValue->second, sNextElements[sValue->first]++);
+        ++sReceived;
+      }
+    }
+  }
+  EXPECT_FALSE(sRing.pop());
+}
+
+/**
+ * @brief Read the log file of the current day with the given extension.
+ */
+static std::string ReadDailyLog(const std::string& iExtension) {
+  const std::time_t sNow{std::time(nullptr)};
+  char sDate[9]{};
+  std::strftime(sDate, sizeof(sDate), "%Y%m%d", std::localtime(&sNow));
+  std::ifstream sFile{std::string{"../../logs/"} + sDate + iExtension,
+                      std::ios::binary};
+  std::ostringstream sContent{};
+  sContent << sFile.rdbuf();
+  return sContent.str();
+}
+
+static std::string UniqueMessage(const std::string& iPrefix) {
+  return iPrefix + std::to_string(std::chrono::steady_clock::now()
+                                      .time_since_epoch()
+                                      .count());
+}
+
+TEST(LogTest, ShouldWriteQueuedRecordsOnFlush) {
+  const std::string sMessage{UniqueMessage("flush-")};
+  const Log& sLog{Log::GetInstance()};
+  sLog.toFile(LogLevel::INFO, sMessage, __PRETTY_FUNCTION__);
+  sLog.flush();
+
+  EXPECT_NE(ReadDailyLog(".log").find(sMessage + '\n'), std::string::npos);
+}
+
+TEST(LogTest, ShouldDecodeStructuredRecords) {
+  const std::string sMarker{UniqueMessage("structured-")};
+  LOG_STRUCTURED(LogLevel::WARNING, "{}: {} {} {} {}", sMarker, -5, 7U, true,
+                 0.5);
+  LOG_STRUCTURED(LogLevel::WARNING, "{}: no arguments", sMarker.c_str());
+  Log::GetInstance().flush();
+
+  std::ostringstream sText{};
+  ASSERT_TRUE(DecodeLog(ReadDailyLog(".blog"), sText));
+  EXPECT_NE(sText.str().find(" | WARNING | "), std::string::npos);
+  EXPECT_NE(sText.str().find(sMarker + ": -5 7 true 0.5\n"),
+            std::string::npos);
+  EXPECT_NE(sText.str().find(sMarker + ": no arguments\n"), std::string::npos);
+}
+
+TEST(LogTest, ShouldRenderMissingAndTruncatedArguments) {
+  EXPECT_EQ(RenderLogMessage("{} and {}", "s\x03" "abc"), "abc and {}");
+  // The string argument claims more characters than there are.
+  EXPECT_EQ(RenderLogMessage("{} and {}", "s\x05" "ab"), "{} and {}");
+}
+
+TEST(LogTest, ShouldNotEvaluateMessagesOfDisabledLevels) {
+  Log& sLog{Log::GetInstance()};
+  int sEvaluations{};
+  const auto sMessage{[&sEvaluations] {
+    ++sEvaluations;
+    return std::string{"evaluated"};
+  }};
+
+  sLog.setMinimumLevel(LogLevel::WARNING);
+  LOG_TO_FILE(LogLevel::INFO, sMessage());
+  EXPECT_EQ(sEvaluations, 0);
+  LOG_TO_FILE(LogLevel::WARNING, sMessage());
+  EXPECT_EQ(sEvaluations, 1);
+
+  sLog.setMinimumLevel(LogLevel::DEBUG);
+  LOG_TO_FILE(LogLevel::DEBUG, sMessage());
+  EXPECT_EQ(sEvaluations,
+            kCompiledLogLevel == LogLevel::DEBUG ? 2 : 1);
+  sLog.setMinimumLevel(kCompiledLogLevel);
+}
+
+TEST(LogThrottleTest, ShouldReportSuppressedRecordsOnceIntervalEnds) {
+  LogThrottle sThrottle{
+      LogThrottlePolicy{2, std::chrono::milliseconds{50}, 0}};
+  std::uint64_t sSuppressed{};
+  EXPECT_TRUE(sThrottle.tryAcquire(sSuppressed));
+  EXPECT_TRUE(sThrottle.tryAcquire(sSuppressed));
+  EXPECT_EQ(sSuppressed, 0);
+  for (int sRecord{}; sRecord < 5; ++sRecord) {
+    EXPECT_FALSE(sThrottle.tryAcquire(sSuppressed));
+  }
+
+  std::this_thread::sleep_for(std::chrono::milliseconds{60});
+  EXPECT_TRUE(sThrottle.tryAcquire(sSuppressed));
+  EXPECT_EQ(sSuppressed, 5);
+}
+
+TEST(LogThrottleTest, ShouldSampleRecordsBeyondBurst) {
+  LogThrottle sThrottle{LogThrottlePolicy{1, std::chrono::hours{1}, 10}};
+  std::uint64_t sSuppressed{};
+  int sLogged{};
+  for (int sRecord{}; sRecord < 101; ++sRecord) {
+    sLogged += sThrottle.tryAcquire(sSuppressed);
+  }
+  // The burst, then one in ten of the 100 remaining records.
+  EXPECT_EQ(sLogged, 11);
+  EXPECT_EQ(sSuppressed, 9);
+}
+
+TEST(HistogramTest, ShouldBoundRelativeErrorOfQuantiles) {
+  Histogram sHistogram{};
+  for (std::uint64_t sValue{1}; sValue <= 100000; ++sValue) {
+    sHistogram.record(sValue);
+  }
+  EXPECT_EQ(sHistogram.getCount(), 100000);
+  EXPECT_EQ(sHistogram.getSum(), std::uint64_t{100000} * 100001 / 2);
+  for (const double sQuantile : {0.5, 0.9, 0.99}) {
+    const double sExpected{sQuantile * 100000};
+    EXPECT_NEAR(static_cast<double>(sHistogram.getQuantile(sQuantile)),
+                sExpected, sExpected / Histogram::kSubBuckets);
+  }
+
+  for (std::uint64_t sValue : {std::uint64_t{0}, std::uint64_t{15},
+                               std::uint64_t{16}, std::uint64_t{1000003}}) {
+    const std::size_t sBucket{Histogram::GetBucket(sValue)};
+    EXPECT_GE(Histogram::GetBucketUpperBound(sBucket), sValue);
+    EXPECT_TRUE(sBucket == 0 ||
+                Histogram::GetBucketUpperBound(sBucket - 1) < sValue);
+  }
+}
+
+TEST(MetricsRegistryTest, ShouldExportPrometheusText) {
+  MetricsRegistry& sRegistry{MetricsRegistry::GetInstance()};
+  Counter& sCounter{sRegistry.counter("test_events_total", "Test events.",
+                                      "kind=\"a\"")};
+  Histogram& sHistogram{sRegistry.histogram("test_duration_seconds",
+                                            "Test duration.", "", 1e-9)};
+  sCounter.add(3);
+  EXPECT_EQ(&sCounter, &sRegistry.counter("test_events_total", "Test events.",
+                                          "kind=\"a\""));
+  sHistogram.record(2000000000);
+
+  const std::string sText{sRegistry.toPrometheus()};
+  EXPECT_NE(sText.find("# TYPE test_events_total counter\n"
+                       "test_events_total{kind=\"a\"} 3\n"),
+            std::string::npos);
+  EXPECT_NE(sText.find("# TYPE test_duration_seconds summary\n"),
+            std::string::npos);
+  EXPECT_NE(sText.find("test_duration_seconds_sum 2\n"), std::string::npos);
+  EXPECT_NE(sText.find("test_duration_seconds_count 1\n"), std::string::npos);
+}
+
+TEST(MetricsRegistryTest, ShouldServeMetricsOnLoopback) {
+  MetricsRegistry& sRegistry{MetricsRegistry::GetInstance()};
+  sRegistry.counter("test_requests_total", "Test requests.").add();
+  const MetricsEndpoint sEndpoint{sRegistry};
+
+  const int sSocket{::socket(AF_INET, SOCK_STREAM, 0)};
+  ASSERT_GE(sSocket, 0);
+  sockaddr_in sAddress{};
+  sAddress.sin_family = AF_INET;
+  sAddress.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  sAddress.sin_port = htons(sEndpoint.getPort());
+  ASSERT_EQ(::connect(sSocket, reinterpret_cast<const sockaddr*>(&sAddress),
+                      sizeof(sAddress)),
+            0);
+  const std::string sRequest{"GET /metrics HTTP/1.1\r\n\r\n"};
+  ASSERT_EQ(::send(sSocket, sRequest.data(), sRequest.size(), 0),
+            static_cast<ssize_t>(sRequest.size()));
+
+  std::string sResponse{};
+  char sBuffer[1024]{};
+  for (ssize_t sReceived{}; (sReceived = ::recv(sSocket, sBuffer,
+                                                 sizeof(sBuffer), 0)) > 0;) {
+    sResponse.append(sBuffer, static_cast<std::size_t>(sReceived));
+  }
+  ::close(sSocket);
+  EXPECT_TRUE(sResponse.starts_with("HTTP/1.1 200 OK\r\n"));
+  EXPECT_NE(sResponse.find("test_requests_total 1\n"), std::string::npos);
+}
+
+TEST(TracerTest, ShouldExportNestedSpansPerThread) {
+  Tracer& sTracer{Tracer::GetInstance()};
+  { const TraceSpan sIgnored{"ignored"}; }
+
+  sTracer.setEnabled(true);
+  {
+    const TraceSpan sOuter{"outer"};
+    const TraceSpan sInner{"inner"};
+  }
+  std::jthread{[] { const TraceSpan sOther{"other"}; }}.join();
+  sTracer.setEnabled(false);
+
+  const std::string sJson{sTracer.toJson()};
+  EXPECT_TRUE(sJson.starts_with("{\"displayTimeUnit\":\"ns\","
+                                "\"traceEvents\":["));
+  EXPECT_EQ(sJson.find("\"ignored\""), std::string::npos);
+  EXPECT_NE(sJson.find("{\"name\":\"inner\",\"ph\":\"X\""),
+            std::string::npos);
+  EXPECT_NE(sJson.find("\"tid\":1,\"args\":{\"depth\":1}"),
+            std::string::npos);
+  EXPECT_NE(sJson.find("\"tid\":1,\"args\":{\"depth\":0}"),
+            std::string::npos);
+  EXPECT_NE(sJson.find("\"tid\":2,\"args\":{\"depth\":0}"),
+            std::string::npos);
+
+  sTracer.clear();
+  EXPECT_EQ(sTracer.toJson().find("\"ph\":\"X\""), std::string::npos);
+}
+
+TEST(BloomFilterTest, ShouldFindAddedKeysAndRejectMostOthers) {
+  constexpr std::uint64_t kKeys{10000};
+  BloomFilter sFilter{kKeys, 0.01};
+  for (std::uint64_t sKey{}; sKey < kKeys; ++sKey) {
+    sFilter.add(sKey);
+  }
+  for (std::uint64_t sKey{}; sKey < kKeys; ++sKey) {
+    ASSERT_TRUE(sFilter.mayContain(sKey));
+  }
+  std::uint64_t sFalsePositives{};
+  for (std::uint64_t sKey{kKeys}; sKey < 2 * kKeys; ++sKey) {
+    sFalsePositives += sFilter.mayContain(sKey);
+  }
+  EXPECT_LT(sFalsePositives, kKeys / 50);
+
+  sFilter.clear();
+  EXPECT_FALSE(sFilter.mayContain(0));
+}
+
 } // namespace tests
 } // namespace utils
\ No newline at end of file
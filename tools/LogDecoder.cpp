@@ -0,0 +1,39 @@
+// author: georgiosmatzarapis
+
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+#include "LogDecoder.hpp"
+
+/**
+ * @brief Render binary log files (.blog) as text, in the layout of the text
+ * log files.
+ * Usage: log_decoder <file>...
+ */
+int main(int argc, char* argv[]) {
+  if (argc < 2) {
+    std::cerr << "Usage: " << argv[0] << " <file>..." << std::endl;
+    return 1;
+  }
+
+  int aStatus{};
+  for (int aIndex{1}; aIndex < argc; ++aIndex) {
+    std::ifstream aFile{argv[aIndex], std::ios::binary};
+    if (!aFile) {
+      std::cerr << argv[aIndex] << ": cannot be opened." << std::endl;
+      aStatus = 1;
+      continue;
+    }
+    std::ostringstream aBytes{};
+    aBytes << aFile.rdbuf();
+
+    const std::expected<std::uint64_t, std::string> aDecoded{
+        utils::DecodeLog(aBytes.view(), std::cout)};
+    if (!aDecoded) {
+      std::cerr << argv[aIndex] << ": " << aDecoded.error() << std::endl;
+      aStatus = 1;
+    }
+  }
+  return aStatus;
+}
@@ -0,0 +1,58 @@
+// author: georgiosmatzarapis
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+namespace utils {
+/**
+ * @brief Blocked Bloom filter over 64-bit key hashes.
+ * Every key maps to a single cache line, so that a query touches one line
+ * whatever the number of probes. The filter may report false positives, never
+ * false negatives, and does not support removal.
+ */
+class BloomFilter {
+ public:
+  /**
+   * @param expectedItems Number of keys the filter is sized for.
+   * @param falsePositiveRate Target false positive rate once expectedItems
+   * keys are added, in ]0, 1[.
+   */
+  BloomFilter(const std::size_t expectedItems, const double falsePositiveRate);
+
+  /**
+   * @brief Key of a digest, e.g. a transaction hash. The first bytes of a
+   * digest are already uniformly distributed, so they are used as they are.
+   */
+  [[nodiscard]] static std::uint64_t DigestKey(std::string_view iDigest);
+
+  /**
+   * @param iHash 64-bit hash of the key, e.g. a prefix of a digest.
+   */
+  void add(const std::uint64_t iHash);
+  /**
+   * @param iHash 64-bit hash of the key, e.g. a prefix of a digest.
+   * @return false if the key was never added, true if it probably was.
+   */
+  [[nodiscard]] bool mayContain(const std::uint64_t iHash) const;
+  void clear();
+
+  /**
+   * @return Size of the filter, in bytes.
+   */
+  [[nodiscard]] std::size_t getBytes() const;
+
+ private:
+  static constexpr std::size_t kWordsPerBlock{8};
+
+  struct alignas(64) Block {
+    std::uint64_t words[kWordsPerBlock]{};
+  };
+
+  std::vector<Block> _blocks{};
+  std::uint32_t _probes{};
+};
+} // namespace utils
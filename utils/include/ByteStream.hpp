@@ -0,0 +1,92 @@
+// author: georgiosmatzarapis
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace utils {
+/**
+ * @brief Append fixed-width little-endian values to a byte buffer.
+ * Shared by the on-disk and wire formats so that they agree on byte order.
+ */
+class ByteWriter {
+ public:
+  ByteWriter();
+  explicit ByteWriter(const std::size_t iReserve);
+  /**
+   * @brief Append to an existing buffer, handed back by take.
+   */
+  explicit ByteWriter(std::string&& ioBuffer);
+
+  void putU8(const std::uint8_t iValue);
+  void putU16(const std::uint16_t iValue);
+  void putU32(const std::uint32_t iValue);
+  void putU64(const std::uint64_t iValue);
+  void putI64(const std::int64_t iValue);
+  void putF64(const double iValue);
+  /**
+   * @brief Append an unsigned value as a LEB128 varint, 1 byte per 7 bits.
+   */
+  void putVarU64(const std::uint64_t iValue);
+  /**
+   * @brief Append a signed value as a zigzag varint, so that values close to
+   * zero take few bytes whatever their sign.
+   */
+  void putVarI64(const std::int64_t iValue);
+  /**
+   * @brief Append a string prefixed with its 32-bit length.
+   */
+  void putString(std::string_view iValue);
+  /**
+   * @brief Append raw bytes, without any length prefix.
+   */
+  void putBytes(std::string_view iValue);
+
+  [[nodiscard]] std::size_t size() const;
+  [[nodiscard]] const std::string& buffer() const;
+  [[nodiscard]] std::string take();
+
+ private:
+  std::string _buffer{};
+};
+
+/**
+ * @brief Read values written by ByteWriter, with bounds checking.
+ * Every getter returns false, leaving the value untouched, if the buffer is
+ * too short.
+ */
+class ByteReader {
+ public:
+  explicit ByteReader(std::string_view iBuffer);
+
+  bool getU8(std::uint8_t& ioValue);
+  bool getU16(std::uint16_t& ioValue);
+  bool getU32(std::uint32_t& ioValue);
+  bool getU64(std::uint64_t& ioValue);
+  bool getI64(std::int64_t& ioValue);
+  bool getF64(double& ioValue);
+  bool getVarU64(std::uint64_t& ioValue);
+  bool getVarI64(std::int64_t& ioValue);
+  bool getString(std::string& ioValue);
+  /**
+   * @brief View a length-prefixed string without copying it.
+   */
+  bool getStringView(std::string_view& ioValue);
+  /**
+   * @brief View the next iSize raw bytes without copying them.
+   */
+  bool getBytes(const std::size_t iSize, std::string_view& ioValue);
+
+  [[nodiscard]] std::size_t position() const;
+  [[nodiscard]] std::size_t remaining() const;
+
+ private:
+  std::string_view _buffer{};
+  std::size_t _position{};
+
+  template <class Unsigned>
+  bool getUnsigned(Unsigned& ioValue);
+};
+} // namespace utils
@@ -0,0 +1,19 @@
+// author: georgiosmatzarapis
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace utils {
+/**
+ * @brief Compute the CRC-32C (Castagnoli) checksum of a buffer.
+ * Used to detect torn or corrupted records in on-disk files.
+ * @param iData Buffer to checksum.
+ * @param iSize Size of the buffer.
+ * @param iSeed Checksum of the preceding bytes, to checksum data in chunks.
+ * @return Checksum value.
+ */
+std::uint32_t Crc32c(const void* iData, const std::size_t iSize,
+                     const std::uint32_t iSeed = 0);
+} // namespace utils
@@ -0,0 +1,35 @@
+// author: georgiosmatzarapis
+
+#pragma once
+
+#include <cstdint>
+#include <expected>
+#include <ostream>
+#include <string>
+#include <string_view>
+
+namespace utils {
+
+/**
+ * @brief Entries of a binary log file. A FORMAT entry (varint id, u8 level,
+ * function and format strings) precedes the first RECORD entry of its call
+ * site (varint id, i64 nanoseconds since the epoch, u64 thread id, argument
+ * bytes), all encoded with ByteWriter.
+ */
+enum class LogEntry : std::uint8_t { FORMAT = 1, RECORD = 2 };
+
+/**
+ * @brief Substitute encoded arguments for the {} placeholders of a format, in
+ * order. Placeholders left without argument are kept as they are.
+ */
+std::string RenderLogMessage(std::string_view iFormat,
+                             std::string_view iArguments);
+
+/**
+ * @brief Render the entries of a binary log file as lines of the text log.
+ * @return Number of rendered records, otherwise the reason of the failure,
+ * once the records preceding the invalid entry are rendered.
+ */
+std::expected<std::uint64_t, std::string> DecodeLog(std::string_view iBytes,
+                                                    std::ostream& ioOutput);
+} // namespace utils
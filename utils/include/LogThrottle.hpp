@@ -0,0 +1,75 @@
+// author: georgiosmatzarapis
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <limits>
+
+namespace utils {
+
+struct LogThrottlePolicy {
+  /** Records logged in full per interval. */
+  std::uint32_t burst{};
+  std::chrono::steady_clock::duration interval{};
+  /**
+   * Once the burst is spent, one in sampleRate records is still logged until
+   * the interval ends. A value of 0 suppresses them all.
+   */
+  std::uint32_t sampleRate{};
+};
+
+/**
+ * @brief Rate limiter and sampler of the records of one call site, so that a
+ * flood of similar records cannot make logging dominate the work that causes
+ * them. The records it suppresses are counted, for the next logged record to
+ * report them.
+ * Safe to use from any thread.
+ */
+class LogThrottle {
+ public:
+  explicit constexpr LogThrottle(const LogThrottlePolicy& policy)
+      : _policy{policy} {}
+
+  LogThrottle(const LogThrottle&) = delete;
+  LogThrottle& operator=(const LogThrottle&) = delete;
+  LogThrottle(LogThrottle&&) noexcept = delete;
+  LogThrottle& operator=(LogThrottle&&) noexcept = delete;
+
+  /**
+   * @brief Decide whether the next record of the call site is logged.
+   * @param ioSuppressed Set, if it is, to the number of records suppressed
+   * since the last logged one.
+   * @return Whether the record is logged.
+   */
+  bool tryAcquire(std::uint64_t& ioSuppressed) {
+    const std::int64_t aNow{
+        std::chrono::steady_clock::now().time_since_epoch().count()};
+    std::int64_t aWindowStart{_windowStart.load(std::memory_order_relaxed)};
+    if (aNow - aWindowStart >= _policy.interval.count() &&
+        _windowStart.compare_exchange_strong(aWindowStart, aNow,
+                                             std::memory_order_relaxed)) {
+      _count.store(0, std::memory_order_relaxed);
+    }
+
+    const std::uint64_t aCount{_count.fetch_add(1, std::memory_order_relaxed)};
+    if (aCount >= _policy.burst &&
+        (_policy.sampleRate == 0 ||
+         (aCount - _policy.burst) % _policy.sampleRate != 0)) {
+      _suppressed.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    }
+    ioSuppressed = _suppressed.exchange(0, std::memory_order_relaxed);
+    return true;
+  }
+
+ private:
+  const LogThrottlePolicy _policy{};
+  /** Start of the current interval, in steady clock ticks. */
+  std::atomic<std::int64_t> _windowStart{
+      std::numeric_limits<std::int64_t>::min() / 2};
+  std::atomic<std::uint64_t> _count{};
+  std::atomic<std::uint64_t> _suppressed{};
+};
+} // namespace utils
@@ -2,12 +2,157 @@
 
 #pragma once
 
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
 #include <iostream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+#include <unordered_map>
+
+#include "LogThrottle.hpp"
+#include "MpscRingBuffer.hpp"
 
 namespace utils {
 
-enum class LogLevel { INFO, DEBUG, WARNING, ERROR, FATAL };
+/** Ordered by increasing severity. */
+enum class LogLevel { DEBUG, INFO, WARNING, ERROR, FATAL };
+
+/**
+ * @return Name of the level, as written in log lines.
+ */
+std::string_view GetLogLevelName(const LogLevel iLogLevel);
+
+/**
+ * Least severe level compiled into the binary: debug records are left out of
+ * release (NDEBUG) builds.
+ */
+#ifdef NDEBUG
+inline constexpr LogLevel kCompiledLogLevel{LogLevel::INFO};
+#else
+inline constexpr LogLevel kCompiledLogLevel{LogLevel::DEBUG};
+#endif
+
+/**
+ * @brief Queue a record for the log file, unless its level is compiled out or
+ * below the runtime minimum, in which case the message is not evaluated at
+ * all. The level must be a constant expression.
+ */
+#define LOG_TO_FILE(iLogLevel, iMessage)                                       \
+  do {                                                                         \
+    if constexpr ((iLogLevel) >= ::utils::kCompiledLogLevel) {                 \
+      if (const ::utils::Log& sLogger{::utils::Log::GetInstance()};            \
+          sLogger.isEnabled(iLogLevel)) {                                      \
+        sLogger.toFile((iLogLevel), (iMessage), __PRETTY_FUNCTION__);          \
+      }                                                                        \
+    }                                                                          \
+  } while (false)
+
+/**
+ * @brief Queue a structured record for the binary log file. The format, with
+ * a {} placeholder per argument, and the calling function are stored once per
+ * call site; only the raw arguments are captured, and text is rendered
+ * offline by the log decoder. Disabled levels cost nothing, as LOG_TO_FILE.
+ */
+#define LOG_STRUCTURED(iLogLevel, iFormat, ...)                                \
+  do {                                                                         \
+    if constexpr ((iLogLevel) >= ::utils::kCompiledLogLevel) {                 \
+      static constexpr ::utils::LogFormat kLogFormat{(iLogLevel), (iFormat),   \
+                                                     __PRETTY_FUNCTION__};     \
+      if (const ::utils::Log& sLogger{::utils::Log::GetInstance()};            \
+          sLogger.isEnabled(iLogLevel)) {                                      \
+        sLogger.toBinaryFile(kLogFormat __VA_OPT__(, ) __VA_ARGS__);           \
+      }                                                                        \
+    }                                                                          \
+  } while (false)
+
+/**
+ * @brief LOG_TO_FILE, throttled per call site by a LogThrottlePolicy constant.
+ * Suppressed records are reported by a summary record preceding the next one
+ * that is logged.
+ */
+#define LOG_TO_FILE_THROTTLED(iLogLevel, iPolicy, iMessage)                    \
+  do {                                                                         \
+    if constexpr ((iLogLevel) >= ::utils::kCompiledLogLevel) {                 \
+      static ::utils::LogThrottle sLogThrottle{iPolicy};                       \
+      if (const ::utils::Log& sLogger{::utils::Log::GetInstance()};            \
+          sLogger.isEnabled(iLogLevel)) {                                      \
+        if (std::uint64_t sSuppressed{};                                       \
+            sLogThrottle.tryAcquire(sSuppressed)) {                            \
+          if (sSuppressed > 0) {                                               \
+            sLogger.toFile((iLogLevel),                                        \
+                           std::to_string(sSuppressed) +                       \
+                               " similar message(s) suppressed",               \
+                           __PRETTY_FUNCTION__);                               \
+          }                                                                    \
+          sLogger.toFile((iLogLevel), (iMessage), __PRETTY_FUNCTION__);        \
+        }                                                                      \
+      }                                                                        \
+    }                                                                          \
+  } while (false)
+
+/**
+ * @brief LOG_STRUCTURED, throttled as LOG_TO_FILE_THROTTLED.
+ */
+#define LOG_STRUCTURED_THROTTLED(iLogLevel, iPolicy, iFormat, ...)             \
+  do {                                                                         \
+    if constexpr ((iLogLevel) >= ::utils::kCompiledLogLevel) {                 \
+      static ::utils::LogThrottle sLogThrottle{iPolicy};                       \
+      static constexpr ::utils::LogFormat kLogFormat{(iLogLevel), (iFormat),   \
+                                                     __PRETTY_FUNCTION__};     \
+      static constexpr ::utils::LogFormat kSuppressedLogFormat{                \
+          (iLogLevel), "{} similar message(s) suppressed",                     \
+          __PRETTY_FUNCTION__};                                                \
+      if (const ::utils::Log& sLogger{::utils::Log::GetInstance()};            \
+          sLogger.isEnabled(iLogLevel)) {                                      \
+        if (std::uint64_t sSuppressed{};                                       \
+            sLogThrottle.tryAcquire(sSuppressed)) {                            \
+          if (sSuppressed > 0) {                                               \
+            sLogger.toBinaryFile(kSuppressedLogFormat, sSuppressed);           \
+          }                                                                    \
+          sLogger.toBinaryFile(kLogFormat __VA_OPT__(, ) __VA_ARGS__);         \
+        }                                                                      \
+      }                                                                        \
+    }                                                                          \
+  } while (false)
+
+/**
+ * @brief Call site of a structured record. Its address identifies the call
+ * site within the process.
+ */
+struct LogFormat {
+  LogLevel level{};
+  std::string_view format{};
+  std::string_view function{};
+};
+
+/**
+ * @brief Type tags of the arguments of a structured record. Each tag is
+ * followed by the value in native byte order, 1 byte for BOOL, 8 bytes for
+ * numbers, or a 1-byte length and the characters for STRING.
+ */
+enum class LogArgument : std::uint8_t {
+  BOOL = 'b',
+  SIGNED = 'i',
+  UNSIGNED = 'u',
+  FLOAT = 'f',
+  STRING = 's'
+};
 
+/**
+ * @brief Process-wide logger. File records are handed to a background writer
+ * through a bounded lock-free queue, so logging threads never format, lock or
+ * touch the disk; the writer keeps the daily file open, writes records in
+ * batches and switches files at local midnight. When the queue is full,
+ * records are dropped and their number is reported once there is room again.
+ */
 class Log {
  public:
   Log(const Log&) = delete;
@@ -19,22 +164,162 @@ class Log {
 
   void toConsole(const LogLevel& iLogLevel, const std::string& iMessage,
                  const std::string& iFunctionName) const;
-  void toFile(const LogLevel& iLogLevel, const std::string& iMessage,
+  /**
+   * @brief Queue a record for the daily log file, without waiting for it to
+   * be written. Records below the minimum level are discarded; prefer
+   * LOG_TO_FILE, which also skips building their message.
+   */
+  void toFile(const LogLevel& iLogLevel, std::string iMessage,
               const std::string& iFunctionName) const;
+  /**
+   * @brief Wait until every record queued so far is written.
+   */
+  void flush() const;
+  /**
+   * @brief Queue a structured record for the daily binary log file; use
+   * LOG_STRUCTURED rather than calling it directly. Arguments that do not fit
+   * the record are left out and strings are truncated.
+   */
+  template <class... Arguments>
+  void toBinaryFile(const LogFormat& iFormat,
+                    const Arguments&... iArguments) const {
+    BinaryRecord aRecord;
+    aRecord.format = &iFormat;
+    aRecord.time = std::chrono::system_clock::now();
+    aRecord.threadId = std::this_thread::get_id();
+    (aRecord.append(iArguments), ...);
+    enqueue(std::move(aRecord));
+  }
+  /**
+   * @brief Set the least severe level written to the log file. Levels below
+   * kCompiledLogLevel stay disabled regardless.
+   */
+  void setMinimumLevel(const LogLevel iLogLevel);
+  [[nodiscard]] bool isEnabled(const LogLevel iLogLevel) const {
+    return iLogLevel >= kCompiledLogLevel &&
+           iLogLevel >= _minimumLevel.load(std::memory_order_relaxed);
+  }
 
  private:
+  struct Record {
+    LogLevel level{};
+    std::chrono::system_clock::time_point time{};
+    std::thread::id threadId{};
+    std::string functionName{};
+    std::string message{};
+  };
+
+  struct BinaryRecord {
+    static constexpr std::size_t kArgumentCapacity{96};
+
+    const LogFormat* format{};
+    std::chrono::system_clock::time_point time{};
+    std::thread::id threadId{};
+    std::uint8_t argumentsSize{};
+    // Left uninitialised, only the first argumentsSize bytes are read.
+    std::array<char, kArgumentCapacity> arguments;
+
+    template <class T>
+    void append(const T& iArgument) {
+      if constexpr (std::is_same_v<T, bool>) {
+        put(LogArgument::BOOL, static_cast<std::uint8_t>(iArgument));
+      } else if constexpr (std::is_integral_v<T> && std::is_signed_v<T>) {
+        put(LogArgument::SIGNED, static_cast<std::int64_t>(iArgument));
+      } else if constexpr (std::is_integral_v<T>) {
+        put(LogArgument::UNSIGNED, static_cast<std::uint64_t>(iArgument));
+      } else if constexpr (std::is_floating_point_v<T>) {
+        put(LogArgument::FLOAT, static_cast<double>(iArgument));
+      } else {
+        static_assert(std::is_convertible_v<const T&, std::string_view>,
+                      "Structured log arguments must be numbers or strings");
+        const std::string_view aValue{iArgument};
+        if (std::size_t{argumentsSize} + 2 > kArgumentCapacity) {
+          return;
+        }
+        const auto aSize{static_cast<std::uint8_t>(std::min<std::size_t>(
+            {aValue.size(), kArgumentCapacity - argumentsSize - 2, 255}))};
+        arguments[argumentsSize] = static_cast<char>(LogArgument::STRING);
+        arguments[argumentsSize + 1] = static_cast<char>(aSize);
+        std::memcpy(&arguments[argumentsSize + 2], aValue.data(), aSize);
+        argumentsSize += aSize + 2;
+      }
+    }
+
+   private:
+    template <class Value>
+    void put(const LogArgument iTag, const Value iValue) {
+      if (argumentsSize + 1 + sizeof(Value) > kArgumentCapacity) {
+        return;
+      }
+      arguments[argumentsSize] = static_cast<char>(iTag);
+      std::memcpy(&arguments[argumentsSize + 1], &iValue, sizeof(Value));
+      argumentsSize += 1 + sizeof(Value);
+    }
+  };
+
+  /**
+   * @brief Log file of the current day, reopened at local midnight.
+   */
+  struct DailyFile {
+    std::string extension{};
+    std::ofstream stream{};
+    std::chrono::system_clock::time_point nextRotation{};
+  };
+
+  static constexpr std::size_t kQueueCapacity{8192};
+
+  std::atomic<LogLevel> _minimumLevel{kCompiledLogLevel};
+
+  mutable MpscRingBuffer<Record> _records{kQueueCapacity};
+  mutable MpscRingBuffer<BinaryRecord> _binaryRecords{kQueueCapacity};
+  /** Records accepted by the queue and written by the writer, respectively. */
+  mutable std::atomic<std::uint64_t> _queued{};
+  std::atomic<std::uint64_t> _written{};
+  mutable std::atomic<std::uint64_t> _dropped{};
+  /** Bumped on every queued record, for the writer to wait on. */
+  mutable std::atomic<std::uint32_t> _signal{};
+  // Owned by the writer thread.
+  DailyFile _file{".log"};
+  DailyFile _binaryFile{".blog"};
+  /** Ids of the call sites whose format is in the current binary file. */
+  std::unordered_map<const LogFormat*, std::uint64_t> _formatIds{};
+  std::jthread _writer{};
+
   Log();
   ~Log();
 
   /**
-   * @brief Get current date.
+   * @brief Get the local date of a point in time.
    * @return Date in %Y%m%d format.
    */
-  static std::string GetCurrentDate();
-  static inline bool IsFilePresent(const std::string& iFileName);
-  std::string constructStream(const LogLevel& iLogLevel,
-                              const std::string& iMessage,
-                              const std::string& iFunctionName) const;
+  static std::string GetDate(const std::chrono::system_clock::time_point iTime);
+  /**
+   * @return Local midnight following the given point in time.
+   */
+  static std::chrono::system_clock::time_point
+  GetNextMidnight(const std::chrono::system_clock::time_point iTime);
+  std::string constructStream(const Record& iRecord) const;
+  void enqueue(BinaryRecord&& ioRecord) const;
+  /**
+   * @brief Count a queued record and wake the writer up.
+   */
+  void signalQueued() const;
+  void runWriter(const std::stop_token iStopToken);
+  /**
+   * @brief Open the file of the day of iTime, unless it is already open.
+   * @return Whether another file was opened.
+   */
+  bool rotate(DailyFile& ioFile,
+              const std::chrono::system_clock::time_point iTime);
+  /**
+   * @brief Write a record to the file of its day, opening it if needed.
+   */
+  void write(const Record& iRecord);
+  /**
+   * @brief Write a structured record to the binary file of its day, preceded
+   * by the format of its call site the first time it appears in that file.
+   */
+  void write(const BinaryRecord& iRecord);
 };
 
-} // namespace utils
\ No newline at end of file
+} // namespace utils
@@ -0,0 +1,234 @@
+// author: georgiosmatzarapis
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstdint>
+#include <expected>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace utils {
+
+/**
+ * @brief Number of shards of counters and histograms. Threads are spread over
+ * the shards, so that concurrent updates rarely share a cache line.
+ */
+inline constexpr std::size_t kMetricShards{16};
+
+/**
+ * @return Shard of the calling thread, assigned on its first update.
+ */
+std::size_t GetMetricShard();
+
+/**
+ * @brief Monotonic counter, summed over its shards when read.
+ */
+class Counter {
+ public:
+  Counter() = default;
+
+  Counter(const Counter&) = delete;
+  Counter& operator=(const Counter&) = delete;
+  Counter(Counter&&) noexcept = delete;
+  Counter& operator=(Counter&&) noexcept = delete;
+
+  void add(const std::uint64_t iValue = 1);
+  [[nodiscard]] std::uint64_t getValue() const;
+
+ private:
+  struct alignas(64) Shard {
+    std::atomic<std::uint64_t> value{};
+  };
+
+  std::array<Shard, kMetricShards> _shards{};
+};
+
+/**
+ * @brief Distribution of non-negative values in log-linear buckets, in the
+ * manner of HdrHistogram: every power of two is split into kSubBuckets
+ * buckets, bounding the relative error of quantiles to about 6%.
+ * Values of 2^40 and above share the last bucket.
+ */
+class Histogram {
+ public:
+  static constexpr std::size_t kSubBucketBits{4};
+  static constexpr std::size_t kSubBuckets{std::size_t{1} << kSubBucketBits};
+  static constexpr std::size_t kMaximumBits{40};
+  static constexpr std::size_t kBuckets{(kMaximumBits - kSubBucketBits + 1) *
+                                        kSubBuckets};
+
+  Histogram();
+
+  Histogram(const Histogram&) = delete;
+  Histogram& operator=(const Histogram&) = delete;
+  Histogram(Histogram&&) noexcept = delete;
+  Histogram& operator=(Histogram&&) noexcept = delete;
+
+  void record(const std::uint64_t iValue);
+  [[nodiscard]] std::uint64_t getCount() const;
+  [[nodiscard]] std::uint64_t getSum() const;
+  /**
+   * @param iQuantile Between 0 and 1.
+   * @return Upper bound of the bucket holding the quantile, 0 if empty.
+   */
+  [[nodiscard]] std::uint64_t getQuantile(const double iQuantile) const;
+
+  static std::size_t GetBucket(const std::uint64_t iValue);
+  /**
+   * @return Largest value of a bucket.
+   */
+  static std::uint64_t GetBucketUpperBound(const std::size_t iBucket);
+
+ private:
+  struct alignas(64) Shard {
+    std::atomic<std::uint64_t> count{};
+    std::atomic<std::uint64_t> sum{};
+    std::array<std::atomic<std::uint64_t>, kBuckets> buckets{};
+  };
+
+  /** Allocated apart, as it spans a few dozen kilobytes. */
+  std::unique_ptr<Shard[]> _shards{};
+};
+
+/**
+ * @brief Process-wide registry of named metrics, exported in the Prometheus
+ * text format. Metrics are registered once, typically into a static
+ * reference at the call site, and stay valid for the lifetime of the process.
+ * Recording is disabled until setEnabled is called; call sites test
+ * isEnabled first, so that disabled metrics cost a single relaxed load.
+ * Safe to use from any thread.
+ */
+class MetricsRegistry {
+ public:
+  MetricsRegistry(const MetricsRegistry&) = delete;
+  MetricsRegistry& operator=(const MetricsRegistry&) = delete;
+  MetricsRegistry(MetricsRegistry&&) noexcept = delete;
+  MetricsRegistry& operator=(MetricsRegistry&&) noexcept = delete;
+
+  static MetricsRegistry& GetInstance();
+
+  [[nodiscard]] bool isEnabled() const {
+    return _isEnabled.load(std::memory_order_relaxed);
+  }
+  void setEnabled(const bool iIsEnabled);
+
+  /**
+   * @brief Get the counter of a name and labels, registering it if needed.
+   * @param iName Prometheus metric name, conventionally ending in _total.
+   * @param iLabels Prometheus labels without braces, e.g. operation="get".
+   */
+  Counter& counter(const std::string& iName, const std::string& iHelp,
+                   const std::string& iLabels = "");
+  /**
+   * @brief Get the histogram of a name and labels, registering it if needed.
+   * It is exported as a summary of quantiles.
+   * @param iUnit Factor converting recorded values to the exported unit,
+   * e.g. 1e-9 for durations recorded in nanoseconds and exported in seconds.
+   */
+  Histogram& histogram(const std::string& iName, const std::string& iHelp,
+                       const std::string& iLabels = "",
+                       const double iUnit = 1.0);
+
+  /**
+   * @return Every metric in the Prometheus text exposition format.
+   */
+  [[nodiscard]] std::string toPrometheus() const;
+  /**
+   * @brief Write the metrics to a file atomically, e.g. for the textfile
+   * collector of the node exporter.
+   * @return Nothing on success, otherwise the reason of the failure.
+   */
+  std::expected<void, std::string>
+  writeToFile(const std::filesystem::path& iPath) const;
+
+ private:
+  template <class Metric>
+  struct Family {
+    std::string help{};
+    double unit{1.0};
+    /** Metrics by labels. */
+    std::map<std::string, std::unique_ptr<Metric>> metrics{};
+  };
+
+  std::atomic<bool> _isEnabled{};
+  mutable std::mutex _mutex{};
+  std::map<std::string, Family<Counter>> _counters{};
+  std::map<std::string, Family<Histogram>> _histograms{};
+
+  MetricsRegistry();
+  ~MetricsRegistry();
+};
+
+/**
+ * @brief Record the lifetime of a scope into a histogram, in nanoseconds.
+ * The clock is not read while metrics are disabled.
+ */
+class MetricsTimer {
+ public:
+  explicit MetricsTimer(Histogram& histogram)
+      : _histogram{histogram},
+        _isEnabled{MetricsRegistry::GetInstance().isEnabled()} {
+    if (_isEnabled) {
+      _start = std::chrono::steady_clock::now();
+    }
+  }
+
+  ~MetricsTimer() {
+    if (_isEnabled) {
+      _histogram.record(static_cast<std::uint64_t>(
+          std::chrono::duration_cast<std::chrono::nanoseconds>(
+              std::chrono::steady_clock::now() - _start)
+              .count()));
+    }
+  }
+
+  MetricsTimer(const MetricsTimer&) = delete;
+  MetricsTimer& operator=(const MetricsTimer&) = delete;
+  MetricsTimer(MetricsTimer&&) noexcept = delete;
+  MetricsTimer& operator=(MetricsTimer&&) noexcept = delete;
+
+ private:
+  Histogram& _histogram;
+  const bool _isEnabled{};
+  std::chrono::steady_clock::time_point _start{};
+};
+
+/**
+ * @brief Serve the metrics of a registry over HTTP on the loopback interface,
+ * answering every request with the Prometheus text, from a background
+ * thread.
+ */
+class MetricsEndpoint {
+ public:
+  /**
+   * @param port Port to listen on, 0 for any free port.
+   * @throw std::runtime_error, if the socket cannot be set up.
+   */
+  explicit MetricsEndpoint(const MetricsRegistry& registry,
+                           const std::uint16_t port = 0);
+  ~MetricsEndpoint();
+
+  MetricsEndpoint(const MetricsEndpoint&) = delete;
+  MetricsEndpoint& operator=(const MetricsEndpoint&) = delete;
+  MetricsEndpoint(MetricsEndpoint&&) noexcept = delete;
+  MetricsEndpoint& operator=(MetricsEndpoint&&) noexcept = delete;
+
+  [[nodiscard]] std::uint16_t getPort() const;
+
+ private:
+  const MetricsRegistry& _registry;
+  int _socket{-1};
+  std::uint16_t _port{};
+  std::jthread _server{};
+
+  void serve(const std::stop_token iStopToken) const;
+};
+} // namespace utils
@@ -0,0 +1,70 @@
+// author: georgiosmatzarapis
+
+#pragma once
+
+#include <atomic>
+#include <optional>
+#include <utility>
+
+namespace utils {
+/**
+ * @brief Unbounded lock-free queue with many producers and a single consumer.
+ * Producers link a node with a single atomic exchange and never wait on each
+ * other nor on the consumer. Only one thread at a time may call pop.
+ * A pop racing with a push may not see that element yet; it is returned by a
+ * later pop.
+ */
+template <class T>
+class MpscQueue {
+ public:
+  MpscQueue() : _head{new Node{}}, _tail{_head.load()} {}
+  ~MpscQueue() {
+    while (pop().has_value()) {
+    }
+    delete _tail;
+  }
+
+  MpscQueue(const MpscQueue&) = delete;
+  MpscQueue& operator=(const MpscQueue&) = delete;
+  MpscQueue(MpscQueue&&) noexcept = delete;
+  MpscQueue& operator=(MpscQueue&&) noexcept = delete;
+
+  /**
+   * @brief Enqueue an element. Safe to call from any thread.
+   */
+  void push(T iValue) {
+    Node* aNode{new Node{}};
+    aNode->value.emplace(std::move(iValue));
+    Node* aPrevious{_head.exchange(aNode, std::memory_order_acq_rel)};
+    aPrevious->next.store(aNode, std::memory_order_release);
+  }
+
+  /**
+   * @brief Dequeue the oldest element. Must only be called by the consumer.
+   * @return Element, or nothing if the queue is empty.
+   */
+  std::optional<T> pop() {
+    Node* aTail{_tail};
+    Node* aNext{aTail->next.load(std::memory_order_acquire)};
+    if (!aNext) {
+      return std::nullopt;
+    }
+    std::optional<T> aValue{std::move(aNext->value)};
+    aNext->value.reset();
+    _tail = aNext;
+    delete aTail;
+    return aValue;
+  }
+
+ private:
+  struct Node {
+    std::atomic<Node*> next{};
+    std::optional<T> value{};
+  };
+
+  // Producers and the consumer touch different ends of the queue; keep them
+  // on separate cache lines.
+  alignas(64) std::atomic<Node*> _head;
+  alignas(64) Node* _tail;
+};
+} // namespace utils
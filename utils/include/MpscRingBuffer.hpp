@@ -0,0 +1,99 @@
+// author: georgiosmatzarapis
+
+#pragma once
+
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <utility>
+
+namespace utils {
+/**
+ * @brief Bounded lock-free queue with many producers and a single consumer.
+ * Elements live in a preallocated ring of cells, each carrying a sequence
+ * number that tells producers and the consumer whose turn it is, so a push
+ * neither allocates nor waits: when the ring is full it fails instead.
+ * Only one thread at a time may call pop.
+ */
+template <class T>
+class MpscRingBuffer {
+ public:
+  /**
+   * @param capacity Number of cells, rounded up to a power of two.
+   */
+  explicit MpscRingBuffer(const std::size_t capacity)
+      : _cells{std::make_unique<Cell[]>(std::bit_ceil(capacity))},
+        _mask{std::bit_ceil(capacity) - 1} {
+    for (std::size_t aIndex{}; aIndex <= _mask; ++aIndex) {
+      _cells[aIndex].sequence.store(aIndex, std::memory_order_relaxed);
+    }
+  }
+
+  MpscRingBuffer(const MpscRingBuffer&) = delete;
+  MpscRingBuffer& operator=(const MpscRingBuffer&) = delete;
+  MpscRingBuffer(MpscRingBuffer&&) noexcept = delete;
+  MpscRingBuffer& operator=(MpscRingBuffer&&) noexcept = delete;
+
+  /**
+   * @brief Enqueue an element. Safe to call from any thread.
+   * @return Whether the element was enqueued, false if the ring is full, in
+   * which case the element is left untouched.
+   */
+  bool tryPush(T&& ioValue) {
+    std::size_t aPosition{_head.load(std::memory_order_relaxed)};
+    for (;;) {
+      Cell& aCell{_cells[aPosition & _mask]};
+      const std::size_t aSequence{
+          aCell.sequence.load(std::memory_order_acquire)};
+      const auto aLag{static_cast<std::intptr_t>(aSequence - aPosition)};
+      if (aLag == 0) {
+        if (_head.compare_exchange_weak(aPosition, aPosition + 1,
+                                        std::memory_order_relaxed)) {
+          aCell.value.emplace(std::move(ioValue));
+          aCell.sequence.store(aPosition + 1, std::memory_order_release);
+          return true;
+        }
+      } else if (aLag < 0) {
+        // The consumer has not released this cell from the previous lap yet.
+        return false;
+      } else {
+        aPosition = _head.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  /**
+   * @brief Dequeue the oldest element. Must only be called by the consumer.
+   * @return Element, or nothing if the ring is empty.
+   */
+  std::optional<T> pop() {
+    Cell& aCell{_cells[_tail & _mask]};
+    if (aCell.sequence.load(std::memory_order_acquire) != _tail + 1) {
+      return std::nullopt;
+    }
+    std::optional<T> aValue{std::move(aCell.value)};
+    aCell.value.reset();
+    aCell.sequence.store(_tail + _mask + 1, std::memory_order_release);
+    ++_tail;
+    return aValue;
+  }
+
+  [[nodiscard]] std::size_t getCapacity() const { return _mask + 1; }
+
+ private:
+  struct Cell {
+    std::atomic<std::size_t> sequence{};
+    std::optional<T> value{};
+  };
+
+  std::unique_ptr<Cell[]> _cells;
+  std::size_t _mask{};
+  // Producers and the consumer touch different ends of the ring; keep them
+  // on separate cache lines.
+  alignas(64) std::atomic<std::size_t> _head{};
+  alignas(64) std::size_t _tail{};
+};
+} // namespace utils
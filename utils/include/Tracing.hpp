@@ -0,0 +1,122 @@
+// author: georgiosmatzarapis
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <expected>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace utils {
+
+/**
+ * @brief Process-wide recorder of trace spans, exported in the Chrome
+ * trace-event JSON format (viewable in Perfetto or chrome://tracing).
+ * Every thread records into a buffer of its own, so recording threads only
+ * contend with an export. Recording is disabled until setEnabled is called,
+ * in which case spans cost a single relaxed load.
+ * Safe to use from any thread.
+ */
+class Tracer {
+ public:
+  /** Spans kept per thread, further ones are dropped. */
+  static constexpr std::size_t kMaximumSpansPerThread{1 << 20};
+
+  Tracer(const Tracer&) = delete;
+  Tracer& operator=(const Tracer&) = delete;
+  Tracer(Tracer&&) noexcept = delete;
+  Tracer& operator=(Tracer&&) noexcept = delete;
+
+  static Tracer& GetInstance();
+
+  [[nodiscard]] bool isEnabled() const {
+    return _isEnabled.load(std::memory_order_relaxed);
+  }
+  void setEnabled(const bool iIsEnabled);
+
+  /**
+   * @brief Record a completed span of the calling thread.
+   * @param iName Name with static storage duration, e.g. a string literal.
+   * @param iDepth Number of spans of the thread enclosing it.
+   */
+  void record(const char* iName,
+              const std::chrono::steady_clock::time_point iStart,
+              const std::chrono::steady_clock::time_point iEnd,
+              const std::uint32_t iDepth);
+  /**
+   * @brief Discard the spans recorded so far.
+   */
+  void clear();
+
+  /**
+   * @return Recorded spans as a trace-event JSON object.
+   */
+  [[nodiscard]] std::string toJson() const;
+  /**
+   * @brief Write the recorded spans to a trace-event JSON file.
+   * @return Nothing on success, otherwise the reason of the failure.
+   */
+  std::expected<void, std::string>
+  writeToFile(const std::filesystem::path& iPath) const;
+
+ private:
+  struct Span {
+    const char* name{};
+    std::int64_t startNs{};
+    std::int64_t durationNs{};
+    std::uint32_t depth{};
+  };
+
+  struct ThreadBuffer {
+    std::uint32_t threadId{};
+    /** Only contended while spans are exported or cleared. */
+    std::mutex mutex{};
+    std::vector<Span> spans{};
+    std::uint64_t dropped{};
+  };
+
+  std::atomic<bool> _isEnabled{};
+  const std::chrono::steady_clock::time_point _origin{
+      std::chrono::steady_clock::now()};
+  mutable std::mutex _mutex{};
+  /** Buffers of every thread that recorded a span, kept after it exits. */
+  std::vector<std::shared_ptr<ThreadBuffer>> _buffers{};
+
+  Tracer();
+  ~Tracer();
+
+  /**
+   * @return Buffer of the calling thread, registered on its first span.
+   */
+  ThreadBuffer& getThreadBuffer();
+};
+
+/**
+ * @brief Record the lifetime of a scope as a span of the calling thread,
+ * nested in the spans enclosing it. The clock is not read while tracing is
+ * disabled.
+ */
+class TraceSpan {
+ public:
+  /**
+   * @param name Name with static storage duration, e.g. a string literal.
+   */
+  explicit TraceSpan(const char* name);
+  ~TraceSpan();
+
+  TraceSpan(const TraceSpan&) = delete;
+  TraceSpan& operator=(const TraceSpan&) = delete;
+  TraceSpan(TraceSpan&&) noexcept = delete;
+  TraceSpan& operator=(TraceSpan&&) noexcept = delete;
+
+ private:
+  const char* _name{};
+  const bool _isEnabled{};
+  std::chrono::steady_clock::time_point _start{};
+};
+} // namespace utils
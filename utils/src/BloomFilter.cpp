@@ -0,0 +1,80 @@
+// author: georgiosmatzarapis
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <functional>
+
+#include "BloomFilter.hpp"
+
+namespace utils {
+
+static constexpr std::uint64_t kBitsPerBlock{512};
+
+/* === Helpers === */
+
+/**
+ * @brief Finalizer of SplitMix64, to derive independent probes from a hash.
+ */
+static std::uint64_t Mix(std::uint64_t iValue) {
+  iValue = (iValue ^ (iValue >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  iValue = (iValue ^ (iValue >> 27)) * 0x94D049BB133111EBULL;
+  return iValue ^ (iValue >> 31);
+}
+
+/* === BloomFilter Class === */
+
+BloomFilter::BloomFilter(const std::size_t expectedItems,
+                         const double falsePositiveRate) {
+  const double aRate{std::clamp(falsePositiveRate, 1e-9, 0.5)};
+  const double aBitsPerItem{-std::log(aRate) / (std::log(2.0) * std::log(2.0))};
+  const double aBits{std::max(1.0, static_cast<double>(expectedItems)) *
+                     aBitsPerItem};
+  _blocks.resize(std::max<std::size_t>(
+      1, static_cast<std::size_t>(std::ceil(aBits / kBitsPerBlock))));
+  _probes = static_cast<std::uint32_t>(
+      std::clamp(std::lround(aBitsPerItem * std::log(2.0)), 1L, 16L));
+}
+
+// Public API
+
+std::uint64_t BloomFilter::DigestKey(std::string_view iDigest) {
+  std::uint64_t sKey{};
+  if (iDigest.size() < sizeof(sKey)) {
+    return std::hash<std::string_view>{}(iDigest);
+  }
+  std::memcpy(&sKey, iDigest.data(), sizeof(sKey));
+  return sKey;
+}
+
+void BloomFilter::add(const std::uint64_t iHash) {
+  std::uint64_t aProbe{Mix(iHash)};
+  Block& aBlock{_blocks[aProbe % _blocks.size()]};
+  for (std::uint32_t aIndex{}; aIndex < _probes; ++aIndex) {
+    aProbe = Mix(aProbe);
+    const std::uint64_t aBit{aProbe % kBitsPerBlock};
+    aBlock.words[aBit / 64] |= std::uint64_t{1} << (aBit % 64);
+  }
+}
+
+bool BloomFilter::mayContain(const std::uint64_t iHash) const {
+  std::uint64_t aProbe{Mix(iHash)};
+  const Block& aBlock{_blocks[aProbe % _blocks.size()]};
+  for (std::uint32_t aIndex{}; aIndex < _probes; ++aIndex) {
+    aProbe = Mix(aProbe);
+    const std::uint64_t aBit{aProbe % kBitsPerBlock};
+    if (!(aBlock.words[aBit / 64] & (std::uint64_t{1} << (aBit % 64)))) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void BloomFilter::clear() {
+  std::fill(_blocks.begin(), _blocks.end(), Block{});
+}
+
+std::size_t BloomFilter::getBytes() const {
+  return _blocks.size() * sizeof(Block);
+}
+} // namespace utils
@@ -0,0 +1,190 @@
+// author: georgiosmatzarapis
+
+#include <bit>
+
+#include "ByteStream.hpp"
+
+namespace utils {
+
+/* === ByteWriter Class === */
+
+ByteWriter::ByteWriter() = default;
+
+ByteWriter::ByteWriter(const std::size_t iReserve) {
+  _buffer.reserve(iReserve);
+}
+
+ByteWriter::ByteWriter(std::string&& ioBuffer) : _buffer{std::move(ioBuffer)} {}
+
+// Public API
+
+void ByteWriter::putU8(const std::uint8_t iValue) {
+  _buffer.push_back(static_cast<char>(iValue));
+}
+
+void ByteWriter::putU16(const std::uint16_t iValue) {
+  for (std::size_t aShift{}; aShift < 16; aShift += 8) {
+    _buffer.push_back(static_cast<char>((iValue >> aShift) & 0xFF));
+  }
+}
+
+void ByteWriter::putU32(const std::uint32_t iValue) {
+  for (std::size_t aShift{}; aShift < 32; aShift += 8) {
+    _buffer.push_back(static_cast<char>((iValue >> aShift) & 0xFF));
+  }
+}
+
+void ByteWriter::putU64(const std::uint64_t iValue) {
+  for (std::size_t aShift{}; aShift < 64; aShift += 8) {
+    _buffer.push_back(static_cast<char>((iValue >> aShift) & 0xFF));
+  }
+}
+
+void ByteWriter::putI64(const std::int64_t iValue) {
+  putU64(static_cast<std::uint64_t>(iValue));
+}
+
+void ByteWriter::putF64(const double iValue) {
+  putU64(std::bit_cast<std::uint64_t>(iValue));
+}
+
+void ByteWriter::putVarU64(const std::uint64_t iValue) {
+  std::uint64_t aValue{iValue};
+  for (; aValue >= 0x80; aValue >>= 7) {
+    _buffer.push_back(static_cast<char>((aValue & 0x7F) | 0x80));
+  }
+  _buffer.push_back(static_cast<char>(aValue));
+}
+
+void ByteWriter::putVarI64(const std::int64_t iValue) {
+  putVarU64((static_cast<std::uint64_t>(iValue) << 1) ^
+            static_cast<std::uint64_t>(iValue >> 63));
+}
+
+void ByteWriter::putString(std::string_view iValue) {
+  putU32(static_cast<std::uint32_t>(iValue.size()));
+  _buffer.append(iValue);
+}
+
+void ByteWriter::putBytes(std::string_view iValue) { _buffer.append(iValue); }
+
+std::size_t ByteWriter::size() const { return _buffer.size(); }
+
+const std::string& ByteWriter::buffer() const { return _buffer; }
+
+std::string ByteWriter::take() { return std::move(_buffer); }
+
+/* === ByteReader Class === */
+
+ByteReader::ByteReader(std::string_view iBuffer) : _buffer{iBuffer} {}
+
+// Public API
+
+bool ByteReader::getU8(std::uint8_t& ioValue) { return getUnsigned(ioValue); }
+
+bool ByteReader::getU16(std::uint16_t& ioValue) {
+  return getUnsigned(ioValue);
+}
+
+bool ByteReader::getU32(std::uint32_t& ioValue) {
+  return getUnsigned(ioValue);
+}
+
+bool ByteReader::getU64(std::uint64_t& ioValue) {
+  return getUnsigned(ioValue);
+}
+
+bool ByteReader::getI64(std::int64_t& ioValue) {
+  std::uint64_t aValue{};
+  if (!getUnsigned(aValue)) {
+    return false;
+  }
+  ioValue = static_cast<std::int64_t>(aValue);
+  return true;
+}
+
+bool ByteReader::getF64(double& ioValue) {
+  std::uint64_t aValue{};
+  if (!getUnsigned(aValue)) {
+    return false;
+  }
+  ioValue = std::bit_cast<double>(aValue);
+  return true;
+}
+
+bool ByteReader::getVarU64(std::uint64_t& ioValue) {
+  std::uint64_t aValue{};
+  for (std::size_t aByte{}; aByte < 10 && aByte < remaining(); ++aByte) {
+    const auto aBits{static_cast<unsigned char>(_buffer[_position + aByte])};
+    aValue |= static_cast<std::uint64_t>(aBits & 0x7F) << (7 * aByte);
+    if (!(aBits & 0x80)) {
+      _position += aByte + 1;
+      ioValue = aValue;
+      return true;
+    }
+  }
+  return false;
+}
+
+bool ByteReader::getVarI64(std::int64_t& ioValue) {
+  std::uint64_t aValue{};
+  if (!getVarU64(aValue)) {
+    return false;
+  }
+  ioValue = static_cast<std::int64_t>((aValue >> 1) ^ (~(aValue & 1) + 1));
+  return true;
+}
+
+bool ByteReader::getString(std::string& ioValue) {
+  std::string_view aView{};
+  if (!getStringView(aView)) {
+    return false;
+  }
+  ioValue.assign(aView);
+  return true;
+}
+
+bool ByteReader::getStringView(std::string_view& ioValue) {
+  const std::size_t aStart{_position};
+  std::uint32_t aSize{};
+  if (!getU32(aSize) || !getBytes(aSize, ioValue)) {
+    _position = aStart;
+    return false;
+  }
+  return true;
+}
+
+bool ByteReader::getBytes(const std::size_t iSize, std::string_view& ioValue) {
+  if (remaining() < iSize) {
+    return false;
+  }
+  ioValue = _buffer.substr(_position, iSize);
+  _position += iSize;
+  return true;
+}
+
+std::size_t ByteReader::position() const { return _position; }
+
+std::size_t ByteReader::remaining() const {
+  return _buffer.size() - _position;
+}
+
+// Private API
+
+template <class Unsigned>
+bool ByteReader::getUnsigned(Unsigned& ioValue) {
+  if (remaining() < sizeof(Unsigned)) {
+    return false;
+  }
+  Unsigned aValue{};
+  for (std::size_t aByte{}; aByte < sizeof(Unsigned); ++aByte) {
+    aValue |= static_cast<Unsigned>(
+        static_cast<Unsigned>(
+            static_cast<unsigned char>(_buffer[_position + aByte]))
+        << (8 * aByte));
+  }
+  _position += sizeof(Unsigned);
+  ioValue = aValue;
+  return true;
+}
+} // namespace utils
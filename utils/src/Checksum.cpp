@@ -0,0 +1,35 @@
+// author: georgiosmatzarapis
+
+#include <array>
+
+#include "Checksum.hpp"
+
+namespace utils {
+
+static constexpr std::uint32_t kCrc32cPolynomial{0x82F63B78};
+
+static constexpr std::array<std::uint32_t, 256> MakeCrc32cTable() {
+  std::array<std::uint32_t, 256> sTable{};
+  for (std::uint32_t sByte{}; sByte < sTable.size(); ++sByte) {
+    std::uint32_t sCrc{sByte};
+    for (int sBit{}; sBit < 8; ++sBit) {
+      sCrc = (sCrc & 1) ? (sCrc >> 1) ^ kCrc32cPolynomial : (sCrc >> 1);
+    }
+    sTable[sByte] = sCrc;
+  }
+  return sTable;
+}
+
+static constexpr std::array<std::uint32_t, 256> kCrc32cTable{
+    MakeCrc32cTable()};
+
+std::uint32_t Crc32c(const void* iData, const std::size_t iSize,
+                     const std::uint32_t iSeed) {
+  const auto sBytes{static_cast<const unsigned char*>(iData)};
+  std::uint32_t sCrc{~iSeed};
+  for (std::size_t sIndex{}; sIndex < iSize; ++sIndex) {
+    sCrc = kCrc32cTable[(sCrc ^ sBytes[sIndex]) & 0xFF] ^ (sCrc >> 8);
+  }
+  return ~sCrc;
+}
+} // namespace utils
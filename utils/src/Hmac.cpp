@@ -44,7 +44,9 @@ void HmacIt(const unsigned char* iMessage, const std::size_t iMessageSize,
     }
 
     EVP_MD_CTX_free(sMdCtx);
-
+    LOG_TO_FILE(LogLevel::DEBUG, "Digest of " + std::to_string(*ioDigestSize) +
+                                     " bytes computed for " +
+                                     std::to_string(iMessageSize) + " bytes.");
   } catch (const std::runtime_error& iRuntimeError) {
     std::ostringstream sStrStreamError{};
     sStrStreamError << iRuntimeError.what() << " failed, error 0x" << std::hex
@@ -0,0 +1,157 @@
+// author: georgiosmatzarapis
+
+#include <chrono>
+#include <cstring>
+#include <ctime>
+#include <iomanip>
+#include <optional>
+#include <sstream>
+#include <unordered_map>
+
+#include "ByteStream.hpp"
+#include "LogDecoder.hpp"
+#include "Logger.hpp"
+
+namespace utils {
+
+/* === Helpers === */
+
+struct DecodedFormat {
+  LogLevel level{};
+  std::string function{};
+  std::string format{};
+};
+
+template <class Value>
+static bool GetNative(std::string_view& ioArguments, Value& ioValue) {
+  if (ioArguments.size() < sizeof(Value)) {
+    return false;
+  }
+  std::memcpy(&ioValue, ioArguments.data(), sizeof(Value));
+  ioArguments.remove_prefix(sizeof(Value));
+  return true;
+}
+
+/**
+ * @brief Render the next encoded argument and consume it.
+ * @return Argument text, or nothing if the arguments are exhausted or invalid.
+ */
+static std::optional<std::string> TakeArgument(std::string_view& ioArguments) {
+  std::uint8_t sTag{};
+  if (!GetNative(ioArguments, sTag)) {
+    return std::nullopt;
+  }
+  switch (static_cast<LogArgument>(sTag)) {
+    case LogArgument::BOOL: {
+      std::uint8_t sValue{};
+      if (GetNative(ioArguments, sValue)) {
+        return sValue ? "true" : "false";
+      }
+      break;
+    }
+    case LogArgument::SIGNED: {
+      std::int64_t sValue{};
+      if (GetNative(ioArguments, sValue)) {
+        return std::to_string(sValue);
+      }
+      break;
+    }
+    case LogArgument::UNSIGNED: {
+      std::uint64_t sValue{};
+      if (GetNative(ioArguments, sValue)) {
+        return std::to_string(sValue);
+      }
+      break;
+    }
+    case LogArgument::FLOAT: {
+      double sValue{};
+      if (GetNative(ioArguments, sValue)) {
+        std::ostringstream sStream{};
+        sStream << sValue;
+        return sStream.str();
+      }
+      break;
+    }
+    case LogArgument::STRING: {
+      std::uint8_t sSize{};
+      if (GetNative(ioArguments, sSize) && ioArguments.size() >= sSize) {
+        std::string sValue{ioArguments.substr(0, sSize)};
+        ioArguments.remove_prefix(sSize);
+        return sValue;
+      }
+      break;
+    }
+  }
+  return std::nullopt;
+}
+
+std::string RenderLogMessage(std::string_view iFormat,
+                             std::string_view iArguments) {
+  std::string sMessage{};
+  sMessage.reserve(iFormat.size());
+  for (std::size_t sPlaceholder{iFormat.find("{}")};
+       sPlaceholder != std::string_view::npos;
+       sPlaceholder = iFormat.find("{}")) {
+    sMessage += iFormat.substr(0, sPlaceholder);
+    const std::optional<std::string> sArgument{TakeArgument(iArguments)};
+    sMessage += sArgument ? *sArgument : "{}";
+    iFormat.remove_prefix(sPlaceholder + 2);
+  }
+  sMessage += iFormat;
+  return sMessage;
+}
+
+std::expected<std::uint64_t, std::string> DecodeLog(std::string_view iBytes,
+                                                    std::ostream& ioOutput) {
+  std::unordered_map<std::uint64_t, DecodedFormat> sFormats{};
+  std::uint64_t sRecordCount{};
+  ByteReader sReader{iBytes};
+  while (sReader.remaining() > 0) {
+    const std::size_t sOffset{sReader.position()};
+    const std::string sError{"Invalid entry at offset " +
+                             std::to_string(sOffset) + "."};
+    std::uint8_t sKind{};
+    std::uint64_t sFormatId{};
+    if (!sReader.getU8(sKind) || !sReader.getVarU64(sFormatId)) {
+      return std::unexpected{sError};
+    }
+
+    if (sKind == static_cast<std::uint8_t>(LogEntry::FORMAT)) {
+      DecodedFormat sFormat{};
+      std::uint8_t sLevel{};
+      if (!sReader.getU8(sLevel) || sLevel > static_cast<std::uint8_t>(
+                                                 LogLevel::FATAL) ||
+          !sReader.getString(sFormat.function) ||
+          !sReader.getString(sFormat.format)) {
+        return std::unexpected{sError};
+      }
+      sFormat.level = static_cast<LogLevel>(sLevel);
+      sFormats.insert_or_assign(sFormatId, std::move(sFormat));
+      continue;
+    }
+
+    std::int64_t sTime{};
+    std::uint64_t sThreadId{};
+    std::string_view sArguments{};
+    const auto sFormat{sFormats.find(sFormatId)};
+    if (sKind != static_cast<std::uint8_t>(LogEntry::RECORD) ||
+        sFormat == sFormats.end() || !sReader.getI64(sTime) ||
+        !sReader.getU64(sThreadId) || !sReader.getStringView(sArguments)) {
+      return std::unexpected{sError};
+    }
+
+    const std::time_t sUtcTimestamp{std::chrono::system_clock::to_time_t(
+        std::chrono::system_clock::time_point{
+            std::chrono::duration_cast<std::chrono::system_clock::duration>(
+                std::chrono::nanoseconds{sTime})})};
+    std::tm sUtcTime{};
+    gmtime_r(&sUtcTimestamp, &sUtcTime);
+    ioOutput << std::put_time(&sUtcTime, "%FT%TZ") << " | "
+             << GetLogLevelName(sFormat->second.level) << " | " << sThreadId
+             << " | " << sFormat->second.function << ": | "
+             << RenderLogMessage(sFormat->second.format, sArguments) << '\n';
+    ++sRecordCount;
+  }
+  return sRecordCount;
+}
+} // namespace utils
@@ -1,19 +1,62 @@
 // author: georgiosmatzarapis
 
-#include <chrono>
+#include <ctime>
 #include <filesystem>
-#include <fstream>
-#include <thread>
+#include <iomanip>
+#include <optional>
+#include <sstream>
 
+#include "ByteStream.hpp"
+#include "LogDecoder.hpp"
 #include "Logger.hpp"
 
 namespace utils {
 
 static constexpr std::string kLogsDirectory{"../../logs/"};
+/**
+ * Set once the writer is gone, so records logged by objects destroyed after
+ * the logger still reach the console.
+ */
+static std::atomic<bool> sWriterStopped{false};
 
-Log::Log() = default;
+/* === Helpers === */
 
-Log::~Log() = default;
+static std::uint64_t ToInteger(const std::thread::id iThreadId) {
+  static_assert(sizeof(std::thread::id) == sizeof(std::uint64_t));
+  return std::bit_cast<std::uint64_t>(iThreadId);
+}
+
+std::string_view GetLogLevelName(const LogLevel iLogLevel) {
+  switch (iLogLevel) {
+    case LogLevel::DEBUG:
+      return "DEBUG";
+    case LogLevel::INFO:
+      return "INFO";
+    case LogLevel::WARNING:
+      return "WARNING";
+    case LogLevel::ERROR:
+      return "ERROR";
+    case LogLevel::FATAL:
+      return "FATAL";
+    default:
+      return "UNKNOWN";
+  }
+}
+
+/* === Log Class === */
+
+Log::Log()
+    : _writer{[this](const std::stop_token iStopToken) {
+        runWriter(iStopToken);
+      }} {}
+
+Log::~Log() {
+  _writer.request_stop();
+  _signal.fetch_add(1, std::memory_order_release);
+  _signal.notify_one();
+  _writer.join();
+  sWriterStopped.store(true, std::memory_order_release);
+}
 
 Log& Log::GetInstance() {
   static Log sInstance{};
@@ -28,96 +71,214 @@ void Log::toConsole(const LogLevel& iLogLevel, const std::string& iMessage,
       (iLogLevel == LogLevel::ERROR || iLogLevel == LogLevel::FATAL)
           ? std::cerr
           : std::clog};
-  aOutputType << constructStream(iLogLevel, iMessage, iFunctionName);
+  aOutputType << constructStream(Record{iLogLevel,
+                                        std::chrono::system_clock::now(),
+                                        std::this_thread::get_id(),
+                                        iFunctionName, iMessage});
 }
 
-void Log::toFile(const LogLevel& iLogLevel, const std::string& iMessage,
+void Log::toFile(const LogLevel& iLogLevel, std::string iMessage,
                  const std::string& iFunctionName) const {
-  const std::string aFileName{kLogsDirectory + GetCurrentDate() + ".log"};
+  if (!isEnabled(iLogLevel)) {
+    return;
+  }
+  if (sWriterStopped.load(std::memory_order_acquire)) {
+    toConsole(iLogLevel, iMessage, iFunctionName);
+    return;
+  }
 
-  std::ofstream aOutputFile{};
-  aOutputFile.exceptions(std::ofstream::failbit | std::ofstream::badbit);
-  try {
-    std::filesystem::create_directories(kLogsDirectory);
+  if (!_records.tryPush(Record{iLogLevel, std::chrono::system_clock::now(),
+                               std::this_thread::get_id(), iFunctionName,
+                               std::move(iMessage)})) {
+    _dropped.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+  signalQueued();
+}
 
-    aOutputFile.open(aFileName,
-                     IsFilePresent(aFileName) ? std::ios::app : std::ios::out);
-    if (aOutputFile.is_open()) {
-      aOutputFile << constructStream(iLogLevel, iMessage, iFunctionName);
-    }
-  } catch (const std::filesystem::filesystem_error& iFileSystemError) {
-    toConsole(LogLevel::ERROR,
-              "Exception while creating the log directory: " +
-                  std::string{iFileSystemError.what()},
-              __PRETTY_FUNCTION__);
-  } catch (const std::ofstream::failure& iOutputException) {
-    toConsole(LogLevel::ERROR,
-              "Exception while interacting with log file: " +
-                  std::string{iOutputException.what()},
-              __PRETTY_FUNCTION__);
-  } catch (const std::exception& iException) {
-    toConsole(LogLevel::ERROR,
-              "Unhandled exception while interacting with log file: " +
-                  std::string{iException.what()},
-              __PRETTY_FUNCTION__);
+void Log::flush() const {
+  const std::uint64_t aQueued{_queued.load(std::memory_order_acquire)};
+  for (std::uint64_t aWritten{_written.load(std::memory_order_acquire)};
+       aWritten < aQueued;
+       aWritten = _written.load(std::memory_order_acquire)) {
+    _written.wait(aWritten, std::memory_order_acquire);
   }
 }
 
-// Private API
+void Log::setMinimumLevel(const LogLevel iLogLevel) {
+  _minimumLevel.store(iLogLevel, std::memory_order_relaxed);
+}
 
-std::string Log::GetCurrentDate() {
-  const std::time_t sCurrentDatetime{
-      std::chrono::system_clock::to_time_t(std::chrono::system_clock::now())};
-  std::tm* const sLocalTime{std::localtime(&sCurrentDatetime)};
+// Private API
 
-  const int sYear{sLocalTime->tm_year + 1900};
-  const int sMonth{sLocalTime->tm_mon + 1};
-  const int sDay{sLocalTime->tm_mday};
+std::string Log::GetDate(const std::chrono::system_clock::time_point iTime) {
+  const std::time_t sDatetime{std::chrono::system_clock::to_time_t(iTime)};
+  std::tm sLocalTime{};
+  localtime_r(&sDatetime, &sLocalTime);
 
-  std::string sMonthStr{(sMonth < 10) ? "0" + std::to_string(sMonth)
-                                      : std::to_string(sMonth)};
-  std::string sDayStr{(sDay < 10) ? "0" + std::to_string(sDay)
-                                  : std::to_string(sDay)};
-  return std::to_string(sYear) + sMonthStr + sDayStr;
+  char sDate[9]{};
+  std::strftime(sDate, sizeof(sDate), "%Y%m%d", &sLocalTime);
+  return sDate;
 }
 
-bool Log::IsFilePresent(const std::string& iFileName) {
-  return std::ifstream{iFileName} ? true : false;
-}
+std::chrono::system_clock::time_point
+Log::GetNextMidnight(const std::chrono::system_clock::time_point iTime) {
+  const std::time_t sDatetime{std::chrono::system_clock::to_time_t(iTime)};
+  std::tm sLocalTime{};
+  localtime_r(&sDatetime, &sLocalTime);
 
-std::string Log::constructStream(const LogLevel& iLogLevel,
-                                 const std::string& iMessage,
-                                 const std::string& iFunctionName) const {
-  std::string aLogLevel{};
-  switch (iLogLevel) {
-    case LogLevel::INFO:
-      aLogLevel = "INFO";
-      break;
-    case LogLevel::DEBUG:
-      aLogLevel = "DEBUG";
-      break;
-    case LogLevel::WARNING:
-      aLogLevel = "WARNING";
-      break;
-    case LogLevel::ERROR:
-      aLogLevel = "ERROR";
-      break;
-    case LogLevel::FATAL:
-      aLogLevel = "FATAL";
-      break;
-    default:
-      aLogLevel = "UNKNOWN";
-      break;
-  }
+  sLocalTime.tm_hour = 0;
+  sLocalTime.tm_min = 0;
+  sLocalTime.tm_sec = 0;
+  ++sLocalTime.tm_mday;
+  sLocalTime.tm_isdst = -1;
+  return std::chrono::system_clock::from_time_t(std::mktime(&sLocalTime));
+}
 
+std::string Log::constructStream(const Record& iRecord) const {
   const std::time_t aUtcTimestamp{
-      std::chrono::system_clock::to_time_t(std::chrono::system_clock::now())};
+      std::chrono::system_clock::to_time_t(iRecord.time)};
+  std::tm aUtcTime{};
+  gmtime_r(&aUtcTimestamp, &aUtcTime);
 
   std::ostringstream aFinalStream{};
-  aFinalStream << std::put_time(gmtime(&aUtcTimestamp), "%FT%TZ") << " | "
-               << aLogLevel << " | " << std::this_thread::get_id() << " | "
-               << iFunctionName << ": | " << iMessage << std::endl;
+  aFinalStream << std::put_time(&aUtcTime, "%FT%TZ") << " | "
+               << GetLogLevelName(iRecord.level) << " | " << iRecord.threadId
+               << " | " << iRecord.functionName << ": | " << iRecord.message
+               << '\n';
 
   return aFinalStream.str();
 }
-} // namespace utils
\ No newline at end of file
+
+void Log::enqueue(BinaryRecord&& ioRecord) const {
+  if (sWriterStopped.load(std::memory_order_acquire)) {
+    toConsole(ioRecord.format->level,
+              RenderLogMessage(ioRecord.format->format,
+                               std::string_view{ioRecord.arguments.data(),
+                                                ioRecord.argumentsSize}),
+              std::string{ioRecord.format->function});
+    return;
+  }
+
+  if (!_binaryRecords.tryPush(std::move(ioRecord))) {
+    _dropped.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+  signalQueued();
+}
+
+void Log::signalQueued() const {
+  _queued.fetch_add(1, std::memory_order_release);
+  _signal.fetch_add(1, std::memory_order_release);
+  _signal.notify_one();
+}
+
+void Log::runWriter(const std::stop_token iStopToken) {
+  for (;;) {
+    const std::uint32_t aSignal{_signal.load(std::memory_order_acquire)};
+
+    std::uint64_t aBatchSize{};
+    while (std::optional<Record> aRecord{_records.pop()}) {
+      write(*aRecord);
+      ++aBatchSize;
+    }
+    while (std::optional<BinaryRecord> aRecord{_binaryRecords.pop()}) {
+      write(*aRecord);
+      ++aBatchSize;
+    }
+    if (const std::uint64_t aDropped{
+            _dropped.exchange(0, std::memory_order_relaxed)};
+        aDropped > 0) {
+      write(Record{LogLevel::WARNING, std::chrono::system_clock::now(),
+                   std::this_thread::get_id(), __PRETTY_FUNCTION__,
+                   std::to_string(aDropped) +
+                       " log record(s) dropped, the queue was full"});
+    }
+
+    if (aBatchSize > 0) {
+      for (DailyFile* const aFile : {&_file, &_binaryFile}) {
+        if (aFile->stream.is_open()) {
+          aFile->stream.flush();
+        }
+      }
+      _written.fetch_add(aBatchSize, std::memory_order_release);
+      _written.notify_all();
+      continue;
+    }
+    if (iStopToken.stop_requested()) {
+      return;
+    }
+    _signal.wait(aSignal, std::memory_order_acquire);
+  }
+}
+
+bool Log::rotate(DailyFile& ioFile,
+                 const std::chrono::system_clock::time_point iTime) {
+  if (ioFile.stream.is_open() && iTime < ioFile.nextRotation) {
+    return false;
+  }
+
+  ioFile.stream.close();
+  ioFile.stream.clear();
+  try {
+    std::filesystem::create_directories(kLogsDirectory);
+    ioFile.stream.open(kLogsDirectory + GetDate(iTime) + ioFile.extension,
+                       std::ios::app | std::ios::binary);
+    ioFile.nextRotation = GetNextMidnight(iTime);
+  } catch (const std::filesystem::filesystem_error& iFileSystemError) {
+    toConsole(LogLevel::ERROR,
+              "Exception while creating the log directory: " +
+                  std::string{iFileSystemError.what()},
+              __PRETTY_FUNCTION__);
+  }
+  return true;
+}
+
+void Log::write(const Record& iRecord) {
+  rotate(_file, iRecord.time);
+  if (_file.stream.is_open()) {
+    _file.stream << constructStream(iRecord);
+  } else {
+    toConsole(LogLevel::ERROR, "Unable to open the log file",
+              __PRETTY_FUNCTION__);
+    toConsole(iRecord.level, iRecord.message, iRecord.functionName);
+  }
+}
+
+void Log::write(const BinaryRecord& iRecord) {
+  if (rotate(_binaryFile, iRecord.time)) {
+    _formatIds.clear();
+  }
+  const std::string_view aArguments{iRecord.arguments.data(),
+                                    iRecord.argumentsSize};
+  if (!_binaryFile.stream.is_open()) {
+    toConsole(LogLevel::ERROR, "Unable to open the binary log file",
+              __PRETTY_FUNCTION__);
+    toConsole(iRecord.format->level,
+              RenderLogMessage(iRecord.format->format, aArguments),
+              std::string{iRecord.format->function});
+    return;
+  }
+
+  ByteWriter aWriter{};
+  const auto [aFormat, aIsNewFormat]{
+      _formatIds.try_emplace(iRecord.format, _formatIds.size())};
+  if (aIsNewFormat) {
+    aWriter.putU8(static_cast<std::uint8_t>(LogEntry::FORMAT));
+    aWriter.putVarU64(aFormat->second);
+    aWriter.putU8(static_cast<std::uint8_t>(iRecord.format->level));
+    aWriter.putString(iRecord.format->function);
+    aWriter.putString(iRecord.format->format);
+  }
+  aWriter.putU8(static_cast<std::uint8_t>(LogEntry::RECORD));
+  aWriter.putVarU64(aFormat->second);
+  aWriter.putI64(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                     iRecord.time.time_since_epoch())
+                     .count());
+  aWriter.putU64(ToInteger(iRecord.threadId));
+  aWriter.putString(aArguments);
+  _binaryFile.stream.write(aWriter.buffer().data(),
+                           static_cast<std::streamsize>(aWriter.size()));
+}
+
+} // namespace utils
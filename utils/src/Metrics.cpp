@@ -0,0 +1,341 @@
+// author: georgiosmatzarapis
+
+#include <algorithm>
+#include <arpa/inet.h>
+#include <charconv>
+#include <cmath>
+#include <fstream>
+#include <netinet/in.h>
+#include <poll.h>
+#include <stdexcept>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <vector>
+
+#include "Metrics.hpp"
+
+namespace utils {
+
+static constexpr double kExportedQuantiles[]{0.5, 0.9, 0.99, 0.999};
+/** Interval at which the endpoint checks whether it must stop. */
+static constexpr int kPollTimeoutMs{100};
+
+/* === Helpers === */
+
+std::size_t GetMetricShard() {
+  static std::atomic<std::size_t> sNextShard{};
+  static thread_local const std::size_t sShard{
+      sNextShard.fetch_add(1, std::memory_order_relaxed) % kMetricShards};
+  return sShard;
+}
+
+static std::string FormatNumber(const double iValue) {
+  char sBuffer[32]{};
+  const std::to_chars_result sResult{
+      std::to_chars(std::begin(sBuffer), std::end(sBuffer), iValue)};
+  return std::string(sBuffer, sResult.ptr);
+}
+
+/**
+ * @return Metric name followed by its labels, and an extra label if any.
+ */
+static std::string Series(const std::string& iName, const std::string& iLabels,
+                          const std::string& iExtraLabel = "") {
+  if (iLabels.empty() && iExtraLabel.empty()) {
+    return iName;
+  }
+  return iName + "{" + iLabels +
+         (iLabels.empty() || iExtraLabel.empty() ? "" : ",") + iExtraLabel +
+         "}";
+}
+
+/* === Counter Class === */
+
+// Public API
+
+void Counter::add(const std::uint64_t iValue) {
+  _shards[GetMetricShard()].value.fetch_add(iValue, std::memory_order_relaxed);
+}
+
+std::uint64_t Counter::getValue() const {
+  std::uint64_t aValue{};
+  for (const Shard& aShard : _shards) {
+    aValue += aShard.value.load(std::memory_order_relaxed);
+  }
+  return aValue;
+}
+
+/* === Histogram Class === */
+
+Histogram::Histogram() : _shards{std::make_unique<Shard[]>(kMetricShards)} {}
+
+// Public API
+
+void Histogram::record(const std::uint64_t iValue) {
+  Shard& aShard{_shards[GetMetricShard()]};
+  aShard.buckets[GetBucket(iValue)].fetch_add(1, std::memory_order_relaxed);
+  aShard.count.fetch_add(1, std::memory_order_relaxed);
+  aShard.sum.fetch_add(iValue, std::memory_order_relaxed);
+}
+
+std::uint64_t Histogram::getCount() const {
+  std::uint64_t aCount{};
+  for (std::size_t aShard{}; aShard < kMetricShards; ++aShard) {
+    aCount += _shards[aShard].count.load(std::memory_order_relaxed);
+  }
+  return aCount;
+}
+
+std::uint64_t Histogram::getSum() const {
+  std::uint64_t aSum{};
+  for (std::size_t aShard{}; aShard < kMetricShards; ++aShard) {
+    aSum += _shards[aShard].sum.load(std::memory_order_relaxed);
+  }
+  return aSum;
+}
+
+std::uint64_t Histogram::getQuantile(const double iQuantile) const {
+  // Bucket counts are merged first, so that the rank is taken from the same
+  // values as the ones walked.
+  std::vector<std::uint64_t> aBuckets(kBuckets, 0);
+  std::uint64_t aCount{};
+  for (std::size_t aShard{}; aShard < kMetricShards; ++aShard) {
+    for (std::size_t aBucket{}; aBucket < kBuckets; ++aBucket) {
+      const std::uint64_t aBucketCount{
+          _shards[aShard].buckets[aBucket].load(std::memory_order_relaxed)};
+      aBuckets[aBucket] += aBucketCount;
+      aCount += aBucketCount;
+    }
+  }
+  if (aCount == 0) {
+    return 0;
+  }
+
+  const std::uint64_t aRank{std::max<std::uint64_t>(
+      1, static_cast<std::uint64_t>(
+             std::ceil(std::clamp(iQuantile, 0.0, 1.0) *
+                       static_cast<double>(aCount))))};
+  std::uint64_t aSeen{};
+  for (std::size_t aBucket{}; aBucket < kBuckets; ++aBucket) {
+    aSeen += aBuckets[aBucket];
+    if (aSeen >= aRank) {
+      return GetBucketUpperBound(aBucket);
+    }
+  }
+  return GetBucketUpperBound(kBuckets - 1);
+}
+
+std::size_t Histogram::GetBucket(const std::uint64_t iValue) {
+  if (iValue < kSubBuckets) {
+    return iValue;
+  }
+  if (iValue >> kMaximumBits) {
+    return kBuckets - 1;
+  }
+  // The leading bit selects the power of two, the next kSubBucketBits bits
+  // the bucket within it.
+  const std::size_t sExponent{
+      static_cast<std::size_t>(std::bit_width(iValue)) - 1};
+  const std::size_t sSubBucket{
+      static_cast<std::size_t>(iValue >> (sExponent - kSubBucketBits)) -
+      kSubBuckets};
+  return (sExponent - kSubBucketBits + 1) * kSubBuckets + sSubBucket;
+}
+
+std::uint64_t Histogram::GetBucketUpperBound(const std::size_t iBucket) {
+  if (iBucket < kSubBuckets) {
+    return iBucket;
+  }
+  const std::size_t sShift{iBucket / kSubBuckets - 1};
+  const std::uint64_t sLowerBound{
+      static_cast<std::uint64_t>(kSubBuckets + iBucket % kSubBuckets)
+      << sShift};
+  return sLowerBound + (std::uint64_t{1} << sShift) - 1;
+}
+
+/* === MetricsRegistry Class === */
+
+MetricsRegistry::MetricsRegistry() = default;
+
+MetricsRegistry::~MetricsRegistry() = default;
+
+MetricsRegistry& MetricsRegistry::GetInstance() {
+  static MetricsRegistry sInstance{};
+  return sInstance;
+}
+
+// Public API
+
+void MetricsRegistry::setEnabled(const bool iIsEnabled) {
+  _isEnabled.store(iIsEnabled, std::memory_order_relaxed);
+}
+
+Counter& MetricsRegistry::counter(const std::string& iName,
+                                  const std::string& iHelp,
+                                  const std::string& iLabels) {
+  std::lock_guard aLock{_mutex};
+  Family<Counter>& aFamily{_counters[iName]};
+  aFamily.help = iHelp;
+  std::unique_ptr<Counter>& aCounter{aFamily.metrics[iLabels]};
+  if (!aCounter) {
+    aCounter = std::make_unique<Counter>();
+  }
+  return *aCounter;
+}
+
+Histogram& MetricsRegistry::histogram(const std::string& iName,
+                                      const std::string& iHelp,
+                                      const std::string& iLabels,
+                                      const double iUnit) {
+  std::lock_guard aLock{_mutex};
+  Family<Histogram>& aFamily{_histograms[iName]};
+  aFamily.help = iHelp;
+  aFamily.unit = iUnit;
+  std::unique_ptr<Histogram>& aHistogram{aFamily.metrics[iLabels]};
+  if (!aHistogram) {
+    aHistogram = std::make_unique<Histogram>();
+  }
+  return *aHistogram;
+}
+
+std::string MetricsRegistry::toPrometheus() const {
+  std::lock_guard aLock{_mutex};
+  std::string aText{};
+  for (const auto& [aName, aFamily] : _counters) {
+    aText += "# HELP " + aName + " " + aFamily.help + "\n";
+    aText += "# TYPE " + aName + " counter\n";
+    for (const auto& [aLabels, aCounter] : aFamily.metrics) {
+      aText += Series(aName, aLabels) + " " +
+               std::to_string(aCounter->getValue()) + "\n";
+    }
+  }
+  for (const auto& [aName, aFamily] : _histograms) {
+    aText += "# HELP " + aName + " " + aFamily.help + "\n";
+    aText += "# TYPE " + aName + " summary\n";
+    for (const auto& [aLabels, aHistogram] : aFamily.metrics) {
+      for (const double aQuantile : kExportedQuantiles) {
+        aText += Series(aName, aLabels,
+                        "quantile=\"" + FormatNumber(aQuantile) + "\"") +
+                 " " +
+                 FormatNumber(static_cast<double>(
+                                  aHistogram->getQuantile(aQuantile)) *
+                              aFamily.unit) +
+                 "\n";
+      }
+      aText += Series(aName + "_sum", aLabels) + " " +
+               FormatNumber(static_cast<double>(aHistogram->getSum()) *
+                            aFamily.unit) +
+               "\n";
+      aText += Series(aName + "_count", aLabels) + " " +
+               std::to_string(aHistogram->getCount()) + "\n";
+    }
+  }
+  return aText;
+}
+
+std::expected<void, std::string>
+MetricsRegistry::writeToFile(const std::filesystem::path& iPath) const {
+  std::filesystem::path aTemporaryPath{iPath};
+  aTemporaryPath += ".tmp";
+  {
+    std::ofstream aFile{aTemporaryPath, std::ios::trunc};
+    aFile << toPrometheus();
+    if (!aFile.flush()) {
+      return std::unexpected{"Metrics could not be written to " +
+                             aTemporaryPath.string() + "."};
+    }
+  }
+
+  std::error_code aError{};
+  std::filesystem::rename(aTemporaryPath, iPath, aError);
+  if (aError) {
+    return std::unexpected{"Metrics could not be moved to " + iPath.string() +
+                           ". " + aError.message()};
+  }
+  return {};
+}
+
+/* === MetricsEndpoint Class === */
+
+MetricsEndpoint::MetricsEndpoint(const MetricsRegistry& registry,
+                                 const std::uint16_t port)
+    : _registry{registry} {
+  _socket = ::socket(AF_INET, SOCK_STREAM, 0);
+  if (_socket < 0) {
+    throw std::runtime_error{"Metrics endpoint socket could not be created."};
+  }
+  const int aReuseAddress{1};
+  ::setsockopt(_socket, SOL_SOCKET, SO_REUSEADDR, &aReuseAddress,
+               sizeof(aReuseAddress));
+
+  sockaddr_in aAddress{};
+  aAddress.sin_family = AF_INET;
+  aAddress.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  aAddress.sin_port = htons(port);
+  socklen_t aAddressSize{sizeof(aAddress)};
+  if (::bind(_socket, reinterpret_cast<const sockaddr*>(&aAddress),
+             sizeof(aAddress)) != 0 ||
+      ::listen(_socket, SOMAXCONN) != 0 ||
+      ::getsockname(_socket, reinterpret_cast<sockaddr*>(&aAddress),
+                    &aAddressSize) != 0) {
+    ::close(_socket);
+    throw std::runtime_error{"Metrics endpoint could not listen on port " +
+                             std::to_string(port) + "."};
+  }
+  _port = ntohs(aAddress.sin_port);
+
+  _server = std::jthread{
+      [this](const std::stop_token iStopToken) { serve(iStopToken); }};
+}
+
+MetricsEndpoint::~MetricsEndpoint() {
+  _server.request_stop();
+  _server.join();
+  ::close(_socket);
+}
+
+// Public API
+
+std::uint16_t MetricsEndpoint::getPort() const { return _port; }
+
+// Private API
+
+void MetricsEndpoint::serve(const std::stop_token iStopToken) const {
+  while (!iStopToken.stop_requested()) {
+    pollfd aListener{_socket, POLLIN, 0};
+    if (::poll(&aListener, 1, kPollTimeoutMs) <= 0) {
+      continue;
+    }
+    const int aClient{::accept(_socket, nullptr, nullptr)};
+    if (aClient < 0) {
+      continue;
+    }
+
+    // The request is read only to be acknowledged, every path is served the
+    // metrics.
+    char aRequest[1024]{};
+    pollfd aConnection{aClient, POLLIN, 0};
+    if (::poll(&aConnection, 1, kPollTimeoutMs) > 0) {
+      [[maybe_unused]] const ssize_t aReceived{
+          ::recv(aClient, aRequest, sizeof(aRequest), 0)};
+    }
+
+    const std::string aBody{_registry.toPrometheus()};
+    const std::string aResponse{
+        "HTTP/1.1 200 OK\r\n"
+        "Content-Type: text/plain; version=0.0.4\r\n"
+        "Content-Length: " +
+        std::to_string(aBody.size()) + "\r\nConnection: close\r\n\r\n" +
+        aBody};
+    for (std::size_t aSent{}; aSent < aResponse.size();) {
+      const ssize_t aWritten{::send(aClient, aResponse.data() + aSent,
+                                    aResponse.size() - aSent, MSG_NOSIGNAL)};
+      if (aWritten <= 0) {
+        break;
+      }
+      aSent += static_cast<std::size_t>(aWritten);
+    }
+    ::close(aClient);
+  }
+}
+} // namespace utils
@@ -0,0 +1,158 @@
+// author: georgiosmatzarapis
+
+#include <fstream>
+#include <unistd.h>
+
+#include "Tracing.hpp"
+
+namespace utils {
+
+/** Number of spans open on the calling thread. */
+static thread_local std::uint32_t sDepth{};
+
+/* === Helpers === */
+
+static std::int64_t
+ToNanoseconds(const std::chrono::steady_clock::duration iDuration) {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(iDuration)
+      .count();
+}
+
+/**
+ * @return Nanoseconds as the microseconds of trace events, keeping their
+ * sub-microsecond part.
+ */
+static std::string ToMicroseconds(const std::int64_t iNanoseconds) {
+  const std::string sFraction{std::to_string(1000 + iNanoseconds % 1000)};
+  return std::to_string(iNanoseconds / 1000) + "." + sFraction.substr(1);
+}
+
+static std::string EscapeJson(const std::string_view iValue) {
+  std::string sEscaped{};
+  sEscaped.reserve(iValue.size());
+  for (const char sCharacter : iValue) {
+    if (sCharacter == '"' || sCharacter == '\\') {
+      sEscaped += '\\';
+      sEscaped += sCharacter;
+    } else if (static_cast<unsigned char>(sCharacter) < 0x20) {
+      sEscaped += ' ';
+    } else {
+      sEscaped += sCharacter;
+    }
+  }
+  return sEscaped;
+}
+
+/* === Tracer Class === */
+
+Tracer::Tracer() = default;
+
+Tracer::~Tracer() = default;
+
+Tracer& Tracer::GetInstance() {
+  static Tracer sInstance{};
+  return sInstance;
+}
+
+// Public API
+
+void Tracer::setEnabled(const bool iIsEnabled) {
+  _isEnabled.store(iIsEnabled, std::memory_order_relaxed);
+}
+
+void Tracer::record(const char* iName,
+                    const std::chrono::steady_clock::time_point iStart,
+                    const std::chrono::steady_clock::time_point iEnd,
+                    const std::uint32_t iDepth) {
+  ThreadBuffer& aBuffer{getThreadBuffer()};
+  std::lock_guard aLock{aBuffer.mutex};
+  if (aBuffer.spans.size() >= kMaximumSpansPerThread) {
+    ++aBuffer.dropped;
+    return;
+  }
+  aBuffer.spans.push_back(Span{iName, ToNanoseconds(iStart - _origin),
+                               ToNanoseconds(iEnd - iStart), iDepth});
+}
+
+void Tracer::clear() {
+  std::lock_guard aLock{_mutex};
+  for (const std::shared_ptr<ThreadBuffer>& aBuffer : _buffers) {
+    std::lock_guard aBufferLock{aBuffer->mutex};
+    aBuffer->spans.clear();
+    aBuffer->dropped = 0;
+  }
+}
+
+std::string Tracer::toJson() const {
+  const std::string aProcessId{std::to_string(::getpid())};
+  std::string aJson{"{\"displayTimeUnit\":\"ns\",\"traceEvents\":["};
+  bool aIsFirst{true};
+  const auto aAppendEvent{[&aJson, &aIsFirst](const std::string& iEvent) {
+    aJson += aIsFirst ? "\n" : ",\n";
+    aJson += iEvent;
+    aIsFirst = false;
+  }};
+
+  std::lock_guard aLock{_mutex};
+  for (const std::shared_ptr<ThreadBuffer>& aBuffer : _buffers) {
+    std::lock_guard aBufferLock{aBuffer->mutex};
+    const std::string aThread{"\"pid\":" + aProcessId +
+                              ",\"tid\":" + std::to_string(aBuffer->threadId)};
+    aAppendEvent("{\"name\":\"thread_name\",\"ph\":\"M\"," + aThread +
+                 ",\"args\":{\"name\":\"thread " +
+                 std::to_string(aBuffer->threadId) + "\",\"dropped_spans\":" +
+                 std::to_string(aBuffer->dropped) + "}}");
+    for (const Span& aSpan : aBuffer->spans) {
+      aAppendEvent("{\"name\":\"" + EscapeJson(aSpan.name) +
+                   "\",\"ph\":\"X\",\"ts\":" + ToMicroseconds(aSpan.startNs) +
+                   ",\"dur\":" + ToMicroseconds(aSpan.durationNs) + "," +
+                   aThread + ",\"args\":{\"depth\":" +
+                   std::to_string(aSpan.depth) + "}}");
+    }
+  }
+  aJson += "\n]}\n";
+  return aJson;
+}
+
+std::expected<void, std::string>
+Tracer::writeToFile(const std::filesystem::path& iPath) const {
+  std::ofstream aFile{iPath, std::ios::trunc};
+  aFile << toJson();
+  if (!aFile.flush()) {
+    return std::unexpected{"Trace could not be written to " + iPath.string() +
+                           "."};
+  }
+  return {};
+}
+
+// Private API
+
+Tracer::ThreadBuffer& Tracer::getThreadBuffer() {
+  static thread_local std::shared_ptr<ThreadBuffer> sBuffer{};
+  if (!sBuffer) {
+    sBuffer = std::make_shared<ThreadBuffer>();
+    std::lock_guard aLock{_mutex};
+    sBuffer->threadId = static_cast<std::uint32_t>(_buffers.size() + 1);
+    _buffers.push_back(sBuffer);
+  }
+  return *sBuffer;
+}
+
+/* === TraceSpan Class === */
+
+TraceSpan::TraceSpan(const char* name)
+    : _name{name}, _isEnabled{Tracer::GetInstance().isEnabled()} {
+  if (_isEnabled) {
+    ++sDepth;
+    _start = std::chrono::steady_clock::now();
+  }
+}
+
+TraceSpan::~TraceSpan() {
+  if (_isEnabled) {
+    --sDepth;
+    Tracer::GetInstance().record(_name, _start,
+                                 std::chrono::steady_clock::now(), sDepth);
+  }
+}
+} // namespace utils